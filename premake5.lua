@@ -82,7 +82,11 @@ project("CalcoTool")
 	includedirs({ "libs/", "src/libs" })
 	files({"src/core/**", "src/libs/glm/**.hpp", "src/libs/glm/*.cpp", "src/libs/glm/**.h", "src/libs/glm/*.c", "src/tool/**", "premake5.lua"})
 	removefiles({"**.DS_STORE", "**.thumbs"})
-	
+
+	-- Thread pool and server threads.
+	filter("system:linux")
+		links({"pthread"})
+	filter({})
 
 project("Calco")
 	
@@ -130,6 +134,43 @@ project("Calco")
 	filter({})
 
 
+group("Tests")
+
+project("CalcoTests")
+
+	kind("ConsoleApp")
+	CommonFlags()
+
+	includedirs({"src/"})
+	externalincludedirs({ "libs/", "src/libs" })
+	links({"sr_gui"})
+	-- common files
+	includedirs({ "libs/", "src/libs" })
+	files({"src/core/**", "src/libs/glm/**.hpp", "src/libs/glm/*.cpp", "src/libs/glm/**.h", "src/libs/glm/*.c", "src/tests/**", "premake5.lua"})
+	removefiles({"**.DS_STORE", "**.thumbs"})
+
+	filter("system:linux")
+		links({"pthread"})
+	filter({})
+
+project("CalcoBenchmarks")
+
+	kind("ConsoleApp")
+	CommonFlags()
+
+	includedirs({"src/"})
+	externalincludedirs({ "libs/", "src/libs" })
+	links({"sr_gui"})
+	-- common files
+	includedirs({ "libs/", "src/libs" })
+	files({"src/core/**", "src/libs/glm/**.hpp", "src/libs/glm/*.cpp", "src/libs/glm/**.h", "src/libs/glm/*.c", "src/benchmarks/**", "premake5.lua"})
+	removefiles({"**.DS_STORE", "**.thumbs"})
+
+	filter("system:linux")
+		links({"pthread"})
+	filter({})
+
+
 newaction {
    trigger     = "clean",
    description = "Clean the build directory",
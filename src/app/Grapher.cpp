@@ -1,5 +1,8 @@
 #include "Grapher.hpp"
 
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
 
 void FunctionGraph::validate(Calculator& calculator){
    // Test the validity of the function.
@@ -36,6 +39,7 @@ FunctionGraph& Grapher::addOrUpdateFunction(const std::string& name, const Docum
 	FunctionGraph& funcGraph = _functions[existingID];
 	funcGraph.name = name;
 	funcGraph.values.clear();
+	funcGraph.tiles.clear();
 	// Reset arguments and their ranges.
 	const size_t argCount = func.arguments.size();
 	funcGraph.args.resize(argCount);
@@ -50,6 +54,15 @@ FunctionGraph& Grapher::addOrUpdateFunction(const std::string& name, const Docum
 		funcGraph.color = ImPlot::GetColormapColor(_totalCount++);
 	}
 
+	// Results of the previous definition are not needed anymore.
+	const auto job = _jobs.find(name);
+	if(job != _jobs.end()){
+		job->second->cancelled = true;
+		_jobs.erase(job);
+	}
+	_caches.erase(name);
+	_tileCaches.erase(name);
+
 	funcGraph.show = false;
 	funcGraph.dirty = true;
 	funcGraph.invalid = false;
@@ -58,7 +71,31 @@ FunctionGraph& Grapher::addOrUpdateFunction(const std::string& name, const Docum
 	return funcGraph;
 }
 
+void Grapher::refreshFunction(const std::string& name, Calculator& calculator){
+	for(FunctionGraph& graph : _functions){
+		if(graph.name != name){
+			continue;
+		}
+		// Caches are discarded when sampling, as the calculator version changed.
+		graph.validate(calculator);
+		graph.show = graph.show && !graph.invalid;
+		graph.dirty = true;
+		return;
+	}
+}
+
+Grapher::~Grapher(){
+	clear();
+}
+
 void Grapher::clear(){
+	for(auto& job : _jobs){
+		job.second->cancelled = true;
+	}
+	_jobs.clear();
+	_caches.clear();
+	_tileCaches.clear();
+	_snapshot = nullptr;
 	_functions.clear();
 	_totalCount = 0;
 }
@@ -228,30 +265,37 @@ bool Grapher::display(Calculator& calculator){
 		ImGui::PopItemWidth();
 		ImGui::PopStyleVar();
 
-		// Update sampled data as late as possible.
-
-		// If the graph region was resized, update the abscisse samples.
+		// If the graph region was resized, sample all graphs again.
 		if(_updateRect){
-			_xs.resize(_sampleCount);
-
-			const float aspectRatio =  float(_currentRect.Y.Max - _currentRect.Y.Min) / float(_currentRect.X.Max - _currentRect.X.Min);
-
-			const size_t ySampleCount = size_t(glm::floor(float(_sampleCount) * aspectRatio));
-			_ys.resize(ySampleCount);
-
-			for(int i = 0; i < _sampleCount; ++i){
-				_xs[i] = (double(i)+0.5)/ double(_sampleCount) * (_currentRect.X.Max - _currentRect.X.Min) + _currentRect.X.Min;
-			}
-			for(size_t i = 0; i < ySampleCount; ++i){
-				_ys[i] = (double(i)+0.5)/ double(ySampleCount) * (_currentRect.Y.Max - _currentRect.Y.Min) + _currentRect.Y.Min;
-			}
 			_updateRect = false;
-			// Mark all graphs as dirty.
 			for(auto& graph : _functions){
 				graph.dirty = true;
 			}
 		}
-		 // Update functions.
+
+		// Retrieve the latest results of background jobs, the previous ones are displayed until then.
+		for(auto& graph : _functions){
+			const auto jobIt = _jobs.find(graph.name);
+			if(jobIt == _jobs.end()){
+				continue;
+			}
+			GraphJob& job = *jobIt->second;
+			std::lock_guard<std::mutex> lock(job.mutex);
+			if(job.updated){
+				job.updated = false;
+				std::swap(graph.values, job.results);
+				std::swap(graph.tiles, job.resultTiles);
+				graph.valuesCount = job.resultsCount;
+				if(job.failed){
+					// Evaluation error, hide the function.
+					graph.show = false;
+					graph.invalid = true;
+				}
+				refresh = true;
+			}
+		}
+
+		// Sample modified graphs in the background.
 		for(auto& graph : _functions){
 			if(!graph.show){
 				continue;
@@ -259,79 +303,8 @@ bool Grapher::display(Calculator& calculator){
 			if(!graph.dirty){
 				continue;
 			}
-
-			if(graph.type == FunctionGraph::Type::FUNCTION){
-				// Sample linearly for abscisse values.
-				graph.values.resize(_sampleCount);
-				graph.valuesCount = _sampleCount;
-
-				for(int sid = 0; sid < _sampleCount; ++sid){
-					// Set the value of the first argument.
-					if(!graph.args.empty()){
-						graph.args[0] = _xs[sid];
-					}
-					// Evaluate the function.
-					Value outRaw, outFloat;
-					if(!calculator.evaluateFunction(graph.name, graph.args, outRaw)){
-						// Evaluation error, hide the function.
-						graph.show = false;
-						graph.invalid = true;
-						break;
-					}
-					// Convert to float
-					if(!outRaw.convert(Value::Type::FLOAT, outFloat)){
-						graph.show = false;
-						graph.invalid = true;
-						break;
-					}
-					graph.values[sid] = outFloat.f;
-				}
-			} else if(graph.type == FunctionGraph::Type::DOMAIN){
-				const int downscale = 2;
-				const size_t sizeX = _xs.size();
-				const size_t sizeY = _ys.size();
-
-				graph.values.resize(2 * sizeX/downscale * sizeY/downscale);
-				graph.valuesCount = 0;
-				const size_t argCount = graph.args.size();
-
-				for(size_t sid = 0; sid < sizeX; sid += downscale){
-					// Set the value of the first argument.
-					if(argCount != 0){
-						graph.args[0] = _xs[sid];
-					}
-
-					for(size_t tid = 0; tid < sizeY; tid += downscale){
-						if(argCount > 1){
-							graph.args[1] = _ys[tid];
-						}
-						// Evaluate the function.
-						Value outRaw;
-						if(!calculator.evaluateFunction(graph.name, graph.args, outRaw)){
-							// Evaluation error, hide the function.
-							graph.show = false;
-							graph.invalid = true;
-							break;
-						}
-						assert(outRaw.type == Value::Type::BOOL);
-						// Output the point if the test value is positive.
-						if(outRaw.b){
-							graph.values[2 * graph.valuesCount] = _xs[sid];
-							graph.values[2 * graph.valuesCount + 1] = _ys[tid];
-							++graph.valuesCount;
-						}
-					}
-
-					if(graph.invalid){
-						break;
-					}
-				}
-
-			}
-
+			startJob(graph, calculator);
 			graph.dirty = false;
-			// We'll want the display to update.
-			refresh = true;
 		}
 
 		ImGui::BeginChild("##Function view", ImVec2(0, 0));
@@ -340,20 +313,37 @@ bool Grapher::display(Calculator& calculator){
 			ImPlot::SetupAxes(NULL, NULL);
 			ImPlot::SetupFinish();
 			for(const auto& graph : _functions){
-				if(!graph.show){
+				// Graphs are not drawn until their first samples are ready.
+				if(!graph.show || (graph.valuesCount == 0 && graph.tiles.empty())){
 					continue;
 				}
 
 				ImPlot::PushStyleColor(ImPlotCol_Line, graph.color);
 
 				if(graph.type == FunctionGraph::Type::FUNCTION){
-					ImPlot::PlotLine(graph.name.c_str(), _xs.data(), graph.values.data(), int(graph.valuesCount));
+					ImPlot::PlotLine(graph.name.c_str(), &graph.values[0], &graph.values[1], int(graph.valuesCount), 0, 0, 2 * sizeof(double));
 				} else if(graph.type == FunctionGraph::Type::DOMAIN){
-					ImPlot::PlotScatter(graph.name.c_str(), &graph.values[0], &graph.values[1], int(graph.valuesCount), 0, 0, 2 * sizeof(double));
+					// Fill the samples where the test is true.
+					ImVec4 color = graph.color;
+					color.w *= ImPlot::GetStyle().FillAlpha;
+					ImPlot::PushPlotClipRect();
+					drawDomain(graph, ImGui::GetColorU32(color));
+					ImPlot::PopPlotClipRect();
+					// Outline its boundary.
+					if(graph.valuesCount != 0){
+						ImPlot::PlotLine(graph.name.c_str(), &graph.values[0], &graph.values[1], int(graph.valuesCount), 0, 0, 2 * sizeof(double));
+					}
 				}
 				ImPlot::PopStyleColor();
 			}
 
+			// Curves are refined based on their size on screen.
+			const ImVec2 plotSize = ImPlot::GetPlotSize();
+			if(plotSize.x != _plotSize.x || plotSize.y != _plotSize.y){
+				_plotSize = plotSize;
+				_updateRect = true;
+			}
+
 			ImPlotRect rect = ImPlot::GetPlotLimits();
 			if(rect.X.Min != _currentRect.X.Min || rect.X.Max != _currentRect.X.Max ||
 			   rect.Y.Min != _currentRect.Y.Min || rect.Y.Max != _currentRect.Y.Max){
@@ -368,3 +358,809 @@ bool Grapher::display(Calculator& calculator){
 
 	return refresh;
 }
+
+namespace {
+
+	// Index of the first bit with the given value in a row of words, from a given index. Returns the bit count if none.
+	size_t findBit(const uint64_t* words, size_t wordCount, size_t from, bool value){
+		for(size_t wid = from / 64; wid < wordCount; ++wid){
+			uint64_t word = value ? words[wid] : ~words[wid];
+			if(wid == from / 64){
+				word &= ~uint64_t(0) << (from % 64);
+			}
+			if(word == 0u){
+				continue;
+			}
+			// Isolate and locate the lowest bit.
+			word &= ~word + 1u;
+			size_t bid = 0;
+			for(size_t shift = 32; shift != 0; shift /= 2){
+				if((word >> shift) != 0u){
+					word >>= shift;
+					bid += shift;
+				}
+			}
+			return wid * 64 + bid;
+		}
+		return wordCount * 64;
+	}
+
+	// Replace the cache if it was filled for another definition or other fixed arguments.
+	template<typename Cache>
+	std::shared_ptr<Cache> validCache(std::shared_ptr<Cache>& cache, uint64_t version, const std::vector<double>& args){
+		if(!cache || cache->version != version || cache->args != args){
+			cache = std::make_shared<Cache>();
+			cache->version = version;
+			cache->args = args;
+		}
+		return cache;
+	}
+
+}
+
+void Grapher::startJob(const FunctionGraph& graph, Calculator& calculator){
+	// Jobs use their own copy of the definitions, as the calculator can be modified while they run.
+	if(!_snapshot || _snapshotVersion != calculator.version()){
+		_snapshot = calculator.snapshot();
+		_snapshotVersion = calculator.version();
+	}
+
+	std::shared_ptr<GraphJob>& job = _jobs[graph.name];
+	if(job){
+		job->cancelled = true;
+	}
+	job = std::make_shared<GraphJob>();
+	job->calculator = _snapshot;
+	job->name = graph.name;
+	job->args = graph.args;
+	job->type = graph.type;
+	job->rect = _currentRect;
+	job->plotSize = _plotSize;
+	job->sampleCount = size_t(_sampleCount);
+
+	// Samples stay valid as long as the definition and the fixed arguments don't change.
+	std::vector<double> args;
+	args.reserve(graph.args.size());
+	for(const Value& arg : graph.args){
+		args.push_back(arg.f);
+	}
+	if(graph.type == FunctionGraph::Type::FUNCTION){
+		job->cache = validCache(_caches[graph.name], _snapshotVersion, args);
+	} else if(graph.type == FunctionGraph::Type::DOMAIN){
+		job->tileCache = validCache(_tileCaches[graph.name], _snapshotVersion, args);
+	}
+
+	_pool.submit([this, job](){
+		runJob(*job);
+	});
+}
+
+void Grapher::runJob(GraphJob& job){
+	// The first arguments vary with the samples, the others are broadcast.
+	std::vector<Column> columns;
+	columns.reserve(job.args.size());
+	for(const Value& arg : job.args){
+		columns.emplace_back(arg);
+	}
+
+	// Quickly show a coarse version first, if the final one is dense enough.
+	std::vector<size_t> levels;
+	const size_t coarseCount = job.sampleCount / COARSE_SAMPLING_DIVISOR;
+	if(coarseCount >= COARSE_SAMPLING_MIN){
+		levels.push_back(coarseCount);
+	}
+	levels.push_back(job.sampleCount);
+
+	const size_t levelCount = levels.size();
+	for(size_t lid = 0; lid < levelCount; ++lid){
+		if(job.cancelled){
+			return;
+		}
+		bool success = false;
+		if(job.type == FunctionGraph::Type::FUNCTION){
+			// The coarse version of a curve is not refined.
+			success = sampleCurve(job, columns, levels[lid], lid + 1 == levelCount);
+		} else if(job.type == FunctionGraph::Type::DOMAIN){
+			// Same for the boundary of a domain.
+			success = sampleDomain(job, columns, levels[lid], lid + 1 == levelCount);
+		}
+		// Newer results have been requested.
+		if(job.cancelled){
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(job.mutex);
+			if(success){
+				job.results = job.values;
+				job.resultTiles = job.tiles;
+				job.resultsCount = job.valuesCount;
+			} else {
+				job.results.clear();
+				job.resultTiles.clear();
+				job.resultsCount = 0;
+			}
+			job.updated = true;
+			job.failed = !success;
+			job.finished = !success || (lid + 1 == levelCount);
+		}
+		// Wake up the interface to display the results.
+		glfwPostEmptyEvent();
+		if(!success){
+			return;
+		}
+	}
+}
+
+bool Grapher::evaluateSamples(GraphJob& job, const std::vector<Column>& columns, double* out, size_t count){
+	const size_t chunkCount = (count + SAMPLE_CHUNK_SIZE - 1) / SAMPLE_CHUNK_SIZE;
+	if(job.cancelled){
+		return false;
+	}
+	if(chunkCount <= 1){
+		return job.calculator->evaluateFunctionBatch(job.name, columns, out, count);
+	}
+	// The snapshot is not modified while sampling, each chunk is evaluated independently and written in place.
+	std::atomic<bool> failed(false);
+	_pool.parallelFor(chunkCount, [&](size_t cid){
+		if(failed || job.cancelled){
+			return;
+		}
+		const size_t first = cid * SAMPLE_CHUNK_SIZE;
+		const size_t chunkSize = std::min(SAMPLE_CHUNK_SIZE, count - first);
+		std::vector<Column> chunkColumns(columns);
+		for(Column& column : chunkColumns){
+			if(column.samples){
+				column.samples += first;
+			}
+		}
+		if(!job.calculator->evaluateFunctionBatch(job.name, chunkColumns, out + first, chunkSize)){
+			failed = true;
+		}
+	});
+	return !failed && !job.cancelled;
+}
+
+bool Grapher::evaluateCurve(GraphJob& job, std::vector<Column>& columns, const std::vector<double>& xs, std::vector<double>& ys){
+	SampleCache& cache = *job.cache;
+	const size_t count = xs.size();
+	ys.resize(count);
+	job.missIds.clear();
+	job.missXs.clear();
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		for(size_t sid = 0; sid < count; ++sid){
+			const auto sample = cache.samples.find(xs[sid]);
+			if(sample != cache.samples.end()){
+				ys[sid] = sample->second;
+			} else {
+				job.missIds.push_back(sid);
+				job.missXs.push_back(xs[sid]);
+			}
+		}
+	}
+	const size_t missCount = job.missXs.size();
+	if(missCount == 0){
+		return true;
+	}
+
+	job.missYs.resize(missCount);
+	if(!columns.empty()){
+		columns[0] = Column(job.missXs.data());
+	}
+	if(!evaluateSamples(job, columns, job.missYs.data(), missCount)){
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	if(cache.samples.size() + missCount > SAMPLE_CACHE_CAPACITY){
+		// Keep the samples that are visible, or everything if not enough.
+		for(auto sample = cache.samples.begin(); sample != cache.samples.end();){
+			if(sample->first < job.rect.X.Min || sample->first > job.rect.X.Max){
+				sample = cache.samples.erase(sample);
+			} else {
+				++sample;
+			}
+		}
+		if(cache.samples.size() + missCount > SAMPLE_CACHE_CAPACITY){
+			cache.samples.clear();
+		}
+	}
+	for(size_t mid = 0; mid < missCount; ++mid){
+		ys[job.missIds[mid]] = job.missYs[mid];
+		cache.samples[job.missXs[mid]] = job.missYs[mid];
+	}
+	return true;
+}
+
+bool Grapher::sampleCurve(GraphJob& job, std::vector<Column>& columns, size_t sampleCount, bool refine){
+	const double minX = job.rect.X.Min;
+	const double width = job.rect.X.Max - job.rect.X.Min;
+	const double pixelsPerUnitX = double(job.plotSize.x) / width;
+
+	// Start from a coarse uniform sampling covering the view. Samples are taken on a lattice with a power-of-two
+	// step, and midpoints fall on finer ones, so that the same abscissas come back after panning or zooming.
+	const size_t minCoarseCount = std::max(size_t(16), sampleCount / 8);
+	const double step = std::exp2(std::floor(std::log2(width / double(minCoarseCount))));
+	const double firstStep = std::floor(minX / step);
+	const size_t coarseCount = std::max(size_t(1), size_t(std::ceil((minX + width) / step) - firstStep));
+	job.curveXs.resize(coarseCount + 1);
+	for(size_t sid = 0; sid <= coarseCount; ++sid){
+		job.curveXs[sid] = (firstStep + double(sid)) * step;
+	}
+	if(!evaluateCurve(job, columns, job.curveXs, job.curveYs)){
+		return false;
+	}
+
+	// Bisect intervals whose midpoint is off the segment between their bounds on screen,
+	// down to a fraction of a pixel. All midpoints of a pass are evaluated at once.
+	job.curveRefine.assign(coarseCount, refine ? 1 : 0);
+	while(true){
+		const size_t intervalCount = job.curveXs.size() - 1;
+		job.curveMidXs.clear();
+		for(size_t iid = 0; iid < intervalCount; ++iid){
+			if(!job.curveRefine[iid]){
+				continue;
+			}
+			if((job.curveXs[iid + 1] - job.curveXs[iid]) * pixelsPerUnitX < CURVE_MIN_STEP){
+				job.curveRefine[iid] = 0;
+				continue;
+			}
+			job.curveMidXs.push_back(0.5 * (job.curveXs[iid] + job.curveXs[iid + 1]));
+		}
+		if(job.curveMidXs.empty()){
+			break;
+		}
+		if(!evaluateCurve(job, columns, job.curveMidXs, job.curveMidYs)){
+			return false;
+		}
+
+		// Insert the midpoints, both halves of a non-linear interval will be tested again.
+		job.curveMergedXs.clear();
+		job.curveMergedYs.clear();
+		job.curveMergedRefine.clear();
+		size_t mid = 0;
+		for(size_t iid = 0; iid < intervalCount; ++iid){
+			job.curveMergedXs.push_back(job.curveXs[iid]);
+			job.curveMergedYs.push_back(job.curveYs[iid]);
+			if(!job.curveRefine[iid]){
+				job.curveMergedRefine.push_back(0);
+				continue;
+			}
+			const double xm = job.curveMidXs[mid];
+			const double ym = job.curveMidYs[mid];
+			++mid;
+			const char refine = curveDeviates(job, job.curveXs[iid], job.curveYs[iid], xm, ym, job.curveXs[iid + 1], job.curveYs[iid + 1]) ? 1 : 0;
+			job.curveMergedXs.push_back(xm);
+			job.curveMergedYs.push_back(ym);
+			job.curveMergedRefine.push_back(refine);
+			job.curveMergedRefine.push_back(refine);
+		}
+		job.curveMergedXs.push_back(job.curveXs.back());
+		job.curveMergedYs.push_back(job.curveYs.back());
+		std::swap(job.curveXs, job.curveMergedXs);
+		std::swap(job.curveYs, job.curveMergedYs);
+		std::swap(job.curveRefine, job.curveMergedRefine);
+
+		// A midpoint can fall on the segment by chance (oscillations aliased by the coarse sampling),
+		// also refine around samples that are off the segment between their neighbours.
+		const size_t sampleCount = job.curveXs.size();
+		for(size_t sid = 1; sid + 1 < sampleCount; ++sid){
+			if(curveDeviates(job, job.curveXs[sid - 1], job.curveYs[sid - 1], job.curveXs[sid], job.curveYs[sid], job.curveXs[sid + 1], job.curveYs[sid + 1])){
+				job.curveRefine[sid - 1] = 1;
+				job.curveRefine[sid] = 1;
+			}
+		}
+	}
+
+	// Interleave positions and values.
+	const size_t finalCount = job.curveXs.size();
+	job.values.resize(2 * finalCount);
+	for(size_t sid = 0; sid < finalCount; ++sid){
+		job.values[2 * sid] = job.curveXs[sid];
+		job.values[2 * sid + 1] = job.curveYs[sid];
+	}
+	job.valuesCount = finalCount;
+	return true;
+}
+
+bool Grapher::curveDeviates(const GraphJob& job, double xa, double ya, double xm, double ym, double xb, double yb){
+	// Refine around the bounds of the function domain.
+	const bool finiteA = std::isfinite(ya);
+	const bool finiteM = std::isfinite(ym);
+	const bool finiteB = std::isfinite(yb);
+	if(!finiteA || !finiteM || !finiteB){
+		return finiteA != finiteM || finiteM != finiteB;
+	}
+	// Skip parts of the curve above or below the view.
+	const double minY = job.rect.Y.Min;
+	const double maxY = job.rect.Y.Max;
+	if((ya > maxY && ym > maxY && yb > maxY) || (ya < minY && ym < minY && yb < minY)){
+		return false;
+	}
+	// Distance in pixels from the midpoint to the segment.
+	const double pixelsPerUnitX = double(job.plotSize.x) / (job.rect.X.Max - job.rect.X.Min);
+	const double pixelsPerUnitY = double(job.plotSize.y) / (maxY - minY);
+	const double dx = (xb - xa) * pixelsPerUnitX;
+	const double dy = (yb - ya) * pixelsPerUnitY;
+	const double mx = (xm - xa) * pixelsPerUnitX;
+	const double my = (ym - ya) * pixelsPerUnitY;
+	const double length = std::sqrt(dx * dx + dy * dy);
+	return std::abs(dx * my - dy * mx) > CURVE_TOLERANCE * length;
+}
+
+bool Grapher::sampleDomain(GraphJob& job, const std::vector<Column>& columns, size_t sampleCount, bool refine){
+	job.tiles.clear();
+	job.values.clear();
+	job.valuesCount = 0;
+	const ImPlotRect& rect = job.rect;
+
+	// Samples are spaced by the power of two closest to the requested resolution, and grouped in tiles aligned
+	// in world space, so that tiles are found again after panning or zooming.
+	const int level = int(std::round(std::log2((rect.X.Max - rect.X.Min) / double(sampleCount))));
+	const double tileSize = std::ldexp(double(DOMAIN_TILE_SIZE), level);
+	const double minX = std::floor(rect.X.Min / tileSize);
+	const double maxX = std::floor(rect.X.Max / tileSize);
+	const double minY = std::floor(rect.Y.Min / tileSize);
+	const double maxY = std::floor(rect.Y.Max / tileSize);
+	// Far from the origin relative to the view size, samples can't be distinguished anyway.
+	const double maxTileIndex = std::ldexp(1.0, 52);
+	if(std::max(std::abs(minX), std::abs(maxX)) > maxTileIndex || std::max(std::abs(minY), std::abs(maxY)) > maxTileIndex){
+		return true;
+	}
+
+	job.tileKeys.clear();
+	for(long long y = (long long)minY; y <= (long long)maxY; ++y){
+		for(long long x = (long long)minX; x <= (long long)maxX; ++x){
+			job.tileKeys.push_back({ level, x, y });
+		}
+	}
+	const size_t tileCount = job.tileKeys.size();
+	job.tiles.assign(tileCount, nullptr);
+	job.missingTiles.clear();
+	TileCache& cache = *job.tileCache;
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		for(size_t tid = 0; tid < tileCount; ++tid){
+			job.tiles[tid] = cache.find(job.tileKeys[tid]);
+			if(!job.tiles[tid]){
+				job.missingTiles.push_back(tid);
+			}
+		}
+	}
+
+	// Evaluate missing tiles in parallel.
+	std::atomic<bool> failed(false);
+	_pool.parallelFor(job.missingTiles.size(), [&](size_t mid){
+		if(failed || job.cancelled){
+			return;
+		}
+		const size_t tid = job.missingTiles[mid];
+		job.tiles[tid] = sampleTile(job, columns, job.tileKeys[tid]);
+		if(!job.tiles[tid]){
+			failed = true;
+		}
+	});
+	if(failed || job.cancelled){
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		for(size_t tid : job.missingTiles){
+			cache.insert(job.tileKeys[tid], job.tiles[tid]);
+		}
+	}
+
+	if(!traceDomain(job, columns, size_t(maxX - minX) + 1, size_t(maxY - minY) + 1, refine)){
+		return false;
+	}
+
+	// Only keep the tiles with samples in the domain.
+	const auto firstEmpty = std::remove_if(job.tiles.begin(), job.tiles.end(), [](const std::shared_ptr<const DomainTile>& tile){
+		return tile->bits.empty() && !tile->uniformValue;
+	});
+	job.tiles.erase(firstEmpty, job.tiles.end());
+	return true;
+}
+
+bool Grapher::traceDomain(GraphJob& job, const std::vector<Column>& columns, size_t tileCountX, size_t tileCountY, bool refine){
+	const TileKey& firstKey = job.tileKeys[0];
+	const double spacing = std::ldexp(1.0, firstKey.level);
+	const double originX = double(firstKey.x) * double(DOMAIN_TILE_SIZE) * spacing;
+	const double originY = double(firstKey.y) * double(DOMAIN_TILE_SIZE) * spacing;
+	const size_t wordsPerRow = DOMAIN_TILE_SIZE / 64;
+	const size_t sizeX = tileCountX * DOMAIN_TILE_SIZE;
+	const size_t sizeY = tileCountY * DOMAIN_TILE_SIZE;
+	const size_t wordCountX = tileCountX * wordsPerRow;
+
+	// The tiles form a grid of samples, read 64 at a time along rows.
+	auto rowWord = [&job, tileCountX, wordsPerRow](size_t row, size_t wid){
+		const DomainTile& tile = *job.tiles[(row / DOMAIN_TILE_SIZE) * tileCountX + wid / wordsPerRow];
+		if(tile.bits.empty()){
+			return tile.uniformValue ? ~uint64_t(0) : uint64_t(0);
+		}
+		return tile.bits[(row % DOMAIN_TILE_SIZE) * wordsPerRow + wid % wordsPerRow];
+	};
+	auto inDomain = [&rowWord](size_t sid, size_t row){
+		return ((rowWord(row, sid / 64) >> (sid % 64)) & 1u) != 0u;
+	};
+
+	// Points where the boundary crosses an edge between two samples, between the ends in and out of the domain.
+	struct Crossing {
+		double inX, inY;
+		double outX, outY;
+	};
+	std::vector<Crossing> crossings;
+	std::unordered_map<uint64_t, size_t> crossingIds;
+	// Crossings are connected to at most two others, one in each cell sharing their edge.
+	const size_t noLink = std::numeric_limits<size_t>::max();
+	std::vector<size_t> links;
+
+	// Edges are identified by their first sample and their direction.
+	auto crossing = [&](size_t sid0, size_t row0, size_t sid1, size_t row1){
+		const uint64_t edge = (uint64_t(row0) * sizeX + sid0) * 2u + (sid0 == sid1 ? 1u : 0u);
+		const auto it = crossingIds.find(edge);
+		if(it != crossingIds.end()){
+			return it->second;
+		}
+		const double x0 = originX + (double(sid0) + 0.5) * spacing;
+		const double y0 = originY + (double(row0) + 0.5) * spacing;
+		const double x1 = originX + (double(sid1) + 0.5) * spacing;
+		const double y1 = originY + (double(row1) + 0.5) * spacing;
+		if(inDomain(sid0, row0)){
+			crossings.push_back({ x0, y0, x1, y1 });
+		} else {
+			crossings.push_back({ x1, y1, x0, y0 });
+		}
+		links.push_back(noLink);
+		links.push_back(noLink);
+		const size_t id = crossings.size() - 1;
+		crossingIds[edge] = id;
+		return id;
+	};
+	auto connect = [&links, noLink](size_t a, size_t b){
+		links[2 * a + (links[2 * a] == noLink ? 0 : 1)] = b;
+		links[2 * b + (links[2 * b] == noLink ? 0 : 1)] = a;
+	};
+
+	// Marching squares, only on the cells whose corners differ.
+	for(size_t row = 0; row + 1 < sizeY; ++row){
+		for(size_t wid = 0; wid < wordCountX; ++wid){
+			const bool last = wid + 1 == wordCountX;
+			const uint64_t bottom = rowWord(row, wid);
+			const uint64_t top = rowWord(row + 1, wid);
+			const uint64_t bottomRight = (bottom >> 1u) | (last ? 0u : rowWord(row, wid + 1) << 63u);
+			const uint64_t topRight = (top >> 1u) | (last ? 0u : rowWord(row + 1, wid + 1) << 63u);
+			uint64_t mixed = (bottom ^ top) | (bottom ^ bottomRight) | (bottom ^ topRight);
+			// The last sample of the grid has no cell on its right.
+			if(last){
+				mixed &= ~(uint64_t(1) << 63u);
+			}
+			size_t bid = findBit(&mixed, 1, 0, true);
+			while(bid < 64){
+				const size_t sid = wid * 64 + bid;
+				const bool in00 = inDomain(sid, row);
+				const bool in10 = inDomain(sid + 1, row);
+				const bool in01 = inDomain(sid, row + 1);
+				const bool in11 = inDomain(sid + 1, row + 1);
+				// Crossed edges, counterclockwise from the bottom one.
+				size_t ids[4];
+				size_t idCount = 0;
+				if(in00 != in10){
+					ids[idCount++] = crossing(sid, row, sid + 1, row);
+				}
+				if(in10 != in11){
+					ids[idCount++] = crossing(sid + 1, row, sid + 1, row + 1);
+				}
+				if(in01 != in11){
+					ids[idCount++] = crossing(sid, row + 1, sid + 1, row + 1);
+				}
+				if(in00 != in01){
+					ids[idCount++] = crossing(sid, row, sid, row + 1);
+				}
+				if(idCount == 2){
+					connect(ids[0], ids[1]);
+				} else if(idCount == 4){
+					// Saddle, the corners in the domain are kept apart.
+					if(in00){
+						connect(ids[0], ids[3]);
+						connect(ids[1], ids[2]);
+					} else {
+						connect(ids[0], ids[1]);
+						connect(ids[2], ids[3]);
+					}
+				}
+				bid = findBit(&mixed, 1, bid + 1, true);
+			}
+		}
+	}
+	const size_t crossingCount = crossings.size();
+
+	// Locate the boundary on each edge by bisection, until it is precise enough on screen.
+	if(refine && crossingCount != 0){
+		const double pixelSizeX = (job.rect.X.Max - job.rect.X.Min) / double(job.plotSize.x);
+		const double pixelSizeY = (job.rect.Y.Max - job.rect.Y.Min) / double(job.plotSize.y);
+		const double tolerance = CONTOUR_TOLERANCE * std::min(pixelSizeX, pixelSizeY);
+		size_t bisectionCount = 0;
+		for(double step = spacing; step > tolerance && bisectionCount < CONTOUR_MAX_BISECTIONS; step *= 0.5){
+			++bisectionCount;
+		}
+
+		const size_t argCount = columns.size();
+		std::vector<double> xs(crossingCount);
+		std::vector<double> ys(crossingCount);
+		std::vector<double> tests(crossingCount);
+		std::vector<Column> crossingColumns(columns);
+		if(argCount != 0){
+			crossingColumns[0] = Column(xs.data());
+		}
+		if(argCount > 1){
+			crossingColumns[1] = Column(ys.data());
+		}
+		for(size_t iid = 0; iid < bisectionCount; ++iid){
+			for(size_t cid = 0; cid < crossingCount; ++cid){
+				const Crossing& point = crossings[cid];
+				xs[cid] = 0.5 * (point.inX + point.outX);
+				ys[cid] = 0.5 * (point.inY + point.outY);
+			}
+			if(!evaluateSamples(job, crossingColumns, tests.data(), crossingCount)){
+				return false;
+			}
+			for(size_t cid = 0; cid < crossingCount; ++cid){
+				Crossing& point = crossings[cid];
+				if(tests[cid] != 0.0){
+					point.inX = xs[cid];
+					point.inY = ys[cid];
+				} else {
+					point.outX = xs[cid];
+					point.outY = ys[cid];
+				}
+			}
+		}
+	}
+
+	// Chain the crossings into polylines, open ones starting from the border of the grid first.
+	std::vector<char> visited(crossingCount, 0);
+	auto addPoint = [&job](double x, double y){
+		job.values.push_back(x);
+		job.values.push_back(y);
+		++job.valuesCount;
+	};
+	auto addPolyline = [&](size_t start){
+		size_t previous = noLink;
+		size_t current = start;
+		while(current != noLink && !visited[current]){
+			visited[current] = 1;
+			const Crossing& point = crossings[current];
+			addPoint(0.5 * (point.inX + point.outX), 0.5 * (point.inY + point.outY));
+			const size_t next = links[2 * current] != previous ? links[2 * current] : links[2 * current + 1];
+			previous = current;
+			current = next;
+		}
+		// Close loops.
+		if(current == start){
+			const Crossing& point = crossings[start];
+			addPoint(0.5 * (point.inX + point.outX), 0.5 * (point.inY + point.outY));
+		}
+		addPoint(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+	};
+	for(size_t cid = 0; cid < crossingCount; ++cid){
+		if(!visited[cid] && links[2 * cid + 1] == noLink){
+			addPolyline(cid);
+		}
+	}
+	for(size_t cid = 0; cid < crossingCount; ++cid){
+		if(!visited[cid]){
+			addPolyline(cid);
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<const DomainTile> Grapher::sampleTile(const GraphJob& job, const std::vector<Column>& columns, const TileKey& key){
+	const size_t argCount = columns.size();
+	const double spacing = std::ldexp(1.0, key.level);
+	const double originX = double(key.x) * double(DOMAIN_TILE_SIZE) * spacing;
+	const double originY = double(key.y) * double(DOMAIN_TILE_SIZE) * spacing;
+	auto sampleX = [originX, spacing](size_t sid){
+		return originX + (double(sid) + 0.5) * spacing;
+	};
+	auto sampleY = [originY, spacing](size_t tid){
+		return originY + (double(tid) + 0.5) * spacing;
+	};
+
+	std::shared_ptr<DomainTile> tile = std::make_shared<DomainTile>();
+	tile->key = key;
+	const size_t wordsPerRow = DOMAIN_TILE_SIZE / 64;
+	tile->bits.assign(DOMAIN_TILE_SIZE * wordsPerRow, 0u);
+	auto setBlock = [&tile, wordsPerRow](const SampleBlock& block){
+		for(size_t tid = block.y0; tid < block.y1; ++tid){
+			for(size_t sid = block.x0; sid < block.x1; ++sid){
+				tile->bits[tid * wordsPerRow + sid / 64] |= uint64_t(1) << (sid % 64);
+			}
+		}
+	};
+
+	// Bound the test over whole blocks of samples, and only subdivide the blocks where it varies.
+	// Uniform regions are classified at once, and thin features can't fall between samples.
+	std::vector<Interval> ranges(argCount);
+	for(size_t aid = 2; aid < argCount; ++aid){
+		ranges[aid] = Interval(columns[aid].value);
+	}
+	auto bound = [&](const SampleBlock& block, Interval::Truth& truth){
+		if(argCount != 0){
+			ranges[0] = Interval(sampleX(block.x0), sampleX(block.x1 - 1));
+		}
+		if(argCount > 1){
+			ranges[1] = Interval(sampleY(block.y0), sampleY(block.y1 - 1));
+		}
+		Interval result;
+		if(!job.calculator->evaluateFunctionInterval(job.name, ranges, result)){
+			return false;
+		}
+		truth = result.truth();
+		return true;
+	};
+
+	// Split a block into blocks of step x step samples, evaluated at their first sample.
+	std::vector<SampleBlock> leaves;
+	auto sampleBlock = [&leaves](const SampleBlock& block, size_t step){
+		for(size_t sid = block.x0; sid < block.x1; sid += step){
+			for(size_t tid = block.y0; tid < block.y1; tid += step){
+				leaves.push_back({ sid, tid, std::min(sid + step, block.x1), std::min(tid + step, block.y1) });
+			}
+		}
+	};
+
+	std::vector<SampleBlock> blocks;
+	blocks.push_back({ 0, 0, DOMAIN_TILE_SIZE, DOMAIN_TILE_SIZE });
+	while(!blocks.empty()){
+		const SampleBlock block = blocks.back();
+		blocks.pop_back();
+
+		Interval::Truth truth = Interval::Truth::UNKNOWN;
+		const bool bounded = bound(block, truth);
+		if(truth == Interval::Truth::TRUE){
+			setBlock(block);
+			continue;
+		}
+		if(truth == Interval::Truth::FALSE){
+			continue;
+		}
+		const size_t sizeBlockX = block.x1 - block.x0;
+		const size_t sizeBlockY = block.y1 - block.y0;
+		// Small blocks are cheaper to sample than to subdivide further. Where the test can't be bounded
+		// (unsupported functions), subdivision stops earlier and every other point is sampled.
+		const size_t leafSize = bounded ? DOMAIN_LEAF_SIZE : DOMAIN_UNBOUNDED_LEAF_SIZE;
+		if(sizeBlockX <= leafSize && sizeBlockY <= leafSize){
+			sampleBlock(block, bounded ? 1 : 2);
+			continue;
+		}
+		const size_t midX = block.x0 + sizeBlockX / 2;
+		const size_t midY = block.y0 + sizeBlockY / 2;
+		blocks.push_back({ block.x0, block.y0, midX, midY });
+		blocks.push_back({ midX, block.y0, block.x1, midY });
+		blocks.push_back({ block.x0, midY, midX, block.y1 });
+		blocks.push_back({ midX, midY, block.x1, block.y1 });
+	}
+
+	// Evaluate the first sample of each remaining block.
+	const size_t leafCount = leaves.size();
+	if(leafCount != 0){
+		std::vector<double> xs(leafCount);
+		std::vector<double> ys(leafCount);
+		std::vector<double> tests(leafCount);
+		for(size_t lid = 0; lid < leafCount; ++lid){
+			xs[lid] = sampleX(leaves[lid].x0);
+			ys[lid] = sampleY(leaves[lid].y0);
+		}
+		std::vector<Column> leafColumns(columns);
+		if(argCount != 0){
+			leafColumns[0] = Column(xs.data());
+		}
+		if(argCount > 1){
+			leafColumns[1] = Column(ys.data());
+		}
+		if(!job.calculator->evaluateFunctionBatch(job.name, leafColumns, tests.data(), leafCount)){
+			return nullptr;
+		}
+		for(size_t lid = 0; lid < leafCount; ++lid){
+			if(tests[lid] != 0.0){
+				setBlock(leaves[lid]);
+			}
+		}
+	}
+
+	// Tiles entirely inside or outside of the domain don't need their samples.
+	const bool allFalse = std::all_of(tile->bits.begin(), tile->bits.end(), [](uint64_t word){ return word == 0u; });
+	const bool allTrue = std::all_of(tile->bits.begin(), tile->bits.end(), [](uint64_t word){ return word == ~uint64_t(0); });
+	if(allFalse || allTrue){
+		tile->bits.clear();
+		tile->uniformValue = allTrue;
+	}
+	return tile;
+}
+
+void Grapher::drawDomain(const FunctionGraph& graph, ImU32 color){
+	ImDrawList* drawList = ImPlot::GetPlotDrawList();
+	// Spans extend half a sample step around the samples.
+	auto addSpan = [drawList, color](const TileKey& key, size_t x0, size_t y0, size_t x1, size_t y1){
+		const double spacing = std::ldexp(1.0, key.level);
+		const double originX = double(key.x) * double(DOMAIN_TILE_SIZE) * spacing;
+		const double originY = double(key.y) * double(DOMAIN_TILE_SIZE) * spacing;
+		const ImVec2 min = ImPlot::PlotToPixels(originX + double(x0) * spacing, originY + double(y1) * spacing);
+		const ImVec2 max = ImPlot::PlotToPixels(originX + double(x1) * spacing, originY + double(y0) * spacing);
+		drawList->AddRectFilled(min, max, color);
+	};
+
+	const size_t wordsPerRow = DOMAIN_TILE_SIZE / 64;
+	const size_t tileCount = graph.tiles.size();
+	size_t tid = 0;
+	while(tid < tileCount){
+		const DomainTile& tile = *graph.tiles[tid];
+		const TileKey& key = tile.key;
+		if(tile.bits.empty()){
+			// Uniform tiles next to each other on a row are filled at once.
+			size_t end = tid + 1;
+			while(end < tileCount){
+				const DomainTile& next = *graph.tiles[end];
+				if(!next.bits.empty() || next.key.level != key.level || next.key.y != key.y || next.key.x != key.x + (long long)(end - tid)){
+					break;
+				}
+				++end;
+			}
+			addSpan(key, 0, 0, (end - tid) * DOMAIN_TILE_SIZE, DOMAIN_TILE_SIZE);
+			tid = end;
+			continue;
+		}
+
+		size_t row = 0;
+		while(row < DOMAIN_TILE_SIZE){
+			const uint64_t* words = &tile.bits[row * wordsPerRow];
+			// Identical rows following each other are filled at once.
+			size_t rowEnd = row + 1;
+			while(rowEnd < DOMAIN_TILE_SIZE && std::equal(words, words + wordsPerRow, &tile.bits[rowEnd * wordsPerRow])){
+				++rowEnd;
+			}
+			// One span for each run of samples in the domain.
+			size_t sid = findBit(words, wordsPerRow, 0, true);
+			while(sid < DOMAIN_TILE_SIZE){
+				const size_t end = findBit(words, wordsPerRow, sid, false);
+				addSpan(key, sid, row, end, rowEnd);
+				sid = findBit(words, wordsPerRow, end, true);
+			}
+			row = rowEnd;
+		}
+		++tid;
+	}
+}
+
+size_t TileKeyHash::operator()(const TileKey& key) const {
+	size_t hash = std::hash<long long>()(key.x);
+	hash ^= std::hash<long long>()(key.y) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<int>()(key.level) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+std::shared_ptr<const DomainTile> Grapher::TileCache::find(const TileKey& key){
+	const auto it = index.find(key);
+	if(it == index.end()){
+		return nullptr;
+	}
+	tiles.splice(tiles.begin(), tiles, it->second);
+	return it->second->second;
+}
+
+void Grapher::TileCache::insert(const TileKey& key, const std::shared_ptr<const DomainTile>& tile){
+	// Another job might have computed the same tile.
+	const auto it = index.find(key);
+	if(it != index.end()){
+		tiles.splice(tiles.begin(), tiles, it->second);
+		return;
+	}
+	if(tiles.size() >= DOMAIN_TILE_BUDGET){
+		index.erase(tiles.back().first);
+		tiles.pop_back();
+	}
+	tiles.emplace_front(key, tile);
+	index[key] = tiles.begin();
+}
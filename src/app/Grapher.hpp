@@ -1,19 +1,50 @@
 #pragma once
 #include "core/Common.hpp"
 #include "core/Calculator.hpp"
+#include "core/ThreadPool.hpp"
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
 #include <imgui/imgui.h>
 #include <implot/implot.h>
 
 #undef DOMAIN
 
+// Tile of a domain graph: square of Grapher::DOMAIN_TILE_SIZE^2 samples, spaced by 2^level in world space, at (x, y) in tile units.
+struct TileKey {
+	int level;
+	long long x, y;
+
+	bool operator==(const TileKey& other) const {
+		return level == other.level && x == other.x && y == other.y;
+	}
+};
+
+struct TileKeyHash {
+	size_t operator()(const TileKey& key) const;
+};
+
+// Results of the domain test on the samples of a tile.
+struct DomainTile {
+	TileKey key;
+	// One bit per sample, row by row. Empty if all samples have the same value.
+	std::vector<uint64_t> bits;
+	bool uniformValue = false;
+};
+
 struct FunctionGraph {
 
 	enum class Type {
 		FUNCTION, DOMAIN
 	};
 
+	// Samples of a function, or boundary of a domain, as (x, y) pairs. Polylines are separated by NaNs.
 	std::vector<double> values;
+	// Domains: tiles containing samples in the domain, row by row, shared with the cache.
+	std::vector<std::shared_ptr<const DomainTile>> tiles;
 	std::vector<Value> args;
 	std::vector<glm::vec2> argsRanges;
 	std::string name;
@@ -33,22 +64,169 @@ class Grapher {
 
 public:
 
+	~Grapher();
+
 	FunctionGraph& addOrUpdateFunction(const std::string& name, const Documentation::Function& func);
 
+	// Sample again the graph of a function recomputed with the same arguments, keeping its settings.
+	void refreshFunction(const std::string& name, Calculator& calculator);
+
 	void clear();
 	
 	bool display(Calculator& calculator);
 
 private:
 
-	std::vector<double> _xs;
-	std::vector<double> _ys;
+	// Range of samples [x0, x1) x [y0, y1).
+	struct SampleBlock {
+		size_t x0, y0, x1, y1;
+	};
+
+	/** Samples of a curve already evaluated, by abscissa. Curves are sampled on power-of-two lattices in world space,
+	 so that most samples are found again after panning or zooming. Valid for a definition and fixed arguments. */
+	struct SampleCache {
+		uint64_t version = 0;
+		std::vector<double> args;
+		// Guarded by the mutex, a cancelled job can still be running.
+		std::mutex mutex;
+		std::unordered_map<double, double> samples;
+	};
+
+	/** Tiles of a domain graph already evaluated, at all levels of detail. The least recently used tile is evicted
+	 once the budget is reached. Valid for a definition and fixed arguments. */
+	struct TileCache {
+
+		// Both must be called with the mutex locked. Returns nullptr if the tile is not known.
+		std::shared_ptr<const DomainTile> find(const TileKey& key);
+
+		void insert(const TileKey& key, const std::shared_ptr<const DomainTile>& tile);
+
+		using Tiles = std::list<std::pair<TileKey, std::shared_ptr<const DomainTile>>>;
+
+		uint64_t version = 0;
+		std::vector<double> args;
+		// Guarded by the mutex, a cancelled job can still be running. Most recently used first.
+		std::mutex mutex;
+		Tiles tiles;
+		std::unordered_map<TileKey, Tiles::iterator, TileKeyHash> index;
+	};
+
+	/** Sampling of a graph in the background, for the view at the time of the request. Results are published
+	 at a coarse resolution first, then at the requested one. The job stops early once cancelled. */
+	struct GraphJob {
+		// Request, constant once the job is started.
+		std::shared_ptr<Calculator> calculator;
+		std::string name;
+		std::vector<Value> args;
+		FunctionGraph::Type type = FunctionGraph::Type::FUNCTION;
+		ImPlotRect rect;
+		ImVec2 plotSize;
+		size_t sampleCount = 0;
+		std::shared_ptr<SampleCache> cache;
+		std::shared_ptr<TileCache> tileCache;
+		std::atomic<bool> cancelled{false};
+
+		// Samples of the current resolution.
+		std::vector<double> values;
+		size_t valuesCount = 0;
+		std::vector<TileKey> tileKeys;
+		std::vector<std::shared_ptr<const DomainTile>> tiles;
+		std::vector<size_t> missingTiles;
+		std::vector<double> curveXs;
+		std::vector<double> curveYs;
+		std::vector<double> curveMidXs;
+		std::vector<double> curveMidYs;
+		std::vector<double> curveMergedXs;
+		std::vector<double> curveMergedYs;
+		std::vector<char> curveRefine;
+		std::vector<char> curveMergedRefine;
+		std::vector<size_t> missIds;
+		std::vector<double> missXs;
+		std::vector<double> missYs;
+
+		// Last published results, guarded by the mutex.
+		std::mutex mutex;
+		std::vector<double> results;
+		std::vector<std::shared_ptr<const DomainTile>> resultTiles;
+		size_t resultsCount = 0;
+		bool updated = false;
+		bool failed = false;
+		bool finished = false;
+	};
+
+	// Blocks of at most this size are sampled instead of being subdivided.
+	static constexpr size_t DOMAIN_LEAF_SIZE = 4;
+	static constexpr size_t DOMAIN_UNBOUNDED_LEAF_SIZE = 32;
+
+	// Samples along each side of a domain tile, a multiple of 64.
+	static constexpr size_t DOMAIN_TILE_SIZE = 64;
+	// Tiles kept for each domain graph, about 600 bytes each at most.
+	static constexpr size_t DOMAIN_TILE_BUDGET = 8192;
+
+	// Samples evaluated by each task of the thread pool.
+	static constexpr size_t SAMPLE_CHUNK_SIZE = 512;
+
+	// Resolution of the first results of a job, relative to the requested one.
+	static constexpr size_t COARSE_SAMPLING_DIVISOR = 4;
+	static constexpr size_t COARSE_SAMPLING_MIN = 32;
+
+	// Beyond this number of samples, cached samples outside of the view are discarded.
+	static constexpr size_t SAMPLE_CACHE_CAPACITY = 1u << 20u;
+
+	// Minimal distance in pixels between the curve and a segment of its samples.
+	static constexpr double CURVE_TOLERANCE = 0.5;
+	// Intervals narrower than this in pixels are not subdivided.
+	static constexpr double CURVE_MIN_STEP = 0.25;
+
+	// Precision in pixels of the boundary of domains.
+	static constexpr double CONTOUR_TOLERANCE = 0.25;
+	static constexpr size_t CONTOUR_MAX_BISECTIONS = 20;
+
+	// Cancel the current job of the graph if any, and sample it again in the background.
+	void startJob(const FunctionGraph& graph, Calculator& calculator);
+
+	void runJob(GraphJob& job);
+
+	// Evaluate a function on count samples, split in chunks between threads. Returns false if the evaluation failed or was cancelled.
+	bool evaluateSamples(GraphJob& job, const std::vector<Column>& columns, double* out, size_t count);
+
+	// Evaluate a curve at the given abscissas, only the ones not in the cache are computed. Returns false if the evaluation failed or was cancelled.
+	bool evaluateCurve(GraphJob& job, std::vector<Column>& columns, const std::vector<double>& xs, std::vector<double>& ys);
+
+	// Sample a function more densely where it is not linear on screen if refine is set, returns false if the evaluation failed.
+	bool sampleCurve(GraphJob& job, std::vector<Column>& columns, size_t sampleCount, bool refine);
+
+	static bool curveDeviates(const GraphJob& job, double xa, double ya, double xm, double ym, double xb, double yb);
+
+	// Find the tiles where a domain test is true, with about sampleCount samples horizontally, and their boundary, refined
+	// between samples if refine is set. Returns false if the evaluation failed.
+	bool sampleDomain(GraphJob& job, const std::vector<Column>& columns, size_t sampleCount, bool refine);
+
+	// Extract the boundary of a domain from a grid of tiles with marching squares, returns false if the evaluation failed.
+	bool traceDomain(GraphJob& job, const std::vector<Column>& columns, size_t tileCountX, size_t tileCountY, bool refine);
+
+	// Evaluate the domain test on a tile, returns nullptr if the evaluation failed.
+	static std::shared_ptr<const DomainTile> sampleTile(const GraphJob& job, const std::vector<Column>& columns, const TileKey& key);
+
+	// Fill the runs of samples in the domain, merging identical rows and uniform tiles.
+	static void drawDomain(const FunctionGraph& graph, ImU32 color);
+
 	std::vector<FunctionGraph> _functions;
+	// Current job and sample caches of each graph, by name.
+	std::unordered_map<std::string, std::shared_ptr<GraphJob>> _jobs;
+	std::unordered_map<std::string, std::shared_ptr<SampleCache>> _caches;
+	std::unordered_map<std::string, std::shared_ptr<TileCache>> _tileCaches;
+	// Definitions used by the jobs, copied when the calculator changes.
+	std::shared_ptr<Calculator> _snapshot;
+	uint64_t _snapshotVersion = 0;
 	ImPlotRect _currentRect = ImPlotRect(0, 1, 0, 1);
+	ImVec2 _plotSize = ImVec2(800, 600);
 	int _totalCount = 0;
 	int _sampleCount = 100;
 	bool _updateRect = true;
 	bool _hideInvalids = false;
 	bool _hideHiddens = false;
+	// Last member, so that pending jobs are completed before anything else is destroyed.
+	ThreadPool _pool;
 
 };
@@ -40,6 +40,10 @@ void UIStyle::loadFromFile(const std::string& path) {
 			format = Format(std::stoul(lineElements[1]));
 			continue;
 		}
+		if (key == "LIVE") {
+			liveMode = std::stoul(lineElements[1]) != 0;
+			continue;
+		}
 		// all other are colors
 		if (lineElements.size() < 4) {
 			Log::Error() << "Missing parameters for keyword \"" << key << "\"" << std::endl;
@@ -85,6 +89,7 @@ void UIStyle::saveToFile(const std::string& path) {
 	file << "BACKGROUND " << backgroundColor.x << " " << backgroundColor.y << " " << backgroundColor.z << "\n";
 	file << "ERROR " << errorColor.x << " " << errorColor.y << " " << errorColor.z << "\n";
 	file << "FORMAT " << (unsigned long)format << "\n";
+	file << "LIVE " << (liveMode ? 1 : 0) << "\n";
 	for (uint i = 0; i < Calculator::Word::COUNT; ++i) {
 		file << wordNames[i] << " " << wordColors[i].x << " " << wordColors[i].y << " " << wordColors[i].z << "\n";
 	}
@@ -47,6 +47,7 @@ struct UIStyle {
 	ImVec4 backgroundColor;
 	ImVec4 wordColors[Calculator::Word::COUNT];
 	Format format;
+	bool liveMode = false;
 
 	static const std::string wordNames[Calculator::Word::COUNT];
 
@@ -464,6 +464,9 @@ int main(int argc, char** argv){
 	UIState state;
 	Grapher grapher;
 	Calculator calculator;
+	// Graphs re-evaluate the same calls at each frame.
+	calculator.setMemoCapacity(256);
+	calculator.setLiveMode(style.liveMode);
 	
 	// Save/restore calculator state (save all internal state + formatted output)
 	loadStateFromFile(config.historyPath, state, calculator);
@@ -529,6 +532,9 @@ int main(int argc, char** argv){
 							updateDoc = true;
 						}
 						ImGui::PopItemWidth();
+						if(ImGui::Checkbox("Live variables", &style.liveMode)){
+							calculator.setLiveMode(style.liveMode);
+						}
 						ImGui::EndMenu();
 					}
 
@@ -678,6 +684,11 @@ int main(int argc, char** argv){
 					std::vector<Calculator::Word> wordInfos;
 					const bool success = calculator.evaluate(newLine, result, wordInfos, format, false);
 
+					// In live mode, functions depending on the new definition have changed.
+					for(const std::string& name : calculator.recomputedFunctions()){
+						grapher.refreshFunction(name, calculator);
+					}
+
 					// Put a break before any input for clarity.
 					state.lines.emplace_back(UILine::EMPTY, "");
 
@@ -696,18 +707,18 @@ int main(int argc, char** argv){
 					if(!success){
 						// Error line: passthrough the error message from the calculator.
 						// The message can be multi-lines, split it.
-						const std::vector<std::string> sublines = TextUtilities::split(result.str, "\n", false);
+						const std::vector<std::string> sublines = TextUtilities::split(result.str(), "\n", false);
 						for (const std::string& subline : sublines) {
 							state.lines.emplace_back(UILine::ISSUE, subline);
 						}
 						
 					} else if(result.type == Value::Type::STRING){
 						// This is 'function definition' specific.
-						state.lines.emplace_back( UILine::OUTPUT, result.str);
-						state.lines.back().words.emplace_back(result.str, Calculator::Word::FUNCTION);
+						state.lines.emplace_back( UILine::OUTPUT, result.str());
+						state.lines.back().words.emplace_back(result.str(), Calculator::Word::FUNCTION);
 						state.lines.back().words.emplace_back(" defined", Calculator::Word::LITERAL);
 
-						const std::string& name = result.str;
+						const std::string& name = result.str();
 						FunctionGraph& graph = grapher.addOrUpdateFunction(name, calculator.functions().at(name));
 						graph.validate(calculator);
 						// If the graph window is opened, mark the function as shown.
@@ -763,7 +774,7 @@ int main(int argc, char** argv){
 					compilationMsg = "";
 					if(!success){
 						showCompilationResult = true;
-						compilationMsg = result.str;
+						compilationMsg = result.str();
 						failedCompilation = true;
 					} else if(result.type != Value::Type::STRING){
 						showCompilationResult = true;
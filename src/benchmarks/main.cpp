@@ -0,0 +1,104 @@
+#include "core/Common.hpp"
+#include "core/Calculator.hpp"
+#include "core/Evaluator.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+/** Cost of creating, copying and operating on values, in the evaluator and in compiled functions.
+ Only relies on interfaces that predate the compact Value layout, to compare both. */
+
+namespace {
+
+	// Millions of iterations per second.
+	template<typename F>
+	double measure(F function, size_t count){
+		const auto start = std::chrono::steady_clock::now();
+		function(count);
+		const auto end = std::chrono::steady_clock::now();
+		return double(count) / std::chrono::duration<double>(end - start).count() / 1e6;
+	}
+
+	void report(const std::string& name, double rate, const std::string& unit){
+		std::cout << std::left << std::setw(24) << name << std::fixed << std::setprecision(1) << rate << " " << unit << std::endl;
+	}
+
+	// Prevent the compiler from removing the benchmarked operations.
+	volatile double sink = 0.0;
+
+}
+
+int main(int argc, char** argv){
+	const size_t count = argc > 1 ? size_t(std::stoull(argv[1])) : 5000000u;
+
+	std::cout << "sizeof(Value)           " << sizeof(Value) << " bytes" << std::endl;
+
+	Scope scope;
+	FunctionsLibrary stdlib;
+	ExpEval evaluator(scope, stdlib, Format::INTERNAL);
+
+	auto binary = [&](const std::string& name, Operator op, const Value& a, const Value& b){
+		const double rate = measure([&](size_t n){
+			Value result;
+			for(size_t k = 0; k < n; ++k){
+				result = evaluator.applyBinary(op, a, b);
+			}
+			sink = sink + double(result.type);
+		}, count);
+		report(name, rate, "Mops/s");
+	};
+	binary("int + int", Operator::Plus, Value(3ll), Value(4ll));
+	binary("float * float", Operator::Product, Value(3.0), Value(4.0));
+	binary("int < float", Operator::LessThan, Value(3ll), Value(4.0));
+	binary("vec3 + vec3", Operator::Plus, Value(glm::vec3(1.0f)), Value(glm::vec3(2.0f)));
+	binary("mat4 * vec4", Operator::Product, Value(glm::mat4(2.0f)), Value(glm::vec4(1.0f)));
+
+	{
+		const double rate = measure([&](size_t n){
+			Value result;
+			const Value value(2.0);
+			for(size_t k = 0; k < n; ++k){
+				value.convert(Value::FLOAT, result);
+			}
+			sink = sink + result.f;
+		}, count);
+		report("convert same type", rate, "Mops/s");
+	}
+	{
+		// Copies of a value into an array, as in register frames and batch lanes.
+		const double rate = measure([&](size_t n){
+			std::vector<Value> values;
+			for(size_t k = 0; k < n / 1000; ++k){
+				values.assign(1000, Value(1.0));
+			}
+			sink = sink + values[0].f;
+		}, count);
+		report("vector fill", rate, "Mvalues/s");
+	}
+
+	Calculator calculator;
+	const std::vector<std::string> definitions = {
+		"a = 3", "f(x) = x * a + 2", "h(x) = sin(x) * cos(x) + exp(-x*x)",
+	};
+	for(const std::string& definition : definitions){
+		Value output;
+		std::vector<Calculator::Word> words;
+		Format format = Format::INTERNAL;
+		if(!calculator.evaluate(definition, output, words, format, false)){
+			std::cerr << "Unable to define " << definition << std::endl;
+			return 1;
+		}
+	}
+	for(const std::string name : { "f", "h" }){
+		const double rate = measure([&](size_t n){
+			Value output;
+			for(size_t k = 0; k < n; ++k){
+				calculator.evaluateFunction(name, { Value(double(k) * 1e-6) }, output);
+			}
+			sink = sink + output.f;
+		}, count / 5);
+		report(name + "(x)", rate, "Mcalls/s");
+	}
+	return 0;
+}
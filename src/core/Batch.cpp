@@ -0,0 +1,549 @@
+#include "core/Batch.hpp"
+#include "core/Evaluator.hpp"
+#include "core/Kernels.hpp"
+
+namespace {
+
+	bool isScalar(Value::Type type){
+		return type == Value::BOOL || type == Value::INTEGER || type == Value::FLOAT;
+	}
+
+	double toDouble(const Value& v){
+		switch(v.type){
+			case Value::BOOL:
+				return v.b ? 1.0 : 0.0;
+			case Value::INTEGER:
+				return double(v.i);
+			case Value::FLOAT:
+				return v.f;
+			default:
+				break;
+		}
+		assert(false);
+		return 0.0;
+	}
+
+	bool isActive(const uchar* mask, size_t lane){
+		return mask == nullptr || mask[lane] != 0;
+	}
+
+}
+
+Value BatchMachine::Lanes::at(size_t lane) const {
+	switch(layout){
+		case Layout::UNIFORM:
+			return uniform;
+		case Layout::FLOATS:
+			if(type == Value::BOOL){
+				return floats[lane] != 0.0;
+			}
+			return floats[lane];
+		case Layout::VALUES:
+			return values[lane];
+		default:
+			break;
+	}
+	assert(false);
+	return false;
+}
+
+void BatchMachine::Lanes::setUniform(const Value& value){
+	layout = Layout::UNIFORM;
+	type = value.type;
+	uniform = value;
+}
+
+void BatchMachine::Lanes::setFloats(Value::Type floatType, size_t count){
+	layout = Layout::FLOATS;
+	type = floatType;
+	floats.resize(count);
+}
+
+void BatchMachine::Lanes::setValues(size_t count){
+	layout = Layout::VALUES;
+	// Samples can have different types.
+	type = Value::STRING;
+	values.resize(count);
+}
+
+BatchMachine::BatchMachine(ExpEval& evaluator) : _evaluator(evaluator) {
+}
+
+bool BatchMachine::run(const Program& program, const std::vector<Column>& args, double* out, size_t count){
+	assert(args.size() == program._argCount);
+	if(runNative(program, args, out, count)){
+		return true;
+	}
+	if(_frames.empty()){
+		_frames.resize(1);
+		_constants.resize(1);
+	}
+	Lanes result;
+
+	for(size_t start = 0; start < count; start += CHUNK_SIZE){
+		const size_t laneCount = std::min(CHUNK_SIZE, count - start);
+
+		Frame& frame = _frames[0];
+		frame.resize(program._registerCount);
+		for(uint aid = 0; aid < program._argCount; ++aid){
+			if(args[aid].samples){
+				frame[aid].setFloats(Value::FLOAT, laneCount);
+				std::copy(args[aid].samples + start, args[aid].samples + start + laneCount, frame[aid].floats.begin());
+			} else {
+				frame[aid].setUniform(args[aid].value);
+			}
+		}
+
+		if(!execute(program, frame, nullptr, laneCount, 0, result)){
+			return false;
+		}
+
+		// Convert the results to floats.
+		double* chunkOut = out + start;
+		if(result.layout == Lanes::Layout::FLOATS){
+			std::copy(result.floats.begin(), result.floats.begin() + laneCount, chunkOut);
+			continue;
+		}
+		for(size_t lane = 0; lane < laneCount; ++lane){
+			const Value res = result.at(lane);
+			Value resFloat;
+			if(!res.convert(Value::FLOAT, resFloat)){
+				_evaluator.registerError("Unsupported type " + TypeString(res.type) + " for function result.", nullptr);
+				return false;
+			}
+			chunkOut[lane] = resFloat.f;
+		}
+	}
+	return true;
+}
+
+bool BatchMachine::runNative(const Program& program, const std::vector<Column>& args, double* out, size_t count){
+	const uint argCount = program._argCount;
+	if(argCount > Program::MAX_SPECIALIZED_ARGS){
+		return false;
+	}
+	Value::Type argTypes[Program::MAX_SPECIALIZED_ARGS];
+	for(uint aid = 0; aid < argCount; ++aid){
+		if(!args[aid].samples && args[aid].value.type != Value::FLOAT){
+			return false;
+		}
+		argTypes[aid] = Value::FLOAT;
+	}
+	const Specialization* specialization = program.specialization(argTypes, _evaluator);
+	if(specialization == nullptr || !specialization->native){
+		return false;
+	}
+	const JitFunction& native = *specialization->native;
+
+	const double* samples[Program::MAX_SPECIALIZED_ARGS];
+	size_t strides[Program::MAX_SPECIALIZED_ARGS];
+	for(uint aid = 0; aid < argCount; ++aid){
+		const Column& column = args[aid];
+		samples[aid] = column.samples ? column.samples : &column.value.f;
+		strides[aid] = column.samples ? 1 : 0;
+	}
+	native.run(samples, strides, out, count);
+	return true;
+}
+
+bool BatchMachine::execute(const Program& program, Frame& frame, const uchar* mask, size_t count, size_t depth, Lanes& result){
+
+	// Fresh registers for the intermediate values.
+	for(uint rid = program._argCount; rid < program._registerCount; ++rid){
+		frame[rid].layout = Lanes::Layout::EMPTY;
+	}
+	Frame& constants = _constants[depth];
+	const size_t constantCount = program._constants.size();
+	constants.resize(constantCount);
+	for(size_t cid = 0; cid < constantCount; ++cid){
+		constants[cid].setUniform(program._constants[cid]);
+	}
+
+	auto fetch = [&frame, &constants](uint operand) -> const Lanes& {
+		if(operand & Instruction::CONSTANT_FLAG){
+			return constants[operand & ~Instruction::CONSTANT_FLAG];
+		}
+		return frame[operand];
+	};
+
+	// Each conditional splits the active lanes between its two branches.
+	struct Branch {
+		std::vector<uchar> pass;
+		std::vector<uchar> fail;
+		size_t elsePc;
+		size_t endPc;
+		bool hasFail;
+		bool inElse;
+	};
+	std::vector<Branch> branches;
+	const uchar* active = mask;
+
+	const size_t instructionCount = program._instructions.size();
+	size_t pc = 0;
+	while(pc < instructionCount && !_evaluator.hasFailed()){
+		// Leave completed conditionals.
+		while(!branches.empty() && branches.back().inElse && pc == branches.back().endPc){
+			branches.pop_back();
+			active = branches.empty() ? mask : (branches.back().inElse ? branches.back().fail.data() : branches.back().pass.data());
+		}
+		if(pc >= instructionCount){
+			break;
+		}
+
+		const Instruction& ins = program._instructions[pc];
+		++pc;
+
+		switch(ins.code){
+			case Instruction::Code::UNARY:
+				processUnary(ins.op, fetch(ins.a), frame[ins.dst], active, count);
+				break;
+			case Instruction::Code::BINARY:
+				processBinary(ins.op, fetch(ins.a), fetch(ins.b), frame[ins.dst], active, count);
+				break;
+			case Instruction::Code::MEMBER:
+			{
+				const Lanes& par = fetch(ins.a);
+				Lanes& dst = frame[ins.dst];
+				const Program::Subscript& subscript = program._subscripts[ins.c];
+				auto applyMember = [this, &subscript](const Value& value){
+					if(subscript.valid){
+						return _evaluator.applySwizzle(value, subscript.swizzle, subscript.member, nullptr);
+					}
+					return _evaluator.applyMember(value, subscript.member, nullptr);
+				};
+				if(par.layout == Lanes::Layout::UNIFORM){
+					dst.setUniform(applyMember(par.uniform));
+					break;
+				}
+				std::vector<Value> results(count);
+				for(size_t lane = 0; lane < count && !_evaluator.hasFailed(); ++lane){
+					if(isActive(active, lane)){
+						results[lane] = applyMember(par.at(lane));
+					}
+				}
+				storeValues(results, dst, active, count);
+				break;
+			}
+			case Instruction::Code::CALL:
+			{
+				std::vector<const Lanes*> callArgs(ins.b);
+				for(uint aid = 0; aid < ins.b; ++aid){
+					callArgs[aid] = &fetch(program._operands[ins.a + aid]);
+				}
+				processCall(program._callees[ins.c], callArgs, frame[ins.dst], active, count, depth);
+				break;
+			}
+			case Instruction::Code::MOVE:
+				processMove(fetch(ins.a), frame[ins.dst], active, count);
+				break;
+			case Instruction::Code::JUMP:
+			{
+				// End of the pass branch of the innermost conditional, switch to its fail branch.
+				assert(!branches.empty() && !branches.back().inElse);
+				Branch& branch = branches.back();
+				branch.inElse = true;
+				active = branch.fail.data();
+				if(!branch.hasFail){
+					pc = branch.endPc;
+				}
+				break;
+			}
+			case Instruction::Code::JUMP_IF_FALSE:
+			{
+				const Lanes& cond = fetch(ins.a);
+				Branch& branch = branches.emplace_back();
+				branch.pass.resize(count);
+				branch.fail.resize(count);
+				branch.elsePc = ins.b;
+				// The pass branch always ends with a jump over the fail branch.
+				branch.endPc = program._instructions[ins.b - 1].b;
+				branch.inElse = false;
+
+				bool hasPass = false;
+				bool hasFail = false;
+				Value uniformCond;
+				if(cond.layout == Lanes::Layout::UNIFORM && !cond.uniform.convert(Value::BOOL, uniformCond)){
+					_evaluator.registerError("Condition could not be converted to a boolean.", nullptr);
+					break;
+				}
+				for(size_t lane = 0; lane < count; ++lane){
+					bool condLane = false;
+					if(!isActive(active, lane)){
+						branch.pass[lane] = branch.fail[lane] = 0;
+						continue;
+					}
+					if(cond.layout == Lanes::Layout::UNIFORM){
+						condLane = uniformCond.b;
+					} else if(cond.layout == Lanes::Layout::FLOATS){
+						condLane = cond.floats[lane] != 0.0;
+					} else {
+						Value condBool;
+						if(!cond.values[lane].convert(Value::BOOL, condBool)){
+							_evaluator.registerError("Condition could not be converted to a boolean.", nullptr);
+							break;
+						}
+						condLane = condBool.b;
+					}
+					branch.pass[lane] = condLane ? 1 : 0;
+					branch.fail[lane] = condLane ? 0 : 1;
+					hasPass = hasPass || condLane;
+					hasFail = hasFail || !condLane;
+				}
+				branch.hasFail = hasFail;
+				active = branch.pass.data();
+				// Skip the pass branch if no lane takes it.
+				if(!hasPass){
+					branch.inElse = true;
+					active = branch.fail.data();
+					pc = branch.elsePc;
+				}
+				break;
+			}
+			default:
+				assert(false);
+				break;
+		}
+	}
+
+	if(_evaluator.hasFailed()){
+		return false;
+	}
+	result = fetch(program._result);
+	return true;
+}
+
+bool BatchMachine::processUnary(Operator op, const Lanes& v, Lanes& dst, const uchar* mask, size_t count){
+	if(v.layout == Lanes::Layout::UNIFORM){
+		dst.setUniform(_evaluator.applyUnary(op, v.uniform));
+		return !_evaluator.hasFailed();
+	}
+
+	// Negation of floats and boolean negation of booleans.
+	if(v.layout == Lanes::Layout::FLOATS && ((v.type == Value::FLOAT && op != Operator::BoolNot) || (v.type == Value::BOOL && op == Operator::BoolNot))){
+		const Kernels::Unary kernel = Kernels::unaryOperator(op);
+		if(kernel){
+			dst.setFloats(v.type, count);
+			kernel(v.floats.data(), dst.floats.data(), count);
+			return true;
+		}
+	}
+
+	// Generic per-lane evaluation.
+	std::vector<Value> results(count);
+	for(size_t lane = 0; lane < count && !_evaluator.hasFailed(); ++lane){
+		if(isActive(mask, lane)){
+			results[lane] = _evaluator.applyUnary(op, v.at(lane));
+		}
+	}
+	return storeValues(results, dst, mask, count);
+}
+
+bool BatchMachine::processBinary(Operator op, const Lanes& l, const Lanes& r, Lanes& dst, const uchar* mask, size_t count){
+	if(l.layout == Lanes::Layout::UNIFORM && r.layout == Lanes::Layout::UNIFORM){
+		dst.setUniform(_evaluator.applyBinary(op, l.uniform, r.uniform));
+		return !_evaluator.hasFailed();
+	}
+
+	if(isScalar(l.type) && isScalar(r.type)){
+		// Replicate the type promotion of the evaluator to know if the operation is performed on floats.
+		Value::Type minType = Value::STRING;
+		bool boolResult = false;
+		switch(op){
+			case Operator::Plus:
+			case Operator::Minus:
+			case Operator::Product:
+			case Operator::Modulo:
+				minType = Value::INTEGER;
+				break;
+			case Operator::Divide:
+			case Operator::Power:
+				minType = Value::FLOAT;
+				break;
+			case Operator::LessThan:
+			case Operator::GreaterThan:
+			case Operator::LessThanEqual:
+			case Operator::GreaterThanEqual:
+				minType = Value::INTEGER;
+				boolResult = true;
+				break;
+			case Operator::Equal:
+			case Operator::Different:
+				minType = Value::BOOL;
+				boolResult = true;
+				break;
+			case Operator::BoolOr:
+			case Operator::BoolAnd:
+			case Operator::BoolXor:
+				// Always converted to booleans.
+				minType = Value::BOOL;
+				boolResult = true;
+				break;
+			default:
+				break;
+		}
+		const Value::Type alignedType = std::max(minType, std::max(l.type, r.type));
+		const bool boolOp = op == Operator::BoolOr || op == Operator::BoolAnd || op == Operator::BoolXor;
+		const bool floatOp = alignedType == Value::FLOAT || (alignedType == Value::BOOL && !boolOp && boolResult);
+
+		const Kernels::Binary kernel = Kernels::binaryOperator(op);
+		if((boolOp || floatOp) && kernel){
+			dst.setFloats(boolResult ? Value::BOOL : Value::FLOAT, count);
+			kernel(floatSamples(l, 0, count), floatSamples(r, 1, count), dst.floats.data(), count);
+			return true;
+		}
+	}
+
+	// Generic per-lane evaluation.
+	std::vector<Value> results(count);
+	for(size_t lane = 0; lane < count && !_evaluator.hasFailed(); ++lane){
+		if(isActive(mask, lane)){
+			results[lane] = _evaluator.applyBinary(op, l.at(lane), r.at(lane));
+		}
+	}
+	return storeValues(results, dst, mask, count);
+}
+
+bool BatchMachine::processCall(const Program::Callee& callee, const std::vector<const Lanes*>& args, Lanes& dst, const uchar* mask, size_t count, size_t depth){
+	const size_t argCount = args.size();
+	bool allUniform = true;
+	bool allFloats = true;
+	for(const Lanes* arg : args){
+		allUniform = allUniform && arg->layout == Lanes::Layout::UNIFORM;
+		allFloats = allFloats && arg->type == Value::FLOAT && arg->layout != Lanes::Layout::VALUES;
+	}
+
+	std::vector<Value> argValues(argCount);
+	if(allUniform){
+		for(size_t aid = 0; aid < argCount; ++aid){
+			argValues[aid] = args[aid]->uniform;
+		}
+		dst.setUniform(_evaluator.callFunction(callee, argValues));
+		return !_evaluator.hasFailed();
+	}
+
+	const FunctionDef* def = callee.function;
+	if(def){
+		// Execute user functions on all lanes at once, in a new frame.
+		if(def->program){
+			const Program& callee = *def->program;
+			if(_frames.size() < depth + 2){
+				_frames.resize(depth + 2);
+				_constants.resize(depth + 2);
+			}
+			Frame& frame = _frames[depth + 1];
+			frame.resize(callee._registerCount);
+			for(size_t aid = 0; aid < argCount; ++aid){
+				frame[aid] = *args[aid];
+			}
+			return execute(callee, frame, mask, count, depth + 1, dst);
+		}
+	} else if(allFloats && callee.builtin){
+		const std::string& name = callee.name;
+		// Standard library functions with a float equivalent.
+		if(argCount == 1){
+			const Kernels::Unary kernel = Kernels::unaryFunction(name);
+			if(kernel){
+				dst.setFloats(Value::FLOAT, count);
+				kernel(floatSamples(*args[0], 0, count), dst.floats.data(), count);
+				return true;
+			}
+		} else if(argCount == 2){
+			const Kernels::Binary kernel = Kernels::binaryFunction(name);
+			if(kernel){
+				dst.setFloats(Value::FLOAT, count);
+				kernel(floatSamples(*args[0], 0, count), floatSamples(*args[1], 1, count), dst.floats.data(), count);
+				return true;
+			}
+		} else if(argCount == 3){
+			const Kernels::Ternary kernel = Kernels::ternaryFunction(name);
+			if(kernel){
+				dst.setFloats(Value::FLOAT, count);
+				kernel(floatSamples(*args[0], 0, count), floatSamples(*args[1], 1, count), floatSamples(*args[2], 2, count), dst.floats.data(), count);
+				return true;
+			}
+		}
+	}
+
+	// Generic per-lane evaluation.
+	std::vector<Value> results(count);
+	for(size_t lid = 0; lid < count && !_evaluator.hasFailed(); ++lid){
+		if(!isActive(mask, lid)){
+			continue;
+		}
+		for(size_t aid = 0; aid < argCount; ++aid){
+			argValues[aid] = args[aid]->at(lid);
+		}
+		results[lid] = _evaluator.callFunction(callee, argValues);
+	}
+	return storeValues(results, dst, mask, count);
+}
+
+void BatchMachine::processMove(const Lanes& src, Lanes& dst, const uchar* mask, size_t count){
+	if(mask == nullptr || dst.layout == Lanes::Layout::EMPTY){
+		dst = src;
+		return;
+	}
+
+	// Both branches produced the same float type, blend the active lanes.
+	if(isScalar(dst.type) && dst.type == src.type && dst.type != Value::INTEGER
+	   && dst.layout != Lanes::Layout::VALUES && src.layout != Lanes::Layout::VALUES){
+		if(dst.layout == Lanes::Layout::UNIFORM){
+			const double value = toDouble(dst.uniform);
+			dst.setFloats(dst.type, count);
+			std::fill(dst.floats.begin(), dst.floats.end(), value);
+		}
+		const double srcValue = src.layout == Lanes::Layout::UNIFORM ? toDouble(src.uniform) : 0.0;
+		for(size_t lane = 0; lane < count; ++lane){
+			if(mask[lane]){
+				dst.floats[lane] = src.layout == Lanes::Layout::UNIFORM ? srcValue : src.floats[lane];
+			}
+		}
+		return;
+	}
+
+	std::vector<Value> results(count);
+	for(size_t lane = 0; lane < count; ++lane){
+		results[lane] = mask[lane] ? src.at(lane) : dst.at(lane);
+	}
+	storeValues(results, dst, nullptr, count);
+}
+
+const double* BatchMachine::floatSamples(const Lanes& lanes, size_t slot, size_t count){
+	if(lanes.layout == Lanes::Layout::FLOATS){
+		return lanes.floats.data();
+	}
+	// Broadcast uniform values.
+	assert(lanes.layout == Lanes::Layout::UNIFORM);
+	std::vector<double>& samples = _broadcasts[slot];
+	samples.assign(count, toDouble(lanes.uniform));
+	return samples.data();
+}
+
+bool BatchMachine::storeValues(std::vector<Value>& results, Lanes& dst, const uchar* mask, size_t count){
+	if(_evaluator.hasFailed()){
+		return false;
+	}
+	// Keep a compact representation if all active lanes are floats or all booleans.
+	Value::Type type = Value::STRING;
+	bool sameType = true;
+	for(size_t lane = 0; lane < count; ++lane){
+		if(!isActive(mask, lane)){
+			continue;
+		}
+		if(type == Value::STRING){
+			type = results[lane].type;
+		}
+		sameType = sameType && results[lane].type == type;
+	}
+
+	if(sameType && (type == Value::FLOAT || type == Value::BOOL)){
+		dst.setFloats(type, count);
+		for(size_t lane = 0; lane < count; ++lane){
+			dst.floats[lane] = isActive(mask, lane) ? toDouble(results[lane]) : 0.0;
+		}
+		return true;
+	}
+	dst.setValues(count);
+	std::swap(dst.values, results);
+	return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Types.hpp"
+#include "core/Program.hpp"
+
+#include <deque>
+
+class ExpEval;
+
+/** Samples of a function argument, either varying per sample or broadcast to all samples. */
+struct Column {
+
+	Column(const double* _samples) : samples(_samples) {}
+
+	Column(const Value& _value) : value(_value) {}
+
+	const double* samples = nullptr;
+	Value value;
+};
+
+/** Execute a program on many samples at once: each instruction is applied to a whole chunk of samples
+ before moving to the next one. Scalar float and boolean samples are stored in contiguous arrays
+ and processed by vectorized kernels, other types fall back to per-sample evaluation.
+ Functions of floats only are executed by their native code when available. */
+class BatchMachine {
+public:
+
+	static constexpr size_t CHUNK_SIZE = 256;
+
+	BatchMachine(ExpEval& evaluator);
+
+	bool run(const Program& program, const std::vector<Column>& args, double* out, size_t count);
+
+private:
+
+	struct Lanes {
+		enum class Layout : uchar {
+			EMPTY, UNIFORM, FLOATS, VALUES
+		};
+
+		Value at(size_t lane) const;
+		void setUniform(const Value& value);
+		void setFloats(Value::Type floatType, size_t count);
+		void setValues(size_t count);
+
+		std::vector<double> floats;
+		std::vector<Value> values;
+		Value uniform;
+		Layout layout = Layout::EMPTY;
+		// Type of the samples, STRING when they differ.
+		Value::Type type = Value::FLOAT;
+	};
+
+	using Frame = std::vector<Lanes>;
+
+	// Run the native code of the program if all arguments are floats, returns false if not available.
+	bool runNative(const Program& program, const std::vector<Column>& args, double* out, size_t count);
+
+	bool execute(const Program& program, Frame& frame, const uchar* mask, size_t count, size_t depth, Lanes& result);
+
+	bool processUnary(Operator op, const Lanes& v, Lanes& dst, const uchar* mask, size_t count);
+	bool processBinary(Operator op, const Lanes& l, const Lanes& r, Lanes& dst, const uchar* mask, size_t count);
+	bool processCall(const Program::Callee& callee, const std::vector<const Lanes*>& args, Lanes& dst, const uchar* mask, size_t count, size_t depth);
+	void processMove(const Lanes& src, Lanes& dst, const uchar* mask, size_t count);
+
+	bool storeValues(std::vector<Value>& results, Lanes& dst, const uchar* mask, size_t count);
+	const double* floatSamples(const Lanes& lanes, size_t slot, size_t count);
+
+	ExpEval& _evaluator;
+	// Registers of each call depth, reused between chunks.
+	std::deque<Frame> _frames;
+	std::deque<Frame> _constants;
+	// Uniform operands expanded for kernels.
+	std::vector<double> _broadcasts[3];
+};
@@ -2,6 +2,7 @@
 #include "core/Scanner.hpp"
 #include "core/Parser.hpp"
 #include "core/Evaluator.hpp"
+#include "core/Memo.hpp"
 #include "core/system/TextUtilities.hpp"
 
 void Documentation::setVar(const std::string& name, const Value& value){
@@ -19,7 +20,7 @@ void Documentation::setFunc(const std::string& name, const std::shared_ptr<Funct
 
 	ExpLogger logger;
 	// Generate expression.
-	std::string expr = def->expr->evaluate(logger).str;
+	std::string expr = def->expr->evaluate(logger).str();
 	// Generate name with arguments, removing internal identifiers.
 	std::string fullName = def->name + "(";
 	std::vector<std::string> args;
@@ -70,20 +71,57 @@ std::string generateErrorLocationMessage(const std::string& input, int start, in
 std::string logTree(const Expression::Ptr& exp ){
 	ExpLogger logger;
 	Value finalStr = exp->evaluate(logger);
-	return finalStr.str;
+	return finalStr.str();
 }
 
 
-Calculator::Calculator(){
+Calculator::Calculator() : _inputs(INPUT_CACHE_SIZE) {
 	_doc.setLibrary(_stdlib);
 }
 
 bool Calculator::evaluate(const std::string& input, Value& output, std::vector<Word>& infos, Format& format, bool temporary){
+	InputCache::Entry& entry = _inputs.get(input);
+
+	// The same text is evaluated again if the user only moves the cursor or retypes it.
+	if(temporary && entry.evaluated && entry.version == _globals.version() && entry.inputFormat == format){
+		output = entry.output;
+		format = entry.outputFormat;
+		return entry.success;
+	}
+
+	if(!temporary){
+		_recomputedFunctions.clear();
+	}
+	const Format inputFormat = format;
+	const bool success = evaluate(input, entry, output, infos, format, temporary);
+
+	if(temporary){
+		// Temporary evaluations don't modify the scope.
+		entry.output = output;
+		entry.version = _globals.version();
+		entry.inputFormat = inputFormat;
+		entry.outputFormat = format;
+		entry.success = success;
+		entry.evaluated = true;
+	}
+	return success;
+}
+
+bool Calculator::evaluate(const std::string& input, InputCache::Entry& entry, Value& output, std::vector<Word>& infos, Format& format, bool temporary){
 	const std::string& cleanInput = input;
 
-	// Scanning
-	Scanner scanner(cleanInput);
-	const Status scanResult = scanner.scan();
+	// Scanning, only the edited span if the previous input was a version of the same line.
+	if(!entry.scanner){
+		entry.scanner.reset(new Scanner(cleanInput));
+		const InputCache::Entry* base = _inputs.previous();
+		if(base && base->scanner){
+			const Scanner::Edit edit = Scanner::difference(base->scanner->input(), cleanInput);
+			entry.scanResult = entry.scanner->scan(*base->scanner, edit);
+		} else {
+			entry.scanResult = entry.scanner->scan();
+		}
+	}
+	const Status& scanResult = entry.scanResult;
 	if(!scanResult){
 		// Point to the problematic character.
 		const long characterPos = scanResult.location;
@@ -91,65 +129,37 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 		output = "Parsing: " + scanResult.message + " " + errorMsg;
 		return false;
 	}
-	// Build the AST
-	Parser parser(scanner.tokens());
-	const Status parseResult = parser.parse();
-	
+	const auto& tokens = entry.scanner->tokens();
+
+	// Build the AST, again if the previous one was a function definition.
+	if(!entry.parsed || (entry.parseResult && !entry.tree)){
+		Parser parser(tokens);
+		entry.parseResult = parser.parse();
+		entry.tree = entry.parseResult ? parser.tree() : nullptr;
+		entry.parsed = true;
+	}
+	const Status& parseResult = entry.parseResult;
+
 	if(!parseResult){
 		output = "Compilation: " + parseResult.message + " ";
-		if(parseResult.location < int(scanner.tokens().size())){
-			const Token& errorToken = scanner.tokens()[parseResult.location];
+		if(parseResult.location < int(tokens.size())){
+			const Token& errorToken = tokens[parseResult.location];
 			const std::string errorMsg = generateErrorLocationMessage(cleanInput, errorToken.location, errorToken.size);
-			output.str.append(errorMsg);
+			output = Value(output.str() + errorMsg);
 
 		} else {
 			// Handle end-of-line errors.
-			const Token& lastToken = scanner.tokens().back();
+			const Token& lastToken = tokens.back();
 			const std::string errorMsg = generateErrorLocationMessage(cleanInput, lastToken.size, lastToken.size);
-			output.str.append(errorMsg);
+			output = Value(output.str() + errorMsg);
 		}
 		return false;
 	}
+	const std::shared_ptr<Expression> tree = entry.tree;
 
-	// Generate highlighting info.
-	const auto& tokens = scanner.tokens();
-
+	// Highlighting info, classified while scanning.
 	if(!temporary){
-		const size_t tokenCount = tokens.size();
-		infos.resize(tokenCount);
-
-		// Classify each token.
-		for(size_t tid = 0; tid < tokenCount; ++tid){
-
-			const Token& token = tokens[tid];
-			switch(token.type){
-				case Token::Type::Operator:
-				{
-					// Special cases: ( ) , . and unary (operator following an operator or at beginning of line)
-					const bool isSeparator = token.opVal == Operator::OpenParenth || token.opVal == Operator::CloseParenth || token.opVal == Operator::Comma || token.opVal == Operator::Dot;
-					const bool followOperator = tid == 0 || (tokens[tid-1].type == Token::Type::Operator && tokens[tid-1].opVal != Operator::CloseParenth);
-					infos[tid].type = (isSeparator || followOperator) ? Word::SEPARATOR : Word::OPERATOR;
-					break;
-				}
-				case Token::Type::Identifier:
-				{
-					// If followed by a parenthesis, function. Otherwise, variable.
-					if(tid + 1 < tokenCount && tokens[tid+1].type == Token::Type::Operator && tokens[tid+1].opVal == Operator::OpenParenth){
-						infos[tid].type =  Word::FUNCTION;
-					} else {
-						infos[tid].type =  Word::VARIABLE;
-					}
-					break;
-				}
-				case Token::Type::Float:
-				case Token::Type::Integer:
-				default:
-					infos[tid].type = Word::LITERAL;
-				break;
-			}
-			infos[tid].location = token.location;
-			infos[tid].size = token.size;
-		}
+		infos = entry.scanner->words();
 	}
 
 	// Three possible cases:
@@ -158,7 +168,13 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 	// * general expression to evaluate: evaluate value based on context and log the result
 
 	// Variable definition
-	if(auto varDef = std::dynamic_pointer_cast<VariableDef>(parser.tree())){
+	if(auto varDef = std::dynamic_pointer_cast<VariableDef>(tree)){
+
+		Scope::Dependencies dependencies;
+		if(_liveMode && !temporary){
+			dependencies.source = cleanInput;
+			ExpDependencies::collect(*varDef, dependencies);
+		}
 
 		ExpEval evaluator(_globals, _stdlib, format);
 		Value outValue;
@@ -176,6 +192,7 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 				// Register variable name for display.
 				_doc.setVar(varDef->name, outValue);
 				_doc.setVar("ans", outValue);
+				_recomputedFunctions = updateDependents({ varDef->name, false }, dependencies, format);
 			}
 			return true;
 
@@ -188,12 +205,20 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 				const Token& lastToken = tokens[failExp->dbgEndPos];
 				const long finalSize = lastToken.location - firstToken.location + lastToken.size;
 				const std::string errorMsg = generateErrorLocationMessage(cleanInput, firstToken.location, finalSize);
-				output.str.append(errorMsg);
+				output = Value(output.str() + errorMsg);
 			}
 			return false;
 		}
 
-	} else if(auto funDef = std::dynamic_pointer_cast<FunctionDef>(parser.tree())){
+	} else if(auto funDef = std::dynamic_pointer_cast<FunctionDef>(tree)){
+		entry.tree = nullptr;
+
+		// Collect names before arguments are renamed.
+		Scope::Dependencies dependencies;
+		if(_liveMode && !temporary){
+			dependencies.source = cleanInput;
+			ExpDependencies::collect(*funDef, dependencies);
+		}
 
 		// Build unique name for all arguments.
 		const std::string suffix = "@" + funDef->name + "_" + (temporary ? "tmp" : std::to_string(_funcCounter));
@@ -215,8 +240,11 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 				++_funcCounter;
 				// Store flattened function in global scope.
 				_globals.setFunc(funDef->name, funDef);
+				// Compile once, to speed up all subsequent calls.
+				compileDefinitions({ funDef->name });
 				// Register function name for display.
 				_doc.setFunc(funDef->name, funDef);
+				_recomputedFunctions = updateDependents({ funDef->name, true }, dependencies, format);
 			}
 			return true;
 		} else {
@@ -228,7 +256,7 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 				const Token& lastToken = tokens[failExp->dbgEndPos];
 				const long finalSize = lastToken.location - firstToken.location + lastToken.size;
 				const std::string errorMsg = generateErrorLocationMessage(cleanInput, firstToken.location, finalSize);
-				output.str.append(errorMsg);
+				output = Value(output.str() + errorMsg);
 			}
 			return false;
 		}
@@ -236,7 +264,7 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 	} else {
 		ExpEval evaluator(_globals, _stdlib, format);
 		Value outValue;
-		const Status evalResult = parser.tree()->evaluate(evaluator, outValue);
+		const Status evalResult = tree->evaluate(evaluator, outValue);
 
 		if(evalResult.success){
 			output = outValue;
@@ -258,7 +286,7 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 				const Token& lastToken = tokens[failExp->dbgEndPos];
 				const long finalSize = lastToken.location - firstToken.location + lastToken.size;
 				const std::string errorMsg = generateErrorLocationMessage(cleanInput, firstToken.location, finalSize);
-				output.str.append(errorMsg);
+				output = Value(output.str() + errorMsg);
 			}
 			return false;
 
@@ -269,23 +297,252 @@ bool Calculator::evaluate(const std::string& input, Value& output, std::vector<W
 }
 
 bool Calculator::evaluateFunction(const std::string& name, const std::vector<Value>& args, Value& output){
-	
+
+	// Directly call user functions.
+	if(_globals.hasFunc(name)){
+		ExpEval eval(_globals, _stdlib, Format::INTERNAL);
+		output = eval.callFunction(name, args, nullptr);
+		return !eval.hasFailed();
+	}
+
 	// Build a function call.
 	const size_t argCount = args.size();
+	Arena arena;
 	std::vector<Expression::Ptr> argValues(argCount);
 	for(size_t aid = 0; aid < argCount; ++aid){
-		argValues[aid] = std::make_shared<Literal>(args[aid], (long)aid);
+		argValues[aid] = arena.make<Literal>(args[aid], (long)aid);
 	}
-	const auto func = std::make_shared<FunctionCall>(name, argValues, 0, 1);
+	const auto func = arena.make<FunctionCall>(name, argValues, 0, 1);
 	Format format = Format::INTERNAL;
 	ExpEval eval(_globals, _stdlib, format);
 	output = func->evaluate(eval);
 	return true;
 }
 
+bool Calculator::evaluateFunctionBatch(const std::string& name, const std::vector<Column>& argumentColumns, std::vector<double>& outColumn){
+	return evaluateFunctionBatch(name, argumentColumns, outColumn.data(), outColumn.size());
+}
+
+bool Calculator::evaluateFunctionBatch(const std::string& name, const std::vector<Column>& argumentColumns, double* outColumn, size_t sampleCount){
+	ExpEval eval(_globals, _stdlib, Format::INTERNAL);
+	const size_t argCount = argumentColumns.size();
+
+	// Compiled user functions are executed on all samples at once.
+	if(_globals.hasFunc(name)){
+		const auto& funcDef = _globals.getFunc(name);
+		if(funcDef->program && funcDef->args.size() == argCount){
+			BatchMachine machine(eval);
+			return machine.run(*funcDef->program, argumentColumns, outColumn, sampleCount);
+		}
+	}
+
+	// Else evaluate each sample in turn.
+	std::vector<Value> args(argCount);
+	for(size_t aid = 0; aid < argCount; ++aid){
+		args[aid] = argumentColumns[aid].value;
+	}
+	for(size_t sid = 0; sid < sampleCount; ++sid){
+		for(size_t aid = 0; aid < argCount; ++aid){
+			if(argumentColumns[aid].samples){
+				args[aid] = argumentColumns[aid].samples[sid];
+			}
+		}
+		const Value outRaw = eval.callFunction(name, args, nullptr);
+		Value outFloat;
+		if(eval.hasFailed() || !outRaw.convert(Value::FLOAT, outFloat)){
+			return false;
+		}
+		outColumn[sid] = outFloat.f;
+	}
+	return true;
+}
+
+bool Calculator::evaluateFunctionInterval(const std::string& name, const std::vector<Interval>& args, Interval& output){
+	if(!_globals.hasFunc(name)){
+		return false;
+	}
+	IntervalEval eval(_globals, _stdlib);
+	return eval.evaluate(*_globals.getFunc(name), args, output);
+}
+
+int Calculator::functionArgumentCount(const std::string& name) const {
+	if(!_globals.hasFunc(name)){
+		return -1;
+	}
+	return int(_globals.getFunc(name)->args.size());
+}
+
+std::shared_ptr<Calculator> Calculator::snapshot() const {
+	std::shared_ptr<Calculator> copy = std::make_shared<Calculator>();
+	copy->_memoCapacity = _memoCapacity;
+	for(const auto& var : _globals.getVars()){
+		copy->_globals.setVar(var.first, var.second);
+	}
+	// Expressions are shared, but definitions are not: programs refer to the definitions of the functions they call,
+	// and are replaced when a function is redefined. Cached results are not shared either.
+	for(const auto& func : _globals.getFuncs()){
+		const std::shared_ptr<FunctionDef>& source = func.second;
+		FunctionDef* def = new FunctionDef(source->name, source->args, source->expr, source->dbgStartPos);
+		// The source definition owns the nodes of the expression, keep it alive with the copy.
+		copy->_globals.setFunc(func.first, std::shared_ptr<FunctionDef>(def, [source](FunctionDef* ptr){ delete ptr; }));
+	}
+	for(auto& func : copy->_globals.getFuncs()){
+		copy->compileFunction(*func.second);
+	}
+	return copy;
+}
+
+void Calculator::compileFunction(FunctionDef& def){
+	// Simplify the expression before compiling it, the original is kept for display.
+	Arena arena;
+	const Expression::Ptr expr = FuncOptimizer::optimize(def, _globals, _stdlib, arena);
+	def.program = FuncCompiler::compile(def, expr, _globals, _stdlib);
+	if(def.program){
+		for(const Program::Callee& callee : def.program->callees()){
+			_callers[callee.name].insert(def.name);
+		}
+	} else {
+		// Interpreted functions look their callees up by name, and might cache results computed with them.
+		Scope::Dependencies dependencies;
+		ExpDependencies::collect(*def.expr, dependencies);
+		for(const std::string& name : dependencies.functions){
+			_callers[name].insert(def.name);
+		}
+	}
+	setupMemo(def);
+}
+
+void Calculator::compileDefinitions(const std::unordered_set<std::string>& names){
+	std::unordered_set<std::string> changed;
+	std::vector<std::string> pending(names.begin(), names.end());
+	// Calls to a standard library function with the same name might have been folded anywhere.
+	for(const std::string& name : names){
+		if(_stdlib.hasFunc(name)){
+			for(const auto& func : _globals.getFuncs()){
+				pending.push_back(func.first);
+			}
+			break;
+		}
+	}
+	while(!pending.empty()){
+		const std::string name = pending.back();
+		pending.pop_back();
+		if(!changed.insert(name).second){
+			continue;
+		}
+		const auto caller = _callers.find(name);
+		if(caller != _callers.end()){
+			pending.insert(pending.end(), caller->second.begin(), caller->second.end());
+		}
+	}
+	for(const std::string& name : changed){
+		if(!_globals.hasFunc(name)){
+			continue;
+		}
+		FunctionDef& def = *_globals.getFunc(name);
+		compileFunction(def);
+		// Cached results of callers were computed with the previous definitions.
+		if(def.memo && names.count(name) == 0){
+			def.memo->clear();
+		}
+	}
+}
+
+void Calculator::setupMemo(FunctionDef& def) const {
+	if(_memoCapacity == 0){
+		def.memo = nullptr;
+	} else if(!def.memo || def.memo->capacity() != _memoCapacity){
+		def.memo = std::make_shared<FunctionMemo>(_memoCapacity);
+	}
+}
+
+void Calculator::setMemoCapacity(size_t capacity){
+	_memoCapacity = capacity;
+	for(auto& func : _globals.getFuncs()){
+		setupMemo(*func.second);
+	}
+}
+
+std::vector<std::string> Calculator::updateDependents(const Scope::Definition& def, const Scope::Dependencies& dependencies, Format format){
+	std::vector<std::string> recomputed;
+	if(!_liveMode){
+		// The definition won't be recomputed anymore.
+		_globals.removeDependencies(def);
+		return recomputed;
+	}
+	// A definition referring to itself keeps its current value.
+	_globals.setDependencies(def, dependencies);
+
+	// Only definitions affected by the change are recomputed, each one after its own dependencies.
+	// Functions are compiled together once their definitions are all replaced.
+	std::unordered_set<std::string> uncompiled;
+	for(const Scope::Definition& dependent : _globals.dependents(def)){
+		const Scope::Dependencies* dependentDeps = _globals.getDependencies(dependent);
+		assert(dependentDeps);
+		const std::string source = dependentDeps->source;
+		// Variables might call the functions recomputed so far.
+		if(!dependent.function && !uncompiled.empty()){
+			compileDefinitions(uncompiled);
+			uncompiled.clear();
+		}
+		if(recompute(source, format) && dependent.function){
+			recomputed.push_back(dependent.name);
+			uncompiled.insert(dependent.name);
+		}
+	}
+	if(!uncompiled.empty()){
+		compileDefinitions(uncompiled);
+	}
+	return recomputed;
+}
+
+bool Calculator::recompute(const std::string& source, Format format){
+	Scanner scanner(source);
+	if(!scanner.scan()){
+		return false;
+	}
+	Parser parser(scanner.tokens());
+	if(!parser.parse()){
+		return false;
+	}
+
+	if(auto varDef = std::dynamic_pointer_cast<VariableDef>(parser.tree())){
+		ExpEval evaluator(_globals, _stdlib, format);
+		Value outValue;
+		if(!varDef->expr->evaluate(evaluator, outValue).success){
+			return false;
+		}
+		_globals.setVar(varDef->name, outValue);
+		_doc.setVar(varDef->name, outValue);
+		return true;
+	}
+
+	if(auto funDef = std::dynamic_pointer_cast<FunctionDef>(parser.tree())){
+		const std::string suffix = "@" + funDef->name + "_" + std::to_string(_funcCounter);
+		FuncSubstitution flattener(_globals, _stdlib, funDef->args, suffix);
+		Value unused;
+		if(!funDef->expr->evaluate(flattener, unused).success){
+			return false;
+		}
+		for(std::string& argName : funDef->args){
+			argName.append(suffix);
+		}
+		++_funcCounter;
+		// Compiled by the caller, along with the other recomputed functions.
+		_globals.setFunc(funDef->name, funDef);
+		_doc.setFunc(funDef->name, funDef);
+		return true;
+	}
+	return false;
+}
+
 void Calculator::clear(){
 	_globals = Scope();
+	_callers.clear();
+	// Versions of the new scope start from zero again.
+	_inputs.clear();
 	_funcCounter = 0;
+	_recomputedFunctions.clear();
 	_doc.clear();
 }
 
@@ -318,7 +575,13 @@ void Calculator::saveToStream(std::ostream& str) const {
 	str << "FUNCTIONS " << int(functions.size()) << "\n";
 	ExpLogger logger;
 	for (const auto& function : functions) {
-		str << function.second->evaluate(logger).str << "\n";
+		str << function.second->evaluate(logger).str() << "\n";
+	}
+	// Sources of live definitions, to recompute them again after loading.
+	const auto& dependencies = _globals.getDependencies();
+	str << "DEPENDENCIES " << int(dependencies.size()) << "\n";
+	for (const auto& dependency : dependencies) {
+		str << dependency.second.source << "\n";
 	}
 }
 
@@ -382,6 +645,38 @@ void Calculator::loadFromStream(std::istream& str){
 		_globals.setFunc(funDef->name, funDef);
 
 	}
+	// Compile once all functions are known, to resolve overrides of standard library functions.
+	for(auto& func : _globals.getFuncs()){
+		compileFunction(*func.second);
+	}
+
+	// Older states don't list dependencies.
+	if (str >> dfltStr >> count && dfltStr == "DEPENDENCIES") {
+		std::getline(str, dfltStr);
+		for (int i = 0; i < count; ++i) {
+			Scope::Dependencies dependencies;
+			std::getline(str, dependencies.source);
+
+			Scanner scanner(dependencies.source);
+			const Status scanResult = scanner.scan();
+			if (!scanResult) {
+				continue;
+			}
+			Parser parser(scanner.tokens());
+			const Status parseResult = parser.parse();
+			if (!parseResult) {
+				continue;
+			}
+
+			if (auto varDef = std::dynamic_pointer_cast<VariableDef>(parser.tree())) {
+				ExpDependencies::collect(*varDef, dependencies);
+				_globals.setDependencies({ varDef->name, false }, dependencies);
+			} else if (auto funDef = std::dynamic_pointer_cast<FunctionDef>(parser.tree())) {
+				ExpDependencies::collect(*funDef, dependencies);
+				_globals.setDependencies({ funDef->name, true }, dependencies);
+			}
+		}
+	}
 
 	updateDocumentation(_doc.format());
 }
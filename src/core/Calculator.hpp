@@ -1,6 +1,9 @@
 #pragma once
 #include "core/Common.hpp"
 #include "core/Functions.hpp"
+#include "core/Batch.hpp"
+#include "core/InputCache.hpp"
+#include "core/Interval.hpp"
 #include <map>
 
 class Documentation {
@@ -49,21 +52,44 @@ private:
 class Calculator {
 public:
 
-	struct Word {
-		enum Type {
-			LITERAL = 0, VARIABLE, FUNCTION, OPERATOR, SEPARATOR, RESULT, COUNT
-		};
-
-		Type type;
-		long location;
-		long size;
-	};
+	using Word = ::Word;
 
 	Calculator();
 
 	bool evaluate(const std::string& input, Value& output, std::vector<Word>& info, Format& format, bool temporary);
 
 	bool evaluateFunction(const std::string& name, const std::vector<Value>& args, Value& output);
+
+	// Evaluate a function on outColumn.size() samples at once, results are converted to floats.
+	bool evaluateFunctionBatch(const std::string& name, const std::vector<Column>& argumentColumns, std::vector<double>& outColumn);
+
+	// Evaluate a function on count samples at once. Each call uses its own evaluator, so samples can be split
+	// between threads, as long as the calculator is not modified meanwhile.
+	bool evaluateFunctionBatch(const std::string& name, const std::vector<Column>& argumentColumns, double* outColumn, size_t count);
+
+	// Bound the results of a user function when its arguments vary in ranges. Returns false if it can't be bounded.
+	// As for batches, calls from several threads are allowed while the calculator is not modified.
+	bool evaluateFunctionInterval(const std::string& name, const std::vector<Interval>& args, Interval& output);
+
+	// Number of arguments of a user function, -1 if it is not defined.
+	int functionArgumentCount(const std::string& name) const;
+
+	// Copy of the current variables and functions, that can be evaluated on other threads while this calculator is modified.
+	std::shared_ptr<Calculator> snapshot() const;
+
+	// Incremented each time a definition changes, restarts from zero when cleared.
+	uint64_t version() const { return _globals.version(); }
+
+	// Cache the results of up to capacity calls for each user function, 0 to disable.
+	void setMemoCapacity(size_t capacity);
+
+	// In live mode, definitions are recomputed when a variable or function they refer to is redefined.
+	void setLiveMode(bool enabled){ _liveMode = enabled; }
+
+	bool liveMode() const { return _liveMode; }
+
+	// Functions recomputed in live mode by the last definition, in addition to the defined one.
+	const std::vector<std::string>& recomputedFunctions() const { return _recomputedFunctions; }
 	
 	void clear();
 
@@ -80,10 +106,37 @@ public:
 
 private:
 
+	// Number of inputs whose tokens, tree and last result are kept.
+	static constexpr size_t INPUT_CACHE_SIZE = 64;
+
+	bool evaluate(const std::string& input, InputCache::Entry& entry, Value& output, std::vector<Word>& info, Format& format, bool temporary);
+
+	void compileFunction(FunctionDef& def);
+
+	// Compile new or redefined functions, and compile again the functions calling them directly or not,
+	// as their programs are linked to the previous definitions.
+	void compileDefinitions(const std::unordered_set<std::string>& names);
+
+	void setupMemo(FunctionDef& def) const;
+
+	// Record the dependencies of a new definition, and recompute all definitions depending on it.
+	// Returns the names of the functions recomputed.
+	std::vector<std::string> updateDependents(const Scope::Definition& def, const Scope::Dependencies& dependencies, Format format);
+
+	// Evaluate again the source of a definition. Returns false if it fails, the previous definition is kept.
+	// A new function definition is not compiled, and neither are the functions calling it.
+	bool recompute(const std::string& source, Format format);
+
 	Scope _globals;
+	// Names of the functions whose programs call each name, entries of previous definitions might remain.
+	std::unordered_map<std::string, std::unordered_set<std::string>> _callers;
 	FunctionsLibrary _stdlib;
 	Documentation _doc;
+	InputCache _inputs;
 
 	unsigned long _funcCounter = 0;
+	size_t _memoCapacity = 0;
+	bool _liveMode = false;
+	std::vector<std::string> _recomputedFunctions;
 
 };
@@ -1,4 +1,6 @@
 #include "core/Evaluator.hpp"
+#include "core/Memo.hpp"
+#include <limits>
 
 static const std::vector<uint> opPrecedences = {
 	18u, 18u, 13u, 13u, 14u, 14u, 16u, 14u, 2u, 12u, 12u, 7u, 9u, 15u, 8u, 4u, 6u, 15u, 5u, 3u, 3u, 11u, 11u, 11u, 11u, 10u, 10u, 1u, 17u
@@ -15,7 +17,7 @@ Value ExpLogger::process(const Unary& exp)  {
 	}
 	std::string str = OperatorString(exp.op);
 	_precedences.push(prec);
-	str += exp.exp->evaluate(*this).str;
+	str += exp.exp->evaluate(*this).str();
 	_precedences.pop();
 
 	// If the parent has higher precedence, we should add parenthesis around this one.
@@ -28,8 +30,8 @@ Value ExpLogger::process(const Unary& exp)  {
 Value ExpLogger::process(const Binary& exp)  {
 	const uint prec = opPrecedences[uint(exp.op)];
 	_precedences.push(prec);
-	const std::string strL = exp.left->evaluate(*this).str;
-	const std::string strR = exp.right->evaluate(*this).str;
+	const std::string strL = exp.left->evaluate(*this).str();
+	const std::string strR = exp.right->evaluate(*this).str();
 	_precedences.pop();
 	std::string str = strL + " " + OperatorString(exp.op) + " " + strR;
 	// If the parent has higher precedence, we should add parenthesis around this one.
@@ -42,9 +44,9 @@ Value ExpLogger::process(const Binary& exp)  {
 Value ExpLogger::process(const Ternary& exp) {
 	const uint prec = 3u;
 	_precedences.push(prec);
-	const std::string strC = exp.condition->evaluate(*this).str;
-	const std::string strP = exp.pass->evaluate(*this).str;
-	const std::string strF = exp.fail->evaluate(*this).str;
+	const std::string strC = exp.condition->evaluate(*this).str();
+	const std::string strP = exp.pass->evaluate(*this).str();
+	const std::string strF = exp.fail->evaluate(*this).str();
 	_precedences.pop();
 
 	std::string str = strC + " ? " + strP + " : " + strF;
@@ -57,7 +59,7 @@ Value ExpLogger::process(const Ternary& exp) {
 Value ExpLogger::process(const Member& exp) {
 	const uint prec = 17u;
 	_precedences.push(prec);
-	std::string str = exp.parent->evaluate(*this).str;
+	std::string str = exp.parent->evaluate(*this).str();
 	str += "." + exp.member;
 	_precedences.pop();
 	if(_precedences.top() > prec){
@@ -78,7 +80,7 @@ Value ExpLogger::process(const Variable& exp) {
 
 Value ExpLogger::process(const VariableDef& exp) {
 	_precedences.push(0u);
-	const std::string varContent = exp.expr->evaluate(*this).str;
+	const std::string varContent = exp.expr->evaluate(*this).str();
 	_precedences.pop();
 	// Root, no parenthesis around a definition.
 	return exp.name + " = " + varContent;
@@ -92,7 +94,7 @@ Value ExpLogger::process(const FunctionDef& exp)  {
 		args += (aid != 0 ? ", " : "") + arg;
 	}
 	_precedences.push(0u);
-	const std::string funcContent = exp.expr->evaluate(*this).str;
+	const std::string funcContent = exp.expr->evaluate(*this).str();
 	_precedences.pop();
 	// Root, no parenthesis around a definition.
 	return exp.name + "(" + args + ") = " + funcContent;
@@ -113,7 +115,7 @@ Value ExpLogger::process(const FunctionCall& exp)  {
 	const size_t argCount = exp.args.size();
 	for(size_t aid = 0; aid < argCount; ++aid){
 		const auto& arg = exp.args[aid];
-		const std::string str = arg->evaluate(*this).str;
+		const std::string str = arg->evaluate(*this).str();
 		args += (aid != 0 ? ", " : "") + str;
 	}
 	_precedences.pop();
@@ -127,6 +129,7 @@ ExpEval::ExpEval(const Scope& scope, FunctionsLibrary& stdlib, const Format& for
 
 void ExpEval::setBase(Format format){
 	_format = Format((format & Format::BASE_MASK) | (_format & ~BASE_MASK));
+	++_baseChanges;
 }
 
 Value ExpEval::uOpIdentity(const Value& v){
@@ -136,13 +139,13 @@ Value ExpEval::uOpIdentity(const Value& v){
 		case Value::FLOAT:
 			return v.f;
 		case Value::VEC3:
-			return v.v3;
+			return v.v3();
 		case Value::MAT3:
-			return v.m3;
+			return v.m3();
 		case Value::VEC4:
-			return v.v4;
+			return v.v4();
 		case Value::MAT4:
-			return v.m4;
+			return v.m4();
 		default:
 			break;
 	}
@@ -156,13 +159,13 @@ Value ExpEval::uOpNegate(const Value& v){
 		case Value::FLOAT:
 			return -v.f;
 		case Value::VEC3:
-			return -v.v3;
+			return -v.v3();
 		case Value::MAT3:
-			return -v.m3;
+			return -v.m3();
 		case Value::VEC4:
-			return -v.v4;
+			return -v.v4();
 		case Value::MAT4:
-			return -v.m4;
+			return -v.m4();
 		default:
 			break;
 	}
@@ -185,22 +188,29 @@ Value ExpEval::uOpBoolNot(const Value& v){
 	EXIT(nullptr, "Unsupported type " + TypeString(v.type) + " for boolean negation.");
 }
 
+Value ExpEval::applyUnary(Operator op, const Value& v){
+	switch(op){
+		case Operator::Plus:
+			return uOpIdentity(v);
+		case Operator::Minus:
+			return uOpNegate(v);
+		case Operator::BitNot:
+			return uOpBitNot(v);
+		case Operator::BoolNot:
+			return uOpBoolNot(v);
+		default:
+			break;
+	}
+	EXIT(nullptr, "Unknown unary operator: " + OperatorString(op));
+}
+
 Value ExpEval::process(const Unary& exp)  {
 	Value v = exp.exp->evaluate(*this);
 	// Early exit.
 	if(_failed){
 		return false;
 	}
-
-	static const std::unordered_map<Operator, Value (ExpEval::*)(const Value& v)> unaryOps = {
-		{ Operator::Plus, &ExpEval::uOpIdentity }, { Operator::Minus, &ExpEval::uOpNegate },
-		{ Operator::BitNot, &ExpEval::uOpBitNot }, { Operator::BoolNot, &ExpEval::uOpBoolNot }
-	};
-	auto uOp = unaryOps.find(exp.op);
-	if(uOp != unaryOps.end()){
-		return (this->*(uOp->second))(v);
-	}
-	EXIT(&exp, "Unknown unary operator: " + OperatorString(exp.op));
+	return applyUnary(exp.op, v);
 }
 
 bool ExpEval::convertValues(const Value& l, const Value& r, Value::Type type, Value& outl, Value& outr){
@@ -229,13 +239,13 @@ Value ExpEval::bOpAddition(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f + outr.f;
 		case Value::VEC3:
-			return outl.v3 + outr.v3;
+			return outl.v3() + outr.v3();
 		case Value::MAT3:
-			return outl.m3 + outr.m3;
+			return outl.m3() + outr.m3();
 		case Value::VEC4:
-			return outl.v4 + outr.v4;
+			return outl.v4() + outr.v4();
 		case Value::MAT4:
-			return outl.m4 + outr.m4;
+			return outl.m4() + outr.m4();
 		default:
 			break;
 	}
@@ -254,13 +264,13 @@ Value ExpEval::bOpSubstraction(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f - outr.f;
 		case Value::VEC3:
-			return outl.v3 - outr.v3;
+			return outl.v3() - outr.v3();
 		case Value::MAT3:
-			return outl.m3 - outr.m3;
+			return outl.m3() - outr.m3();
 		case Value::VEC4:
-			return outl.v4 - outr.v4;
+			return outl.v4() - outr.v4();
 		case Value::MAT4:
-			return outl.m4 - outr.m4;
+			return outl.m4() - outr.m4();
 		default:
 			break;
 	}
@@ -271,16 +281,16 @@ Value ExpEval::bOpSubstraction(const Value& l, const Value& r){
 Value ExpEval::bOpProduct(const Value& l, const Value& r){
 	// Special case: matrix * vec or vec * matrix.
 	if(l.type == Value::MAT3 && r.type == Value::VEC3){
-		return l.m3 * r.v3;
+		return l.m3() * r.v3();
 	}
 	if(l.type == Value::VEC3 && r.type == Value::MAT3){
-		return l.v3 * r.m3;
+		return l.v3() * r.m3();
 	}
 	if(l.type == Value::MAT4 && r.type == Value::VEC4){
-		return l.m4 * r.v4;
+		return l.m4() * r.v4();
 	}
 	if(l.type == Value::VEC4 && r.type == Value::MAT4){
-		return l.v4 * r.m4;
+		return l.v4() * r.m4();
 	}
 
 	// All other cases are covered via type promotion.
@@ -294,13 +304,13 @@ Value ExpEval::bOpProduct(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f * outr.f;
 		case Value::VEC3:
-			return outl.v3 * outr.v3;
+			return outl.v3() * outr.v3();
 		case Value::MAT3:
-			return outl.m3 * outr.m3;
+			return outl.m3() * outr.m3();
 		case Value::VEC4:
-			return outl.v4 * outr.v4;
+			return outl.v4() * outr.v4();
 		case Value::MAT4:
-			return outl.m4 * outr.m4;
+			return outl.m4() * outr.m4();
 		default:
 			break;
 	}
@@ -317,13 +327,13 @@ Value ExpEval::bOpDivide(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f / outr.f;
 		case Value::VEC3:
-			return outl.v3 / outr.v3;
+			return outl.v3() / outr.v3();
 		case Value::MAT3:
-			return outl.m3 / outr.m3;
+			return outl.m3() / outr.m3();
 		case Value::VEC4:
-			return outl.v4 / outr.v4;
+			return outl.v4() / outr.v4();
 		case Value::MAT4:
-			return outl.m4 / outr.m4;
+			return outl.m4() / outr.m4();
 		default:
 			break;
 	}
@@ -339,9 +349,9 @@ Value ExpEval::bOpPower(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return glm::pow(outl.f, outr.f);
 		case Value::VEC3:
-			return glm::pow(outl.v3, outr.v3);
+			return glm::pow(outl.v3(), outr.v3());
 		case Value::VEC4:
-			return glm::pow(outl.v4, outr.v4);
+			return glm::pow(outl.v4(), outr.v4());
 		default:
 			break;
 	}
@@ -355,13 +365,20 @@ Value ExpEval::bOpModulo(const Value& l, const Value& r){
 	}
 	switch(outl.type){
 		case Value::INTEGER:
+			// Both trap instead of producing a value.
+			if(outr.i == 0){
+				EXIT(nullptr, "Integer modulo by zero.");
+			}
+			if(outr.i == -1 && outl.i == std::numeric_limits<long long>::min()){
+				EXIT(nullptr, "Integer modulo overflow.");
+			}
 			return outl.i % outr.i;
 		case Value::FLOAT:
 			return glm::mod(outl.f, outr.f);
 		case Value::VEC3:
-			return glm::mod(outl.v3, outr.v3);
+			return glm::mod(outl.v3(), outr.v3());
 		case Value::VEC4:
-			return glm::mod(outl.v4, outr.v4);
+			return glm::mod(outl.v4(), outr.v4());
 		default:
 			break;
 	}
@@ -395,9 +412,9 @@ Value ExpEval::bOpLessThan(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f < outr.f;
 		case Value::VEC3:
-			return glm::all(glm::lessThan(outl.v3, outr.v3));
+			return glm::all(glm::lessThan(outl.v3(), outr.v3()));
 		case Value::VEC4:
-			return glm::all(glm::lessThan(outl.v4, outr.v4));
+			return glm::all(glm::lessThan(outl.v4(), outr.v4()));
 		default:
 			break;
 	}
@@ -415,9 +432,9 @@ Value ExpEval::bOpGreaterThan(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f > outr.f;
 		case Value::VEC3:
-			return glm::all(glm::greaterThan(outl.v3, outr.v3));
+			return glm::all(glm::greaterThan(outl.v3(), outr.v3()));
 		case Value::VEC4:
-			return glm::all(glm::greaterThan(outl.v4, outr.v4));
+			return glm::all(glm::greaterThan(outl.v4(), outr.v4()));
 		default:
 			break;
 	}
@@ -435,9 +452,9 @@ Value ExpEval::bOpLessThanEqual(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f <= outr.f;
 		case Value::VEC3:
-			return glm::all(glm::lessThanEqual(outl.v3, outr.v3));
+			return glm::all(glm::lessThanEqual(outl.v3(), outr.v3()));
 		case Value::VEC4:
-			return glm::all(glm::lessThanEqual(outl.v4, outr.v4));
+			return glm::all(glm::lessThanEqual(outl.v4(), outr.v4()));
 		default:
 			break;
 	}
@@ -455,9 +472,9 @@ Value ExpEval::bOpGreaterThanEqual(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f >= outr.f;
 		case Value::VEC3:
-			return glm::all(glm::greaterThanEqual(outl.v3, outr.v3));
+			return glm::all(glm::greaterThanEqual(outl.v3(), outr.v3()));
 		case Value::VEC4:
-			return glm::all(glm::greaterThanEqual(outl.v4, outr.v4));
+			return glm::all(glm::greaterThanEqual(outl.v4(), outr.v4()));
 		default:
 			break;
 	}
@@ -477,13 +494,13 @@ Value ExpEval::bOpEqual(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f == outr.f;
 		case Value::VEC3:
-			return outl.v3 == outr.v3;
+			return outl.v3() == outr.v3();
 		case Value::MAT3:
-			return outl.m3 == outr.m3;
+			return outl.m3() == outr.m3();
 		case Value::VEC4:
-			return outl.v4 == outr.v4;
+			return outl.v4() == outr.v4();
 		case Value::MAT4:
-			return outl.m4 == outr.m4;
+			return outl.m4() == outr.m4();
 		default:
 			break;
 	}
@@ -503,13 +520,13 @@ Value ExpEval::bOpNotEqual(const Value& l, const Value& r){
 		case Value::FLOAT:
 			return outl.f != outr.f;
 		case Value::VEC3:
-			return outl.v3 != outr.v3;
+			return outl.v3() != outr.v3();
 		case Value::MAT3:
-			return outl.m3 != outr.m3;
+			return outl.m3() != outr.m3();
 		case Value::VEC4:
-			return outl.v4 != outr.v4;
+			return outl.v4() != outr.v4();
 		case Value::MAT4:
-			return outl.m4 != outr.m4;
+			return outl.m4() != outr.m4();
 		default:
 			break;
 	}
@@ -565,33 +582,72 @@ Value ExpEval::bOpBoolXor(const Value& l, const Value& r){
 }
 
 
-Value ExpEval::process(const Binary& exp)  {
+Value ExpEval::applyBinary(Operator op, const Value& l, const Value& r){
+	switch(op){
+		case Operator::Plus:
+			return bOpAddition(l, r);
+		case Operator::Minus:
+			return bOpSubstraction(l, r);
+		case Operator::Product:
+			return bOpProduct(l, r);
+		case Operator::Divide:
+			return bOpDivide(l, r);
+		case Operator::Power:
+			return bOpPower(l, r);
+		case Operator::Modulo:
+			return bOpModulo(l, r);
+		case Operator::ShiftLeft:
+			return bOpShiftLeft(l, r);
+		case Operator::ShiftRight:
+			return bOpShiftRight(l, r);
+		case Operator::LessThan:
+			return bOpLessThan(l, r);
+		case Operator::GreaterThan:
+			return bOpGreaterThan(l, r);
+		case Operator::LessThanEqual:
+			return bOpLessThanEqual(l, r);
+		case Operator::GreaterThanEqual:
+			return bOpGreaterThanEqual(l, r);
+		case Operator::Equal:
+			return bOpEqual(l, r);
+		case Operator::Different:
+			return bOpNotEqual(l, r);
+		case Operator::BitOr:
+			return bOpBitOr(l, r);
+		case Operator::BitAnd:
+			return bOpBitAnd(l, r);
+		case Operator::BitXor:
+			return bOpBitXor(l, r);
+		case Operator::BoolOr:
+			return bOpBoolOr(l, r);
+		case Operator::BoolAnd:
+			return bOpBoolAnd(l, r);
+		case Operator::BoolXor:
+			return bOpBoolXor(l, r);
+		default:
+			break;
+	}
+	EXIT(nullptr, "Unknown binary operator: " + OperatorString(op));
+}
 
-	// No notion of partial evaluation.
+Value ExpEval::process(const Binary& exp)  {
 	const Value l = exp.left->evaluate(*this);
-	const Value r = exp.right->evaluate(*this);
 	// Early exit.
 	if(_failed){
 		return false;
 	}
-
-	static const std::unordered_map<Operator, Value (ExpEval::*)(const Value& l, const Value& r)> binaryOps = {
-		{ Operator::Plus, &ExpEval::bOpAddition }, { Operator::Minus, &ExpEval::bOpSubstraction },
-		{ Operator::Product, &ExpEval::bOpProduct }, { Operator::Divide, &ExpEval::bOpDivide },
-		{ Operator::Power, &ExpEval::bOpPower }, { Operator::Modulo, &ExpEval::bOpModulo },
-		{ Operator::ShiftLeft, &ExpEval::bOpShiftLeft }, { Operator::ShiftRight, &ExpEval::bOpShiftRight },
-		{ Operator::LessThan, &ExpEval::bOpLessThan }, { Operator::GreaterThan, &ExpEval::bOpGreaterThan },
-		{ Operator::LessThanEqual, &ExpEval::bOpLessThanEqual },{ Operator::GreaterThanEqual, &ExpEval::bOpGreaterThanEqual },
-		{ Operator::Equal, &ExpEval::bOpEqual }, { Operator::Different, &ExpEval::bOpNotEqual },
-		{ Operator::BitOr, &ExpEval::bOpBitOr }, { Operator::BitAnd, &ExpEval::bOpBitAnd }, { Operator::BitXor, &ExpEval::bOpBitXor },
-		{ Operator::BoolOr, &ExpEval::bOpBoolOr }, { Operator::BoolAnd, &ExpEval::bOpBoolAnd }, { Operator::BoolXor, &ExpEval::bOpBoolXor },
-	};
-	auto bOp = binaryOps.find(exp.op);
-	if(bOp != binaryOps.end()){
-		return (this->*(bOp->second))(l, r);
+	// Short-circuit: skip the right operand if the left one decides the result.
+	if(exp.op == Operator::BoolAnd || exp.op == Operator::BoolOr){
+		Value lBool;
+		if(l.convert(Value::BOOL, lBool) && lBool.b == (exp.op == Operator::BoolOr)){
+			return lBool.b;
+		}
 	}
-
-	EXIT(&exp, "Unknown binary operator: " + OperatorString(exp.op));
+	const Value r = exp.right->evaluate(*this);
+	if(_failed){
+		return false;
+	}
+	return applyBinary(exp.op, l, r);
 }
 
 Value ExpEval::process(const Ternary& exp) {
@@ -610,39 +666,40 @@ Value ExpEval::process(const Ternary& exp) {
 	return exp.fail->evaluate(*this);
 }
 
-Value ExpEval::process(const Member& exp) {
-	Value par = exp.parent->evaluate(*this);
+Value ExpEval::applyMember(const Value& par, const std::string& member, const Expression* exp) {
 
 	// Only on vector types.
 	if(par.type != Value::VEC3 && par.type != Value::MAT3 && par.type != Value::VEC4 && par.type != Value::MAT4){
-		EXIT(&exp, "Subscripts are only supported on vector/matrix types.");
+		EXIT(exp, "Subscripts are only supported on vector/matrix types.");
 	}
 
 	// Check that the subscript can be converted to a set of indices.
-	static const std::unordered_map<char, size_t> getters = {
-		{'x', 0}, {'y', 1}, {'z', 2}, {'w', 3}
-	};
-
-	const size_t getSize = exp.member.size();
-	std::vector<size_t> indices(getSize);
-	for(size_t cid = 0; cid < getSize; ++cid){
-		const char& c = exp.member.at(cid);
-		if(getters.count(c) == 0){
-			EXIT(&exp, "Unknown subscript " + exp.member + ".");
+	Swizzle swizzle;
+	if(!Swizzle::parse(member, swizzle)){
+		// Size check (after the conversion, so that 'v.thing' triggers a better error message)
+		if(member.find_first_not_of("xyzw") == std::string::npos){
+			EXIT(exp, "Subscript " + member + " is too long.");
 		}
-		indices[cid] = getters.at(c);
+		EXIT(exp, "Unknown subscript " + member + ".");
 	}
+	return applySwizzle(par, swizzle, member, exp);
+}
 
-	// Size check (after the conversion, so that 'v.thing' triggers a better error message)
-	if(getSize > 4){
-		EXIT(&exp, "Subscript " + exp.member + " is too long.");
+Value ExpEval::applySwizzle(const Value& par, const Swizzle& swizzle, const std::string& member, const Expression* exp) {
+
+	// Only on vector types.
+	if(par.type != Value::VEC3 && par.type != Value::MAT3 && par.type != Value::VEC4 && par.type != Value::MAT4){
+		EXIT(exp, "Subscripts are only supported on vector/matrix types.");
 	}
 
+	const size_t getSize = swizzle.size;
+	const uchar* indices = swizzle.indices;
+
 	// Prevalidation for smaller types.
 	if(par.type == Value::VEC3 || par.type == Value::MAT3){
 		for(size_t cid = 0; cid < getSize; ++cid){
 			if(indices[cid] >= 3){
-				EXIT(&exp, "Subscript " + exp.member + " is out of bound for type " + TypeString(par.type) + ".");
+				EXIT(exp, "Subscript " + member + " is out of bound for type " + TypeString(par.type) + ".");
 			}
 		}
 	}
@@ -651,41 +708,46 @@ Value ExpEval::process(const Member& exp) {
 		case Value::VEC3:
 			using v3t = glm::vec3::length_type;
 			if(getSize == 1){
-				return par.v3[(v3t)indices[0]];
+				return par.v3()[(v3t)indices[0]];
 			}
 			if(getSize == 3){
-				return glm::vec3(par.v3[(v3t)indices[0]], par.v3[(v3t)indices[1]], par.v3[(v3t)indices[2]]);
+				return glm::vec3(par.v3()[(v3t)indices[0]], par.v3()[(v3t)indices[1]], par.v3()[(v3t)indices[2]]);
 			}
 			if(getSize == 4){
-				return glm::vec4(par.v3[(v3t)indices[0]], par.v3[(v3t)indices[1]], par.v3[(v3t)indices[2]], par.v3[(v3t)indices[3]]);
+				return glm::vec4(par.v3()[(v3t)indices[0]], par.v3()[(v3t)indices[1]], par.v3()[(v3t)indices[2]], par.v3()[(v3t)indices[3]]);
 			}
 			break;
 		case Value::VEC4:
 			using v4t = glm::vec4::length_type;
 			if(getSize == 1){
-				return par.v4[(v4t)indices[0]];
+				return par.v4()[(v4t)indices[0]];
 			}
 			if(getSize == 3){
-				return glm::vec3(par.v4[(v4t)indices[0]], par.v4[(v4t)indices[1]], par.v4[(v4t)indices[2]]);
+				return glm::vec3(par.v4()[(v4t)indices[0]], par.v4()[(v4t)indices[1]], par.v4()[(v4t)indices[2]]);
 			}
 			if(getSize == 4){
-				return glm::vec4(par.v4[(v4t)indices[0]], par.v4[(v4t)indices[1]], par.v4[(v4t)indices[2]], par.v4[(v4t)indices[3]]);
+				return glm::vec4(par.v4()[(v4t)indices[0]], par.v4()[(v4t)indices[1]], par.v4()[(v4t)indices[2]], par.v4()[(v4t)indices[3]]);
 			}
 			break;
 		case Value::MAT3:
 			if(getSize == 1){
-				return par.m3[(glm::mat3::length_type)indices[0]];
+				return par.m3()[(glm::mat3::length_type)indices[0]];
 			}
 			break;
 		case Value::MAT4:
 			if(getSize == 1){
-				return par.m4[(glm::mat4::length_type)indices[0]];
+				return par.m4()[(glm::mat4::length_type)indices[0]];
 			}
 			break;
 		default:
 			break;
 	}
-	EXIT(&exp, "Unsupported subscript " + exp.member + " for type " + TypeString(par.type) + ".");
+	EXIT(exp, "Unsupported subscript " + member + " for type " + TypeString(par.type) + ".");
+}
+
+Value ExpEval::process(const Member& exp) {
+	const Value par = exp.parent->evaluate(*this);
+	return applyMember(par, exp.member, &exp);
 }
 
 Value ExpEval::process(const Literal& exp) {
@@ -742,11 +804,9 @@ Value ExpEval::process(const FunctionDef& exp)  {
 }
 
 Value ExpEval::process(const FunctionCall& exp)  {
-	const size_t argCount = exp.args.size();
-
 	// Evaluate all arguments.
 	std::vector<Value> argValues;
-	argValues.reserve(argCount);
+	argValues.reserve(exp.args.size());
 	for(const auto& arg : exp.args){
 		argValues.push_back(arg->evaluate(*this));
 	}
@@ -754,40 +814,147 @@ Value ExpEval::process(const FunctionCall& exp)  {
 	if(_failed){
 		return false;
 	}
+	return callFunction(exp.name, argValues, &exp);
+}
+
+Value ExpEval::callFunction(const std::string& name, const std::vector<Value>& args, const Expression* exp)  {
+	const size_t argCount = args.size();
 
 	// Check user defined functions
-	if(_globalScope.hasFunc(exp.name)){
-		// Populate local variable context with arguments
-		const auto& funcDef = _globalScope.getFunc(exp.name);
+	if(_globalScope.hasFunc(name)){
+		const auto& funcDef = _globalScope.getFunc(name);
 		const size_t expectedCount = funcDef->args.size();
 		if(expectedCount != argCount){
 			// By exiting early here, we don't allow user overrides of standard library functions with a different number of arguments.
-			EXIT(&exp, "Incorrect number of arguments for function " + exp.name + ", expected " + std::to_string(expectedCount) + ".");
+			EXIT(exp, "Incorrect number of arguments for function " + name + ", expected " + std::to_string(expectedCount) + ".");
 		}
-
-		Scope& currentScope = _localScopes.emplace();
-		for(size_t aid = 0; aid < argCount; ++aid){
-			currentScope.setVar(funcDef->args[aid], argValues[aid]);
+		const Value result = evaluateFunction(*funcDef, args);
+		// Errors are reported at the call site, as the function body was parsed from another input.
+		if(_failed){
+			_failedExpression = exp;
 		}
-		const Value res = funcDef->expr->evaluate(*this);
-		_localScopes.pop();
-		return res;
+		return result;
 	}
 
-	if(_stdlib.hasFunc(exp.name)){
+	const FunctionsLibrary::FunctionInfos* builtin = _stdlib.find(name);
+	if(builtin){
 		// Check if number of arguments is valid.
-		if(!_stdlib.validArgCount(exp.name, exp.args.size())){
-			EXIT(&exp, "Incorrect number of arguments for function " + exp.name + ".");
+		if(!_stdlib.validArgCount(*builtin, argCount)){
+			EXIT(exp, "Incorrect number of arguments for function " + name + ".");
 		}
-		const Value result = _stdlib.eval(exp.name, argValues, *this);
-		// If we are here, the failed flag can only mean that the failure was encountered during the function evaluation (thanks to the early exit above).
+		const Value result = _stdlib.eval(*builtin, args, *this);
+		// If we are here, the failed flag can only mean that the failure was encountered during the function evaluation (thanks to the early exit in the callers).
 		if(_failed){
-			_failedExpression = &exp;
+			_failedExpression = exp;
 		}
 		return result;
 	}
 
-	EXIT(&exp, "Undefined function " + exp.name + ".");
+	EXIT(exp, "Undefined function " + name + ".");
+}
+
+Value ExpEval::callFunction(const Program::Callee& callee, const std::vector<Value>& args){
+	if(callee.function){
+		return evaluateFunction(*callee.function, args);
+	}
+	if(callee.builtin){
+		return _stdlib.eval(*callee.builtin, args, *this);
+	}
+	// Unresolved, report the error.
+	return callFunction(callee.name, args, nullptr);
+}
+
+Value ExpEval::evaluateFunction(const FunctionDef& def, const std::vector<Value>& args){
+	assert(def.args.size() == args.size());
+	// Prefer the compiled version when available.
+	if(def.program){
+		return _vm.run(*def.program, def.memo.get(), args.data(), *this);
+	}
+
+	Value res;
+	if(def.memo && def.memo->find(args.data(), args.size(), res)){
+		return res;
+	}
+	const uint baseChanges = _baseChanges;
+	// Populate local variable context with arguments
+	Scope& currentScope = _localScopes.emplace();
+	const size_t argCount = args.size();
+	for(size_t aid = 0; aid < argCount; ++aid){
+		currentScope.setVar(def.args[aid], args[aid]);
+	}
+	res = def.expr->evaluate(*this);
+	_localScopes.pop();
+	if(def.memo && !_failed && _baseChanges == baseChanges){
+		def.memo->insert(args.data(), args.size(), res);
+	}
+	return res;
+}
+
+const FunctionDef* ExpEval::findFunction(const std::string& name) const {
+	return _globalScope.hasFunc(name) ? _globalScope.getFunc(name).get() : nullptr;
+}
+
+ExpDependencies::ExpDependencies(Scope::Dependencies& dependencies) : _dependencies(dependencies) {
+}
+
+void ExpDependencies::collect(Expression& exp, Scope::Dependencies& dependencies){
+	ExpDependencies collector(dependencies);
+	exp.evaluate(collector);
+}
+
+Value ExpDependencies::process(const Unary& exp) {
+	return exp.exp->evaluate(*this);
+}
+
+Value ExpDependencies::process(const Binary& exp) {
+	exp.left->evaluate(*this);
+	return exp.right->evaluate(*this);
+}
+
+Value ExpDependencies::process(const Ternary& exp) {
+	exp.condition->evaluate(*this);
+	exp.pass->evaluate(*this);
+	return exp.fail->evaluate(*this);
+}
+
+Value ExpDependencies::process(const Member& exp) {
+	return exp.parent->evaluate(*this);
+}
+
+Value ExpDependencies::process(const Literal& exp) {
+	(void)exp;
+	return true;
+}
+
+Value ExpDependencies::process(const Variable& exp) {
+	_dependencies.variables.insert(exp.name);
+	return true;
+}
+
+Value ExpDependencies::process(const VariableDef& exp) {
+	return exp.expr->evaluate(*this);
+}
+
+Value ExpDependencies::process(const FunctionDef& exp) {
+	exp.expr->evaluate(*this);
+	// Arguments are not global variables.
+	for(const std::string& arg : exp.args){
+		_dependencies.variables.erase(arg);
+	}
+	return true;
+}
+
+Value ExpDependencies::process(FunctionVar& exp) {
+	_dependencies.variables.insert(exp.name);
+	return true;
+}
+
+Value ExpDependencies::process(const FunctionCall& exp) {
+	_dependencies.functions.insert(exp.name);
+	for(const auto& arg : exp.args){
+		arg->evaluate(*this);
+	}
+	return true;
 }
 
 FuncSubstitution::FuncSubstitution(const Scope& scope, const FunctionsLibrary& stdlib, const std::vector<std::string>& argNames, const std::string& id)
@@ -883,3 +1050,763 @@ Value FuncSubstitution::process(const FunctionCall& exp)  {
 	}
 	EXIT(&exp, "Undefined function " + exp.name + ".");
 }
+
+namespace {
+
+	const uint ALL_TYPES = (1u << (uint(Value::STRING) + 1u)) - 1u;
+
+	uint typeBit(Value::Type type){
+		return 1u << uint(type);
+	}
+
+	// Check that all possible types are in the [minType, maxType] range.
+	bool typesInRange(uint types, Value::Type minType, Value::Type maxType){
+		uint allowed = 0u;
+		for(uint type = minType; type <= uint(maxType); ++type){
+			allowed |= 1u << type;
+		}
+		return types != 0u && (types & ~allowed) == 0u;
+	}
+
+	// Representative value of each type, to infer the result type of operations.
+	const Value& typeSample(uint type){
+		static const std::vector<Value> samples = {
+			Value(true), Value(2ll), Value(2.0), Value(glm::vec3(2.0f)), Value(glm::vec4(2.0f)), Value(glm::mat3(2.0f)), Value(glm::mat4(2.0f)), Value(std::string("a"))
+		};
+		return samples[type];
+	}
+
+	bool isLiteral(const Expression::Ptr& exp){
+		return dynamic_cast<const Literal*>(exp) != nullptr;
+	}
+
+	// Check if an expression is a scalar literal equal to the target, and return its type.
+	bool isScalarLiteral(const Expression::Ptr& exp, double target, Value::Type& type){
+		const Literal* lit = dynamic_cast<const Literal*>(exp);
+		if(lit == nullptr || lit->val.type > Value::FLOAT){
+			return false;
+		}
+		Value litFloat;
+		lit->val.convert(Value::FLOAT, litFloat);
+		type = lit->val.type;
+		return litFloat.f == target;
+	}
+
+}
+
+FuncOptimizer::FuncOptimizer(const Scope& scope, FunctionsLibrary& stdlib, Arena& arena) : _globalScope(scope), _stdlib(stdlib), _arena(arena) {
+}
+
+void FuncOptimizer::setResult(const Expression::Ptr& exp, TypeSet types){
+	_result = exp;
+	_types = types;
+}
+
+void FuncOptimizer::fold(const Expression::Ptr& exp){
+	ExpEval evaluator(_globalScope, _stdlib, Format::INTERNAL);
+	const Value val = exp->evaluate(evaluator);
+	// Keep failing expressions, the error will be reported when calling the function.
+	if(evaluator.hasFailed()){
+		setResult(exp, ALL_TYPES);
+		return;
+	}
+	setResult(_arena.make<Literal>(val, exp->dbgStartPos), typeBit(val.type));
+}
+
+FuncOptimizer::TypeSet FuncOptimizer::unaryTypes(Operator op, TypeSet types){
+	TypeSet res = 0u;
+	for(uint type = 0u; type <= uint(Value::STRING); ++type){
+		if(types & (1u << type)){
+			ExpEval evaluator(_globalScope, _stdlib, Format::INTERNAL);
+			const Value val = evaluator.applyUnary(op, typeSample(type));
+			res |= evaluator.hasFailed() ? 0u : typeBit(val.type);
+		}
+	}
+	return res;
+}
+
+FuncOptimizer::TypeSet FuncOptimizer::binaryTypes(Operator op, TypeSet l, TypeSet r){
+	TypeSet res = 0u;
+	for(uint typeL = 0u; typeL <= uint(Value::STRING); ++typeL){
+		if((l & (1u << typeL)) == 0u){
+			continue;
+		}
+		for(uint typeR = 0u; typeR <= uint(Value::STRING); ++typeR){
+			if(r & (1u << typeR)){
+				ExpEval evaluator(_globalScope, _stdlib, Format::INTERNAL);
+				const Value val = evaluator.applyBinary(op, typeSample(typeL), typeSample(typeR));
+				res |= evaluator.hasFailed() ? 0u : typeBit(val.type);
+			}
+		}
+	}
+	return res;
+}
+
+FuncOptimizer::TypeSet FuncOptimizer::memberTypes(const std::string& member, TypeSet types){
+	TypeSet res = 0u;
+	for(uint type = 0u; type <= uint(Value::STRING); ++type){
+		if(types & (1u << type)){
+			ExpEval evaluator(_globalScope, _stdlib, Format::INTERNAL);
+			const Value val = evaluator.applyMember(typeSample(type), member, nullptr);
+			res |= evaluator.hasFailed() ? 0u : typeBit(val.type);
+		}
+	}
+	return res;
+}
+
+Value FuncOptimizer::process(const Unary& exp)  {
+	Operator op = exp.op;
+	const Expression* src = &exp;
+	const Unary* inner = dynamic_cast<const Unary*>(exp.exp);
+	// Double negations cancel out, if the operand type is preserved.
+	if(inner && inner->op == op && (op == Operator::Minus || op == Operator::BoolNot)){
+		if(!inner->exp->evaluate(*this).b){
+			return false;
+		}
+		const bool negation = op == Operator::Minus;
+		if(typesInRange(_types, negation ? Value::INTEGER : Value::BOOL, negation ? Value::MAT4 : Value::BOOL)){
+			return true;
+		}
+		const Expression::Ptr innerNode = _arena.make<Unary>(op, _result, inner->dbgStartPos, inner->dbgEndPos);
+		if(isLiteral(_result)){
+			fold(innerNode);
+		} else {
+			setResult(innerNode, unaryTypes(op, _types));
+		}
+	} else {
+		if(!exp.exp->evaluate(*this).b){
+			return false;
+		}
+	}
+
+	const Expression::Ptr node = _arena.make<Unary>(op, _result, src->dbgStartPos, src->dbgEndPos);
+	if(isLiteral(_result)){
+		fold(node);
+		return true;
+	}
+	// Identity.
+	if(op == Operator::Plus && typesInRange(_types, Value::INTEGER, Value::MAT4)){
+		return true;
+	}
+	setResult(node, unaryTypes(op, _types));
+	return true;
+}
+
+Value FuncOptimizer::process(const Binary& exp)  {
+	if(!exp.left->evaluate(*this).b){
+		return false;
+	}
+	const Expression::Ptr left = _result;
+	const TypeSet leftTypes = _types;
+	if(!exp.right->evaluate(*this).b){
+		return false;
+	}
+	const Expression::Ptr right = _result;
+	const TypeSet rightTypes = _types;
+
+	const Expression::Ptr node = _arena.make<Binary>(exp.op, left, right, exp.dbgStartPos, exp.dbgEndPos);
+	if(isLiteral(left) && isLiteral(right)){
+		fold(node);
+		return true;
+	}
+
+	// The right operand is never evaluated when a constant left operand decides the result.
+	if((exp.op == Operator::BoolAnd || exp.op == Operator::BoolOr) && isLiteral(left)){
+		Value leftBool;
+		if(static_cast<const Literal*>(left)->val.convert(Value::BOOL, leftBool) && leftBool.b == (exp.op == Operator::BoolOr)){
+			setResult(_arena.make<Literal>(leftBool, exp.dbgStartPos), typeBit(Value::BOOL));
+			return true;
+		}
+	}
+
+	// Identities are only applied when the operand type is preserved by the promotion rules.
+	// Floats are excluded from x+0 as -0.0 + 0 is 0.0, matrices from x*1 as it is a matrix product.
+	Value::Type litType = Value::BOOL;
+	switch(exp.op){
+		case Operator::Product:
+			if(isScalarLiteral(right, 1.0, litType) && typesInRange(leftTypes, std::max(litType, Value::INTEGER), Value::VEC4)){
+				setResult(left, leftTypes);
+				return true;
+			}
+			if(isScalarLiteral(left, 1.0, litType) && typesInRange(rightTypes, std::max(litType, Value::INTEGER), Value::VEC4)){
+				setResult(right, rightTypes);
+				return true;
+			}
+			break;
+		case Operator::Divide:
+			if(isScalarLiteral(right, 1.0, litType) && typesInRange(leftTypes, Value::FLOAT, Value::VEC4)){
+				setResult(left, leftTypes);
+				return true;
+			}
+			break;
+		case Operator::Plus:
+			if(isScalarLiteral(right, 0.0, litType) && typesInRange(leftTypes, std::max(litType, Value::INTEGER), Value::INTEGER)){
+				setResult(left, leftTypes);
+				return true;
+			}
+			if(isScalarLiteral(left, 0.0, litType) && typesInRange(rightTypes, std::max(litType, Value::INTEGER), Value::INTEGER)){
+				setResult(right, rightTypes);
+				return true;
+			}
+			break;
+		case Operator::Minus:
+			if(isScalarLiteral(right, 0.0, litType) && typesInRange(leftTypes, std::max(litType, Value::INTEGER), Value::MAT4)){
+				setResult(left, leftTypes);
+				return true;
+			}
+			break;
+		default:
+			break;
+	}
+	setResult(node, binaryTypes(exp.op, leftTypes, rightTypes));
+	return true;
+}
+
+Value FuncOptimizer::process(const Ternary& exp) {
+	if(!exp.condition->evaluate(*this).b){
+		return false;
+	}
+	// Only keep the selected branch if the condition is known.
+	const Literal* condLit = dynamic_cast<const Literal*>(_result);
+	Value condBool;
+	if(condLit && condLit->val.convert(Value::BOOL, condBool)){
+		return condBool.b ? exp.pass->evaluate(*this) : exp.fail->evaluate(*this);
+	}
+	const Expression::Ptr condition = _result;
+
+	if(!exp.pass->evaluate(*this).b){
+		return false;
+	}
+	const Expression::Ptr pass = _result;
+	const TypeSet passTypes = _types;
+	if(!exp.fail->evaluate(*this).b){
+		return false;
+	}
+	setResult(_arena.make<Ternary>(condition, pass, _result, exp.dbgStartPos, exp.dbgEndPos), passTypes | _types);
+	return true;
+}
+
+Value FuncOptimizer::process(const Member& exp) {
+	if(!exp.parent->evaluate(*this).b){
+		return false;
+	}
+	const Expression::Ptr node = _arena.make<Member>(_result, exp.member, exp.dbgStartPos);
+	if(isLiteral(_result)){
+		fold(node);
+		return true;
+	}
+	setResult(node, memberTypes(exp.member, _types));
+	return true;
+}
+
+Value FuncOptimizer::process(const Literal& exp) {
+	setResult(_arena.make<Literal>(exp.val, exp.dbgStartPos), typeBit(exp.val.type));
+	return true;
+}
+
+Value FuncOptimizer::process(const Variable& exp) {
+	EXIT(&exp, "Unexpected variable " + exp.name + " in function declaration.");
+}
+
+Value FuncOptimizer::process(const VariableDef& exp) {
+	EXIT(&exp, "Unexpected variable definition (" + exp.name + ") in function declaration.");
+}
+
+Value FuncOptimizer::process(const FunctionDef& exp) {
+	EXIT(&exp, "Unexpected nested function declaration (" + exp.name + ").");
+}
+
+Value FuncOptimizer::process(FunctionVar& exp) {
+	// Baked global variables are constants.
+	if(exp.hasValue()){
+		setResult(_arena.make<Literal>(exp.value(), exp.dbgStartPos), typeBit(exp.value().type));
+		return true;
+	}
+	setResult(_arena.make<FunctionVar>(exp.name, exp.dbgStartPos), ALL_TYPES);
+	return true;
+}
+
+Value FuncOptimizer::process(const FunctionCall& exp)  {
+	const size_t argCount = exp.args.size();
+	std::vector<Expression::Ptr> args(argCount);
+	bool constant = true;
+	for(size_t aid = 0; aid < argCount; ++aid){
+		if(!exp.args[aid]->evaluate(*this).b){
+			return false;
+		}
+		args[aid] = _result;
+		constant = constant && isLiteral(_result);
+	}
+	const Expression::Ptr node = _arena.make<FunctionCall>(exp.name, args, exp.dbgStartPos, exp.dbgEndPos);
+	// User functions are resolved at call time, and base conversion functions modify the evaluator format.
+	const bool pure = !_globalScope.hasFunc(exp.name) && _stdlib.hasFunc(exp.name)
+		&& exp.name != "bin" && exp.name != "hex" && exp.name != "oct" && exp.name != "dec";
+	if(constant && pure){
+		fold(node);
+		return true;
+	}
+	setResult(node, ALL_TYPES);
+	return true;
+}
+
+Expression::Ptr FuncOptimizer::optimize(const FunctionDef& def, const Scope& scope, FunctionsLibrary& stdlib, Arena& arena){
+	FuncOptimizer optimizer(scope, stdlib, arena);
+	if(!def.expr->evaluate(optimizer).b || optimizer.hasFailed()){
+		return def.expr;
+	}
+	return optimizer._result;
+}
+
+FuncCompiler::FuncCompiler(const std::vector<std::string>& argNames, const Scope& scope) : _names(argNames), _scope(scope), _program(new Program()) {
+	// Arguments occupy the first registers of a frame.
+	_program->_argCount = uint(_names.size());
+	_program->_registerCount = _program->_argCount;
+}
+
+uint FuncCompiler::emit(Instruction::Code code, Operator op, uint a, uint b, uint c){
+	const uint dst = _program->_registerCount++;
+	_program->_instructions.push_back({ code, op, dst, a, b, c });
+	return dst;
+}
+
+Value FuncCompiler::process(const Unary& exp)  {
+	if(!exp.exp->evaluate(*this).b){
+		return false;
+	}
+	_operand = emit(Instruction::Code::UNARY, exp.op, _operand, 0, 0);
+	return true;
+}
+
+Value FuncCompiler::process(const Binary& exp)  {
+	if(!exp.left->evaluate(*this).b){
+		return false;
+	}
+	const uint left = _operand;
+
+	// Short-circuit if the right operand calls user functions. Other operands are cheaper to evaluate than a branch,
+	// and straight-line code can be compiled to native code.
+	if(exp.op == Operator::BoolAnd || exp.op == Operator::BoolOr){
+		Scope::Dependencies dependencies;
+		ExpDependencies::collect(*exp.right, dependencies);
+		const bool callsUser = std::any_of(dependencies.functions.begin(), dependencies.functions.end(), [this](const std::string& name){
+			return _scope.hasFunc(name);
+		});
+		if(callsUser){
+			return compileShortCircuit(exp, left);
+		}
+	}
+
+	if(!exp.right->evaluate(*this).b){
+		return false;
+	}
+	_operand = emit(Instruction::Code::BINARY, exp.op, left, _operand, 0);
+	return true;
+}
+
+Value FuncCompiler::compileShortCircuit(const Binary& exp, uint left){
+	// Same layout as a ternary operator, the right operand is evaluated in one of the branches.
+	const bool isAnd = exp.op == Operator::BoolAnd;
+	const uint decided = uint(_program->_constants.size()) | Instruction::CONSTANT_FLAG;
+	_program->_constants.push_back(Value(!isAnd));
+
+	const uint result = _program->_registerCount++;
+	const size_t condJump = _program->_instructions.size();
+	_program->_instructions.push_back({ Instruction::Code::JUMP_IF_FALSE, exp.op, 0, left, 0, 0 });
+
+	auto compileRight = [this, &exp, left, result](){
+		if(!exp.right->evaluate(*this).b){
+			return false;
+		}
+		const uint value = emit(Instruction::Code::BINARY, exp.op, left, _operand, 0);
+		_program->_instructions.push_back({ Instruction::Code::MOVE, Operator::Assign, result, value, 0, 0 });
+		return true;
+	};
+
+	// a && b: b if a is true, else false. a || b: true if a is true, else b.
+	if(isAnd){
+		if(!compileRight()){
+			return false;
+		}
+	} else {
+		_program->_instructions.push_back({ Instruction::Code::MOVE, Operator::Assign, result, decided, 0, 0 });
+	}
+	const size_t endJump = _program->_instructions.size();
+	_program->_instructions.push_back({ Instruction::Code::JUMP, exp.op, 0, 0, 0, 0 });
+
+	_program->_instructions[condJump].b = uint(_program->_instructions.size());
+	if(isAnd){
+		_program->_instructions.push_back({ Instruction::Code::MOVE, Operator::Assign, result, decided, 0, 0 });
+	} else if(!compileRight()){
+		return false;
+	}
+	_program->_instructions[endJump].b = uint(_program->_instructions.size());
+
+	_operand = result;
+	return true;
+}
+
+Value FuncCompiler::process(const Ternary& exp) {
+	if(!exp.condition->evaluate(*this).b){
+		return false;
+	}
+	// Only one of the two branches is executed.
+	const uint result = _program->_registerCount++;
+	const size_t condJump = _program->_instructions.size();
+	_program->_instructions.push_back({ Instruction::Code::JUMP_IF_FALSE, Operator::QuestionMark, 0, _operand, 0, 0 });
+
+	if(!exp.pass->evaluate(*this).b){
+		return false;
+	}
+	_program->_instructions.push_back({ Instruction::Code::MOVE, Operator::Assign, result, _operand, 0, 0 });
+	const size_t endJump = _program->_instructions.size();
+	_program->_instructions.push_back({ Instruction::Code::JUMP, Operator::Colon, 0, 0, 0, 0 });
+
+	_program->_instructions[condJump].b = uint(_program->_instructions.size());
+	if(!exp.fail->evaluate(*this).b){
+		return false;
+	}
+	_program->_instructions.push_back({ Instruction::Code::MOVE, Operator::Assign, result, _operand, 0, 0 });
+	_program->_instructions[endJump].b = uint(_program->_instructions.size());
+
+	_operand = result;
+	return true;
+}
+
+Value FuncCompiler::process(const Member& exp) {
+	if(!exp.parent->evaluate(*this).b){
+		return false;
+	}
+	const uint subscriptId = uint(_program->_subscripts.size());
+	_program->_subscripts.emplace_back();
+	_program->_subscripts.back().member = exp.member;
+	_operand = emit(Instruction::Code::MEMBER, Operator::Dot, _operand, 0, subscriptId);
+	return true;
+}
+
+Value FuncCompiler::process(const Literal& exp) {
+	_operand = uint(_program->_constants.size()) | Instruction::CONSTANT_FLAG;
+	_program->_constants.push_back(exp.val);
+	return true;
+}
+
+Value FuncCompiler::process(const Variable& exp) {
+	// This should not happen in a function declaration.
+	EXIT(&exp, "Unexpected variable " + exp.name + " in function declaration.");
+}
+
+Value FuncCompiler::process(const VariableDef& exp) {
+	EXIT(&exp, "Unexpected variable definition (" + exp.name + ") in function declaration.");
+}
+
+Value FuncCompiler::process(const FunctionDef& exp) {
+	EXIT(&exp, "Unexpected nested function declaration (" + exp.name + ").");
+}
+
+Value FuncCompiler::process(FunctionVar& exp) {
+	// Baked global value.
+	if(exp.hasValue()){
+		_operand = uint(_program->_constants.size()) | Instruction::CONSTANT_FLAG;
+		_program->_constants.push_back(exp.value());
+		return true;
+	}
+	// Argument.
+	const auto arg = std::find(_names.begin(), _names.end(), exp.name);
+	if(arg != _names.end()){
+		_operand = uint(arg - _names.begin());
+		return true;
+	}
+	EXIT(&exp, "Undefined variable " + exp.name + ".");
+}
+
+Value FuncCompiler::process(const FunctionCall& exp)  {
+	std::vector<uint> operands;
+	operands.reserve(exp.args.size());
+	for(auto& arg : exp.args){
+		if(!arg->evaluate(*this).b){
+			return false;
+		}
+		operands.push_back(_operand);
+	}
+	const uint firstOperand = uint(_program->_operands.size());
+	_program->_operands.insert(_program->_operands.end(), operands.begin(), operands.end());
+	// Functions are resolved when linking, as user functions can be redefined.
+	const uint calleeId = uint(_program->_callees.size());
+	_program->_callees.emplace_back();
+	_program->_callees.back().name = exp.name;
+	_program->_callees.back().argCount = uint(operands.size());
+	_operand = emit(Instruction::Code::CALL, Operator::OpenParenth, firstOperand, uint(operands.size()), calleeId);
+	return true;
+}
+
+std::shared_ptr<const Program> FuncCompiler::compile(const FunctionDef& def, const Expression::Ptr& expr, const Scope& scope, const FunctionsLibrary& stdlib){
+	FuncCompiler compiler(def.args, scope);
+	if(!expr->evaluate(compiler).b || compiler.hasFailed()){
+		// The tree evaluation will be used instead.
+		return nullptr;
+	}
+	compiler._program->_result = compiler._operand;
+	compiler._program->link(scope, stdlib);
+	return compiler._program;
+}
+
+namespace {
+
+	// Markers for registers without a single known type.
+	const uchar UNSET_TYPE = 0xFE;
+	const uchar DYNAMIC_TYPE = 0xFF;
+
+	bool isKnownScalar(uchar type){
+		return type <= Value::FLOAT;
+	}
+
+}
+
+FuncSpecializer::FuncSpecializer(const Program& program, ExpEval& evaluator) : _program(program), _evaluator(evaluator), _specialization(new Specialization()) {
+	_specialization->constants = program._constants;
+	_specialization->registerCount = program._registerCount;
+	_types.resize(program._registerCount, UNSET_TYPE);
+}
+
+std::unique_ptr<const Specialization> FuncSpecializer::specialize(const Program& program, const Value::Type* argTypes, ExpEval& evaluator){
+	FuncSpecializer specializer(program, evaluator);
+	for(uint aid = 0; aid < program._argCount; ++aid){
+		specializer._types[aid] = uchar(argTypes[aid]);
+	}
+
+	const size_t instructionCount = program._instructions.size();
+	// Conversions are inserted, keep track of where each instruction ends up for jumps.
+	std::vector<uint> newPcs(instructionCount + 1);
+	std::vector<Instruction>& instructions = specializer._specialization->instructions;
+	for(size_t pc = 0; pc < instructionCount; ++pc){
+		newPcs[pc] = uint(instructions.size());
+		const Instruction& ins = program._instructions[pc];
+		switch(ins.code){
+			case Instruction::Code::UNARY:
+				specializer.specializeUnary(ins);
+				break;
+			case Instruction::Code::BINARY:
+				specializer.specializeBinary(ins);
+				break;
+			case Instruction::Code::MEMBER:
+				specializer.specializeMember(ins);
+				break;
+			case Instruction::Code::CALL:
+				specializer.specializeCall(ins);
+				break;
+			case Instruction::Code::MOVE:
+				// Both branches of a conditional write to the same register.
+				instructions.push_back(ins);
+				specializer.setType(ins.dst, specializer.typeOf(ins.a));
+				break;
+			default:
+				instructions.push_back(ins);
+				break;
+		}
+	}
+	newPcs[instructionCount] = uint(instructions.size());
+	for(Instruction& ins : instructions){
+		if(ins.code == Instruction::Code::JUMP || ins.code == Instruction::Code::JUMP_IF_FALSE){
+			ins.b = newPcs[ins.b];
+		}
+	}
+
+	const uchar resultType = specializer.typeOf(program._result);
+	specializer._specialization->resultKnown = resultType <= Value::STRING;
+	specializer._specialization->result = specializer._specialization->resultKnown ? Value::Type(resultType) : Value::STRING;
+	// Functions of floats only can be compiled to native code.
+	if(std::all_of(argTypes, argTypes + program._argCount, [](Value::Type type){ return type == Value::FLOAT; })){
+		specializer._specialization->native = JitFunction::compile(program, *specializer._specialization);
+	}
+	return std::move(specializer._specialization);
+}
+
+void FuncSpecializer::specializeUnary(const Instruction& ins){
+	const uchar type = typeOf(ins.a);
+	if(type == Value::FLOAT || type == Value::INTEGER){
+		if(ins.op == Operator::Minus){
+			const Instruction::Code code = type == Value::FLOAT ? Instruction::Code::FLOAT_UNARY : Instruction::Code::INTEGER_UNARY;
+			emit({ code, ins.op, ins.dst, ins.a, 0, 0 }, type);
+			return;
+		}
+		if(ins.op == Operator::Plus){
+			emit({ Instruction::Code::MOVE, Operator::Assign, ins.dst, ins.a, 0, 0 }, type);
+			return;
+		}
+	}
+	if(type == Value::BOOL && ins.op == Operator::BoolNot){
+		emit({ Instruction::Code::BOOL_UNARY, ins.op, ins.dst, ins.a, 0, 0 }, Value::BOOL);
+		return;
+	}
+
+	uchar resType = DYNAMIC_TYPE;
+	if(type <= Value::STRING){
+		resType = probe([&ins, type](ExpEval& evaluator){
+			return evaluator.applyUnary(ins.op, typeSample(type));
+		});
+	}
+	emit(ins, resType);
+}
+
+void FuncSpecializer::specializeBinary(const Instruction& ins){
+	const uchar typeL = typeOf(ins.a);
+	const uchar typeR = typeOf(ins.b);
+
+	if(isKnownScalar(typeL) && isKnownScalar(typeR)){
+		// Same promotions as the evaluator.
+		const Value::Type maxType = Value::Type(std::max(typeL, typeR));
+		Value::Type workType = Value::STRING;
+		bool comparison = false;
+		switch(ins.op){
+			case Operator::Plus:
+			case Operator::Minus:
+			case Operator::Product:
+				workType = std::max(Value::INTEGER, maxType);
+				break;
+			case Operator::Modulo:
+				// Integer modulo by zero has to go through the evaluator.
+				workType = maxType == Value::FLOAT ? Value::FLOAT : Value::STRING;
+				break;
+			case Operator::Divide:
+			case Operator::Power:
+				workType = Value::FLOAT;
+				break;
+			case Operator::LessThan:
+			case Operator::GreaterThan:
+			case Operator::LessThanEqual:
+			case Operator::GreaterThanEqual:
+				workType = std::max(Value::INTEGER, maxType);
+				comparison = true;
+				break;
+			case Operator::Equal:
+			case Operator::Different:
+				workType = maxType;
+				comparison = true;
+				break;
+			case Operator::BoolOr:
+			case Operator::BoolAnd:
+			case Operator::BoolXor:
+				workType = Value::BOOL;
+				break;
+			default:
+				break;
+		}
+
+		Instruction::Code code = Instruction::Code::BINARY;
+		if(workType == Value::FLOAT){
+			code = Instruction::Code::FLOAT_BINARY;
+		} else if(workType == Value::INTEGER){
+			code = Instruction::Code::INTEGER_BINARY;
+		} else if(workType == Value::BOOL){
+			code = Instruction::Code::BOOL_BINARY;
+		}
+		if(code != Instruction::Code::BINARY){
+			const uint left = convert(ins.a, workType);
+			const uint right = convert(ins.b, workType);
+			emit({ code, ins.op, ins.dst, left, right, 0 }, comparison ? Value::BOOL : workType);
+			return;
+		}
+	}
+
+	uchar resType = DYNAMIC_TYPE;
+	if(typeL <= Value::STRING && typeR <= Value::STRING){
+		resType = probe([&ins, typeL, typeR](ExpEval& evaluator){
+			return evaluator.applyBinary(ins.op, typeSample(typeL), typeSample(typeR));
+		});
+	}
+	emit(ins, resType);
+}
+
+void FuncSpecializer::specializeMember(const Instruction& ins){
+	const uchar type = typeOf(ins.a);
+	uchar resType = DYNAMIC_TYPE;
+	if(type <= Value::STRING){
+		const std::string& member = _program._subscripts[ins.c].member;
+		resType = probe([&member, type](ExpEval& evaluator){
+			return evaluator.applyMember(typeSample(type), member, nullptr);
+		});
+	}
+	emit(ins, resType);
+}
+
+void FuncSpecializer::specializeCall(const Instruction& ins){
+	const Program::Callee& callee = _program._callees[ins.c];
+	std::vector<Value::Type> argTypes(ins.b);
+	bool known = true;
+	for(uint aid = 0; aid < ins.b; ++aid){
+		const uchar type = typeOf(_program._operands[ins.a + aid]);
+		known = known && type <= Value::STRING;
+		argTypes[aid] = known ? Value::Type(type) : Value::STRING;
+	}
+
+	if(known && callee.function && callee.function->program){
+		// Call the specialization of the user function directly.
+		const Program& calleeProgram = *callee.function->program;
+		const Specialization* calleeSpecialization = calleeProgram.specialization(argTypes.data(), _evaluator);
+		if(calleeSpecialization){
+			const uint callId = uint(_specialization->calls.size());
+			_specialization->calls.push_back({ callee.function, &calleeProgram, calleeSpecialization });
+			const uchar resType = calleeSpecialization->resultKnown ? uchar(calleeSpecialization->result) : DYNAMIC_TYPE;
+			emit({ Instruction::Code::CALL_SPECIALIZED, ins.op, ins.dst, ins.a, ins.b, callId }, resType);
+			return;
+		}
+	}
+
+	if(known && callee.builtin){
+		const uchar resType = probe([&callee, &argTypes](ExpEval& evaluator){
+			std::vector<Value> args;
+			for(const Value::Type type : argTypes){
+				args.push_back(typeSample(type));
+			}
+			return evaluator.stdlib().eval(*callee.builtin, args, evaluator);
+		});
+		emit(ins, resType);
+		// Only the argument types have been checked.
+		if(resType <= Value::STRING){
+			_specialization->instructions.push_back({ Instruction::Code::CHECK_TYPE, ins.op, 0, ins.dst, resType, 0 });
+		}
+		return;
+	}
+	emit(ins, DYNAMIC_TYPE);
+}
+
+void FuncSpecializer::emit(const Instruction& ins, uchar type){
+	_specialization->instructions.push_back(ins);
+	setType(ins.dst, type);
+}
+
+uint FuncSpecializer::convert(uint operand, Value::Type type){
+	if(typeOf(operand) == type){
+		return operand;
+	}
+	// Constants are converted once.
+	if(operand & Instruction::CONSTANT_FLAG){
+		Value converted;
+		_specialization->constants[operand & ~Instruction::CONSTANT_FLAG].convert(type, converted);
+		_specialization->constants.push_back(converted);
+		return uint(_specialization->constants.size() - 1) | Instruction::CONSTANT_FLAG;
+	}
+	const uint reg = _specialization->registerCount++;
+	_types.push_back(UNSET_TYPE);
+	emit({ Instruction::Code::CONVERT, Operator::Assign, reg, operand, uint(type), 0 }, type);
+	return reg;
+}
+
+uchar FuncSpecializer::probe(const std::function<Value(ExpEval&)>& operation){
+	// Apply the operation to values of the expected types, without affecting the calling evaluator.
+	ExpEval evaluator(_evaluator.scope(), _evaluator.stdlib(), Format::INTERNAL);
+	const Value result = operation(evaluator);
+	return evaluator.hasFailed() ? DYNAMIC_TYPE : uchar(result.type);
+}
+
+uchar FuncSpecializer::typeOf(uint operand) const {
+	if(operand & Instruction::CONSTANT_FLAG){
+		return uchar(_specialization->constants[operand & ~Instruction::CONSTANT_FLAG].type);
+	}
+	const uchar type = _types[operand];
+	return type == UNSET_TYPE ? DYNAMIC_TYPE : type;
+}
+
+void FuncSpecializer::setType(uint reg, uchar type){
+	uchar& current = _types[reg];
+	current = (current == UNSET_TYPE || current == type) ? type : DYNAMIC_TYPE;
+}
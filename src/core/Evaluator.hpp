@@ -2,8 +2,10 @@
 #include "core/Common.hpp"
 #include "core/Types.hpp"
 #include "core/Functions.hpp"
+#include "core/Program.hpp"
 
 #include <stack>
+#include <functional>
 
 class ExpLogger final : public TreeVisitor {
 public:
@@ -44,6 +46,21 @@ public:
 
 	void setBase(Format format);
 	Format getFormat() const { return _format; }
+	// Number of calls to setBase, function calls changing the base can't be cached.
+	uint baseChanges() const { return _baseChanges; }
+
+	// Shared by the tree evaluation and the bytecode virtual machine.
+	Value applyUnary(Operator op, const Value& v);
+	Value applyBinary(Operator op, const Value& l, const Value& r);
+	Value applyMember(const Value& par, const std::string& member, const Expression* exp);
+	Value applySwizzle(const Value& par, const Swizzle& swizzle, const std::string& member, const Expression* exp);
+	Value callFunction(const std::string& name, const std::vector<Value>& args, const Expression* exp);
+	Value callFunction(const Program::Callee& callee, const std::vector<Value>& args);
+	Value evaluateFunction(const FunctionDef& def, const std::vector<Value>& args);
+	const FunctionDef* findFunction(const std::string& name) const;
+
+	const Scope& scope() const { return _globalScope; }
+	FunctionsLibrary& stdlib() { return _stdlib; }
 
 private:
 	bool convertValues(const Value& l, const Value& r, Value::Type type, Value& outl, Value& outr);
@@ -78,7 +95,33 @@ private:
 	FunctionsLibrary& _stdlib;
 
 	std::stack<Scope> _localScopes;
+	VirtualMachine _vm;
 	Format _format;
+	uint _baseChanges = 0;
+};
+
+class ExpDependencies final : public TreeVisitor {
+public:
+
+	explicit ExpDependencies(Scope::Dependencies& dependencies);
+
+	Value process(const Unary& exp) override;
+	Value process(const Binary& exp) override;
+	Value process(const Ternary& exp) override;
+	Value process(const Member& exp) override;
+	Value process(const Literal& exp) override;
+	Value process(const Variable& exp) override;
+	Value process(const VariableDef& exp) override;
+	Value process(const FunctionDef& exp) override;
+	Value process(		FunctionVar& exp) override;
+	Value process(const FunctionCall& exp) override;
+
+	// Collect the names a definition refers to, before any substitution.
+	static void collect(Expression& exp, Scope::Dependencies& dependencies);
+
+private:
+
+	Scope::Dependencies& _dependencies;
 };
 
 class FuncSubstitution final : public TreeVisitor {
@@ -104,3 +147,99 @@ private:
 	const std::string _id;
 
 };
+
+class FuncOptimizer final : public TreeVisitor {
+public:
+	FuncOptimizer(const Scope& scope, FunctionsLibrary& stdlib, Arena& arena);
+
+	Value process(const Unary& exp) override;
+	Value process(const Binary& exp) override;
+	Value process(const Ternary& exp) override;
+	Value process(const Member& exp) override;
+	Value process(const Literal& exp) override;
+	Value process(const Variable& exp) override;
+	Value process(const VariableDef& exp) override;
+	Value process(const FunctionDef& exp) override;
+	Value process(		FunctionVar& exp) override;
+	Value process(const FunctionCall& exp) override;
+
+	// Build a simplified copy of the function expression in the arena, the original tree is left untouched.
+	static Expression::Ptr optimize(const FunctionDef& def, const Scope& scope, FunctionsLibrary& stdlib, Arena& arena);
+
+private:
+
+	// Set of the possible types of an expression, one bit per Value::Type.
+	using TypeSet = uint;
+
+	void setResult(const Expression::Ptr& exp, TypeSet types);
+	void fold(const Expression::Ptr& exp);
+
+	TypeSet unaryTypes(Operator op, TypeSet types);
+	TypeSet binaryTypes(Operator op, TypeSet l, TypeSet r);
+	TypeSet memberTypes(const std::string& member, TypeSet types);
+
+	const Scope& _globalScope;
+	FunctionsLibrary& _stdlib;
+	Arena& _arena;
+	// Simplified version of the last processed expression.
+	Expression::Ptr _result;
+	TypeSet _types = 0;
+};
+
+class FuncCompiler final : public TreeVisitor {
+public:
+	FuncCompiler(const std::vector<std::string>& argNames, const Scope& scope);
+
+	Value process(const Unary& exp) override;
+	Value process(const Binary& exp) override;
+	Value process(const Ternary& exp) override;
+	Value process(const Member& exp) override;
+	Value process(const Literal& exp) override;
+	Value process(const Variable& exp) override;
+	Value process(const VariableDef& exp) override;
+	Value process(const FunctionDef& exp) override;
+	Value process(		FunctionVar& exp) override;
+	Value process(const FunctionCall& exp) override;
+
+	static std::shared_ptr<const Program> compile(const FunctionDef& def, const Expression::Ptr& expr, const Scope& scope, const FunctionsLibrary& stdlib);
+
+private:
+
+	uint emit(Instruction::Code code, Operator op, uint a, uint b, uint c);
+
+	Value compileShortCircuit(const Binary& exp, uint left);
+
+	const std::vector<std::string>& _names;
+	const Scope& _scope;
+	std::shared_ptr<Program> _program;
+	// Operand holding the result of the last processed expression.
+	uint _operand = 0;
+};
+
+class FuncSpecializer {
+public:
+
+	static std::unique_ptr<const Specialization> specialize(const Program& program, const Value::Type* argTypes, ExpEval& evaluator);
+
+private:
+
+	FuncSpecializer(const Program& program, ExpEval& evaluator);
+
+	void specializeUnary(const Instruction& ins);
+	void specializeBinary(const Instruction& ins);
+	void specializeMember(const Instruction& ins);
+	void specializeCall(const Instruction& ins);
+
+	void emit(const Instruction& ins, uchar type);
+	uint convert(uint operand, Value::Type type);
+	uchar probe(const std::function<Value(ExpEval&)>& operation);
+
+	uchar typeOf(uint operand) const;
+	void setType(uint reg, uchar type);
+
+	const Program& _program;
+	ExpEval& _evaluator;
+	std::unique_ptr<Specialization> _specialization;
+	// Inferred type of each register.
+	std::vector<uchar> _types;
+};
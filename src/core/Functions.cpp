@@ -1,11 +1,14 @@
 #include "core/Functions.hpp"
 #include "core/Evaluator.hpp"
+#include "core/Memo.hpp"
 #include "core/Scanner.hpp"
 #include "core/Parser.hpp"
 #include <array>
+#include <algorithm>
 
 void Scope::setVar(const std::string& name, const Value& value){
 	_variables[name] = value;
+	++_version;
 }
 
 bool Scope::hasVar(const std::string& name) const {
@@ -18,6 +21,7 @@ const Value& Scope::getVar(const std::string& name) const {
 
 void Scope::setFunc(const std::string& name, const std::shared_ptr<FunctionDef>& value){
 	_functions[name] = value;
+	++_version;
 }
 
 bool Scope::hasFunc(const std::string& name) const {
@@ -28,6 +32,80 @@ const std::shared_ptr<FunctionDef>& Scope::getFunc(const std::string& name) cons
 	return _functions.at(name);
 }
 
+std::string Scope::key(const Definition& def){
+	// Variables and functions can share a name, but parentheses can't appear in an identifier.
+	return def.function ? def.name + "()" : def.name;
+}
+
+bool Scope::setDependencies(const Definition& def, const Dependencies& dependencies){
+	// The previous dependencies of def don't change its dependents.
+	std::vector<Definition> cycle = dependents(def);
+	cycle.push_back(def);
+	for(const Definition& other : cycle){
+		const auto& names = other.function ? dependencies.functions : dependencies.variables;
+		if(names.count(other.name) != 0){
+			removeDependencies(def);
+			return false;
+		}
+	}
+	_dependencies[key(def)] = dependencies;
+	return true;
+}
+
+void Scope::removeDependencies(const Definition& def){
+	_dependencies.erase(key(def));
+}
+
+const Scope::Dependencies* Scope::getDependencies(const Definition& def) const {
+	const auto it = _dependencies.find(key(def));
+	return it == _dependencies.end() ? nullptr : &it->second;
+}
+
+std::vector<Scope::Definition> Scope::dependents(const Definition& def) const {
+	// Reverse the graph edges.
+	std::unordered_map<std::string, std::vector<Definition>> users;
+	for(const auto& dependencies : _dependencies){
+		const std::string& name = dependencies.first;
+		const bool function = name.back() == ')';
+		const Definition user = { function ? name.substr(0, name.size() - 2) : name, function };
+		for(const std::string& variable : dependencies.second.variables){
+			users[key({ variable, false })].push_back(user);
+		}
+		for(const std::string& func : dependencies.second.functions){
+			users[key({ func, true })].push_back(user);
+		}
+	}
+
+	// Depth-first traversal, a definition is listed after all its users, reversed at the end.
+	struct Visit {
+		Definition def;
+		std::string key;
+		size_t next;
+	};
+	std::vector<Definition> order;
+	std::unordered_set<std::string> visited = { key(def) };
+	std::vector<Visit> stack = { { def, key(def), 0 } };
+	while(!stack.empty()){
+		Visit& current = stack.back();
+		const auto it = users.find(current.key);
+		if(it == users.end() || current.next == it->second.size()){
+			order.push_back(current.def);
+			stack.pop_back();
+			continue;
+		}
+		const Definition user = it->second[current.next];
+		++current.next;
+		std::string userKey = key(user);
+		if(visited.insert(userKey).second){
+			stack.push_back({ user, std::move(userKey), 0 });
+		}
+	}
+	// Skip def itself.
+	order.pop_back();
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
 #define EXIT(msg) evaluator.registerError(msg, nullptr); return false;
 
 bool allArgs(const std::vector<Value>& args, Value::Type type){
@@ -54,9 +132,9 @@ Value FunctionsLibrary::funcClamp(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::clamp(x.f, a.f, b.f);
 		case Value::VEC3:
-			return glm::clamp(x.v3, a.v3, b.v3);
+			return glm::clamp(x.v3(), a.v3(), b.v3());
 		case Value::VEC4:
-			return glm::clamp(x.v4, a.v4, b.v4);
+			return glm::clamp(x.v4(), a.v4(), b.v4());
 		default:
 			break;
 	}
@@ -78,9 +156,9 @@ Value FunctionsLibrary::funcPow(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::pow(x.f, e.f);
 		case Value::VEC3:
-			return glm::pow(x.v3, e.v3);
+			return glm::pow(x.v3(), e.v3());
 		case Value::VEC4:
-			return glm::pow(x.v4, e.v4);
+			return glm::pow(x.v4(), e.v4());
 		default:
 			break;
 	}
@@ -102,9 +180,9 @@ Value FunctionsLibrary::funcMin(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::min(a.f, b.f);
 		case Value::VEC3:
-			return glm::min(a.v3, b.v3);
+			return glm::min(a.v3(), b.v3());
 		case Value::VEC4:
-			return glm::min(a.v4, b.v4);
+			return glm::min(a.v4(), b.v4());
 		default:
 			break;
 	}
@@ -126,9 +204,9 @@ Value FunctionsLibrary::funcMax(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::max(a.f, b.f);
 		case Value::VEC3:
-			return glm::max(a.v3, b.v3);
+			return glm::max(a.v3(), b.v3());
 		case Value::VEC4:
-			return glm::max(a.v4, b.v4);
+			return glm::max(a.v4(), b.v4());
 		default:
 			break;
 	}
@@ -146,9 +224,9 @@ Value FunctionsLibrary::funcSaturate(const std::vector<Value>& args, ExpEval& ev
 		case Value::FLOAT:
 			return glm::clamp(x.f, 0.0, 1.0);
 		case Value::VEC3:
-			return glm::clamp(x.v3, glm::vec3(0.0), glm::vec3(1.0));
+			return glm::clamp(x.v3(), glm::vec3(0.0), glm::vec3(1.0));
 		case Value::VEC4:
-			return glm::clamp(x.v4, glm::vec4(0.0), glm::vec4(1.0));
+			return glm::clamp(x.v4(), glm::vec4(0.0), glm::vec4(1.0));
 		default:
 			break;
 	}
@@ -201,9 +279,9 @@ Value FunctionsLibrary::funcCos(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::cos(args[0].f);
 		case Value::VEC3:
-			return glm::cos(args[0].v3);
+			return glm::cos(args[0].v3());
 		case Value::VEC4:
-			return glm::cos(args[0].v4);
+			return glm::cos(args[0].v4());
 		default:
 			break;
 	}
@@ -220,9 +298,9 @@ Value FunctionsLibrary::funcSin(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::sin(args[0].f);
 		case Value::VEC3:
-			return glm::sin(args[0].v3);
+			return glm::sin(args[0].v3());
 		case Value::VEC4:
-			return glm::sin(args[0].v4);
+			return glm::sin(args[0].v4());
 		default:
 			break;
 	}
@@ -239,9 +317,9 @@ Value FunctionsLibrary::funcTan(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::tan(args[0].f);
 		case Value::VEC3:
-			return glm::tan(args[0].v3);
+			return glm::tan(args[0].v3());
 		case Value::VEC4:
-			return glm::tan(args[0].v4);
+			return glm::tan(args[0].v4());
 		default:
 			break;
 	}
@@ -258,9 +336,9 @@ Value FunctionsLibrary::funcAcos(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::acos(args[0].f);
 		case Value::VEC3:
-			return glm::acos(args[0].v3);
+			return glm::acos(args[0].v3());
 		case Value::VEC4:
-			return glm::acos(args[0].v4);
+			return glm::acos(args[0].v4());
 		default:
 			break;
 	}
@@ -277,9 +355,9 @@ Value FunctionsLibrary::funcAsin(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::asin(args[0].f);
 		case Value::VEC3:
-			return glm::asin(args[0].v3);
+			return glm::asin(args[0].v3());
 		case Value::VEC4:
-			return glm::asin(args[0].v4);
+			return glm::asin(args[0].v4());
 		default:
 			break;
 	}
@@ -297,9 +375,9 @@ Value FunctionsLibrary::funcAtan(const std::vector<Value>& args, ExpEval& evalua
 			case Value::FLOAT:
 				return glm::atan(args[0].f);
 			case Value::VEC3:
-				return glm::atan(args[0].v3);
+				return glm::atan(args[0].v3());
 			case Value::VEC4:
-				return glm::atan(args[0].v4);
+				return glm::atan(args[0].v4());
 			default:
 				break;
 		}
@@ -311,9 +389,9 @@ Value FunctionsLibrary::funcAtan(const std::vector<Value>& args, ExpEval& evalua
 			case Value::FLOAT:
 				return glm::atan(args[0].f, args[1].f);
 			case Value::VEC3:
-				return glm::atan(args[0].v3, args[1].v3);
+				return glm::atan(args[0].v3(), args[1].v3());
 			case Value::VEC4:
-				return glm::atan(args[0].v4, args[1].v4);
+				return glm::atan(args[0].v4(), args[1].v4());
 			default:
 				break;
 		}
@@ -332,9 +410,9 @@ Value FunctionsLibrary::funcExp(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::exp(args[0].f);
 		case Value::VEC3:
-			return glm::exp(args[0].v3);
+			return glm::exp(args[0].v3());
 		case Value::VEC4:
-			return glm::exp(args[0].v4);
+			return glm::exp(args[0].v4());
 		default:
 			break;
 	}
@@ -351,9 +429,9 @@ Value FunctionsLibrary::funcLog(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::log(args[0].f);
 		case Value::VEC3:
-			return glm::log(args[0].v3);
+			return glm::log(args[0].v3());
 		case Value::VEC4:
-			return glm::log(args[0].v4);
+			return glm::log(args[0].v4());
 		default:
 			break;
 	}
@@ -370,9 +448,9 @@ Value FunctionsLibrary::funcExp2(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::exp2(args[0].f);
 		case Value::VEC3:
-			return glm::exp2(args[0].v3);
+			return glm::exp2(args[0].v3());
 		case Value::VEC4:
-			return glm::exp2(args[0].v4);
+			return glm::exp2(args[0].v4());
 		default:
 			break;
 	}
@@ -385,9 +463,9 @@ Value FunctionsLibrary::funcLog2(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::log2(args[0].f);
 		case Value::VEC3:
-			return glm::log2(args[0].v3);
+			return glm::log2(args[0].v3());
 		case Value::VEC4:
-			return glm::log2(args[0].v4);
+			return glm::log2(args[0].v4());
 		default:
 			break;
 	}
@@ -404,9 +482,9 @@ Value FunctionsLibrary::funcSqrt(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::sqrt(args[0].f);
 		case Value::VEC3:
-			return glm::sqrt(args[0].v3);
+			return glm::sqrt(args[0].v3());
 		case Value::VEC4:
-			return glm::sqrt(args[0].v4);
+			return glm::sqrt(args[0].v4());
 		default:
 			break;
 	}
@@ -431,9 +509,9 @@ Value FunctionsLibrary::funcFloor(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::floor(args[0].f);
 		case Value::VEC3:
-			return glm::floor(args[0].v3);
+			return glm::floor(args[0].v3());
 		case Value::VEC4:
-			return glm::floor(args[0].v4);
+			return glm::floor(args[0].v4());
 		default:
 			break;
 	}
@@ -450,9 +528,9 @@ Value FunctionsLibrary::funcCeil(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::ceil(args[0].f);
 		case Value::VEC3:
-			return glm::ceil(args[0].v3);
+			return glm::ceil(args[0].v3());
 		case Value::VEC4:
-			return glm::ceil(args[0].v4);
+			return glm::ceil(args[0].v4());
 		default:
 			break;
 	}
@@ -465,9 +543,9 @@ Value FunctionsLibrary::funcFract(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::fract(args[0].f);
 		case Value::VEC3:
-			return glm::fract(args[0].v3);
+			return glm::fract(args[0].v3());
 		case Value::VEC4:
-			return glm::fract(args[0].v4);
+			return glm::fract(args[0].v4());
 		default:
 			break;
 	}
@@ -486,9 +564,9 @@ Value FunctionsLibrary::funcMix(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::mix(x.f, y.f, t.f);
 		case Value::VEC3:
-			return glm::mix(x.v3, y.v3, t.v3);
+			return glm::mix(x.v3(), y.v3(), t.v3());
 		case Value::VEC4:
-			return glm::mix(x.v4, y.v4, t.v4);
+			return glm::mix(x.v4(), y.v4(), t.v4());
 		default:
 			break;
 	}
@@ -505,9 +583,9 @@ Value FunctionsLibrary::funcAbs(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::abs(args[0].f);
 		case Value::VEC3:
-			return glm::abs(args[0].v3);
+			return glm::abs(args[0].v3());
 		case Value::VEC4:
-			return glm::abs(args[0].v4);
+			return glm::abs(args[0].v4());
 		default:
 			break;
 	}
@@ -522,9 +600,9 @@ Value FunctionsLibrary::funcInversesqrt(const std::vector<Value>& args, ExpEval&
 		case Value::FLOAT:
 			return glm::inversesqrt(args[0].f);
 		case Value::VEC3:
-			return glm::inversesqrt(args[0].v3);
+			return glm::inversesqrt(args[0].v3());
 		case Value::VEC4:
-			return glm::inversesqrt(args[0].v4);
+			return glm::inversesqrt(args[0].v4());
 		default:
 			break;
 	}
@@ -539,13 +617,13 @@ Value FunctionsLibrary::funcRcp(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return 1.0f/args[0].f;
 		case Value::VEC3:
-			return 1.0f/args[0].v3;
+			return 1.0f/args[0].v3();
 		case Value::VEC4:
-			return 1.0f/args[0].v4;
+			return 1.0f/args[0].v4();
 		case Value::MAT3:
-			return 1.0f/args[0].m3;
+			return 1.0f/args[0].m3();
 		case Value::MAT4:
-			return 1.0f/args[0].m4;
+			return 1.0f/args[0].m4();
 		default:
 			break;
 	}
@@ -559,9 +637,9 @@ Value FunctionsLibrary::funcSign(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::sign(args[0].f);
 		case Value::VEC3:
-			return glm::sign(args[0].v3);
+			return glm::sign(args[0].v3());
 		case Value::VEC4:
-			return glm::sign(args[0].v4);
+			return glm::sign(args[0].v4());
 		default:
 			break;
 	}
@@ -579,9 +657,9 @@ Value FunctionsLibrary::funcMod(const std::vector<Value>& args, ExpEval& evaluat
 		case Value::FLOAT:
 			return glm::mod(x.f, e.f);
 		case Value::VEC3:
-			return glm::mod(x.v3, e.v3);
+			return glm::mod(x.v3(), e.v3());
 		case Value::VEC4:
-			return glm::mod(x.v4, e.v4);
+			return glm::mod(x.v4(), e.v4());
 		default:
 			break;
 	}
@@ -599,9 +677,9 @@ Value FunctionsLibrary::funcStep(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::step(e.f, x.f);
 		case Value::VEC3:
-			return glm::step(e.v3, x.v3);
+			return glm::step(e.v3(), x.v3());
 		case Value::VEC4:
-			return glm::step(e.v4, x.v4);
+			return glm::step(e.v4(), x.v4());
 		default:
 			break;
 	}
@@ -620,9 +698,9 @@ Value FunctionsLibrary::funcSmoothstep(const std::vector<Value>& args, ExpEval&
 		case Value::FLOAT:
 			return glm::smoothstep(e0.f, e1.f, x.f);
 		case Value::VEC3:
-			return glm::smoothstep(e0.v3, e1.v3, x.v3);
+			return glm::smoothstep(e0.v3(), e1.v3(), x.v3());
 		case Value::VEC4:
-			return glm::smoothstep(e0.v4, e1.v4, x.v4);
+			return glm::smoothstep(e0.v4(), e1.v4(), x.v4());
 		default:
 			break;
 	}
@@ -632,10 +710,10 @@ Value FunctionsLibrary::funcSmoothstep(const std::vector<Value>& args, ExpEval&
 Value FunctionsLibrary::funcLength(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 1);
 	if(args[0].type == Value::VEC3){
-		return glm::length(args[0].v3);
+		return glm::length(args[0].v3());
 	}
 	if(args[0].type == Value::VEC4){
-		return glm::length(args[0].v4);
+		return glm::length(args[0].v4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -643,10 +721,10 @@ Value FunctionsLibrary::funcLength(const std::vector<Value>& args, ExpEval& eval
 Value FunctionsLibrary::funcDistance(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(allArgs(args, Value::VEC3)){
-		return glm::distance(args[0].v3, args[1].v3);
+		return glm::distance(args[0].v3(), args[1].v3());
 	}
 	if(allArgs(args, Value::VEC4)){
-		return glm::distance(args[0].v4, args[1].v4);
+		return glm::distance(args[0].v4(), args[1].v4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -654,10 +732,10 @@ Value FunctionsLibrary::funcDistance(const std::vector<Value>& args, ExpEval& ev
 Value FunctionsLibrary::funcDot(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(allArgs(args, Value::VEC3)){
-		return glm::dot(args[0].v3, args[1].v3);
+		return glm::dot(args[0].v3(), args[1].v3());
 	}
 	if(allArgs(args, Value::VEC4)){
-		return glm::dot(args[0].v4, args[1].v4);
+		return glm::dot(args[0].v4(), args[1].v4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -665,7 +743,7 @@ Value FunctionsLibrary::funcDot(const std::vector<Value>& args, ExpEval& evaluat
 Value FunctionsLibrary::funcCross(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(allArgs(args, Value::VEC3)){
-		return glm::cross(args[0].v3, args[1].v3);
+		return glm::cross(args[0].v3(), args[1].v3());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -673,10 +751,10 @@ Value FunctionsLibrary::funcCross(const std::vector<Value>& args, ExpEval& evalu
 Value FunctionsLibrary::funcNormalize(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 1);
 	if(args[0].type == Value::VEC3){
-		return glm::normalize(args[0].v3);
+		return glm::normalize(args[0].v3());
 	}
 	if(args[0].type == Value::VEC4){
-		return glm::normalize(args[0].v4);
+		return glm::normalize(args[0].v4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -684,10 +762,10 @@ Value FunctionsLibrary::funcNormalize(const std::vector<Value>& args, ExpEval& e
 Value FunctionsLibrary::funcReflect(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(allArgs(args, Value::VEC3)){
-		return glm::reflect(args[0].v3, args[1].v3);
+		return glm::reflect(args[0].v3(), args[1].v3());
 	}
 	if(allArgs(args, Value::VEC4)){
-		return glm::reflect(args[0].v4, args[1].v4);
+		return glm::reflect(args[0].v4(), args[1].v4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -695,10 +773,10 @@ Value FunctionsLibrary::funcReflect(const std::vector<Value>& args, ExpEval& eva
 Value FunctionsLibrary::funcRefract(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 3);
 	if(args[0].type == Value::VEC3 && args[1].type == Value::VEC3 && args[2].type == Value::FLOAT){
-		return glm::refract(args[0].v3, args[1].v3, float(args[2].f));
+		return glm::refract(args[0].v3(), args[1].v3(), float(args[2].f));
 	}
 	if(args[0].type == Value::VEC4 && args[1].type == Value::VEC4 && args[2].type == Value::FLOAT){
-		return glm::refract(args[0].v4, args[1].v4, float(args[2].f));
+		return glm::refract(args[0].v4(), args[1].v4(), float(args[2].f));
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -707,9 +785,9 @@ Value FunctionsLibrary::funcInverse(const std::vector<Value>& args, ExpEval& eva
 	assert(args.size() == 1);
 	switch(args[0].type){
 		case Value::MAT3:
-			return glm::inverse(args[0].m3);
+			return glm::inverse(args[0].m3());
 		case Value::MAT4:
-			return glm::inverse(args[0].m4);
+			return glm::inverse(args[0].m4());
 		default:
 			break;
 	}
@@ -720,9 +798,9 @@ Value FunctionsLibrary::funcTranspose(const std::vector<Value>& args, ExpEval& e
 	assert(args.size() == 1);
 	switch(args[0].type){
 		case Value::MAT3:
-			return glm::transpose(args[0].m3);
+			return glm::transpose(args[0].m3());
 		case Value::MAT4:
-			return glm::transpose(args[0].m4);
+			return glm::transpose(args[0].m4());
 		default:
 			break;
 	}
@@ -732,10 +810,10 @@ Value FunctionsLibrary::funcTranspose(const std::vector<Value>& args, ExpEval& e
 Value FunctionsLibrary::funcMatrixCompMult(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(allArgs(args, Value::MAT4)){
-		return glm::matrixCompMult(args[0].m4, args[1].m4);
+		return glm::matrixCompMult(args[0].m4(), args[1].m4());
 	}
 	if(allArgs(args, Value::MAT3)){
-		return glm::matrixCompMult(args[0].m3, args[1].m3);
+		return glm::matrixCompMult(args[0].m3(), args[1].m3());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -746,9 +824,9 @@ Value FunctionsLibrary::funcRadians(const std::vector<Value>& args, ExpEval& eva
 		case Value::FLOAT:
 			return glm::radians(args[0].f);
 		case Value::VEC3:
-			return glm::radians(args[0].v3);
+			return glm::radians(args[0].v3());
 		case Value::VEC4:
-			return glm::radians(args[0].v4);
+			return glm::radians(args[0].v4());
 		default:
 			break;
 	}
@@ -761,9 +839,9 @@ Value FunctionsLibrary::funcDegrees(const std::vector<Value>& args, ExpEval& eva
 		case Value::FLOAT:
 			return glm::degrees(args[0].f);
 		case Value::VEC3:
-			return glm::degrees(args[0].v3);
+			return glm::degrees(args[0].v3());
 		case Value::VEC4:
-			return glm::degrees(args[0].v4);
+			return glm::degrees(args[0].v4());
 		default:
 			break;
 	}
@@ -780,9 +858,9 @@ Value FunctionsLibrary::funcSinh(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::sinh(args[0].f);
 		case Value::VEC3:
-			return glm::sinh(args[0].v3);
+			return glm::sinh(args[0].v3());
 		case Value::VEC4:
-			return glm::sinh(args[0].v4);
+			return glm::sinh(args[0].v4());
 		default:
 			break;
 	}
@@ -799,9 +877,9 @@ Value FunctionsLibrary::funcCosh(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::cosh(args[0].f);
 		case Value::VEC3:
-			return glm::cosh(args[0].v3);
+			return glm::cosh(args[0].v3());
 		case Value::VEC4:
-			return glm::cosh(args[0].v4);
+			return glm::cosh(args[0].v4());
 		default:
 			break;
 	}
@@ -818,9 +896,9 @@ Value FunctionsLibrary::funcTanh(const std::vector<Value>& args, ExpEval& evalua
 		case Value::FLOAT:
 			return glm::tanh(args[0].f);
 		case Value::VEC3:
-			return glm::tanh(args[0].v3);
+			return glm::tanh(args[0].v3());
 		case Value::VEC4:
-			return glm::tanh(args[0].v4);
+			return glm::tanh(args[0].v4());
 		default:
 			break;
 	}
@@ -837,9 +915,9 @@ Value FunctionsLibrary::funcAsinh(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::asinh(args[0].f);
 		case Value::VEC3:
-			return glm::asinh(args[0].v3);
+			return glm::asinh(args[0].v3());
 		case Value::VEC4:
-			return glm::asinh(args[0].v4);
+			return glm::asinh(args[0].v4());
 		default:
 			break;
 	}
@@ -856,9 +934,9 @@ Value FunctionsLibrary::funcAcosh(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::acosh(args[0].f);
 		case Value::VEC3:
-			return glm::acosh(args[0].v3);
+			return glm::acosh(args[0].v3());
 		case Value::VEC4:
-			return glm::acosh(args[0].v4);
+			return glm::acosh(args[0].v4());
 		default:
 			break;
 	}
@@ -876,9 +954,9 @@ Value FunctionsLibrary::funcAtanh(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::atanh(args[0].f);
 		case Value::VEC3:
-			return glm::atanh(args[0].v3);
+			return glm::atanh(args[0].v3());
 		case Value::VEC4:
-			return glm::atanh(args[0].v4);
+			return glm::atanh(args[0].v4());
 		default:
 			break;
 	}
@@ -895,9 +973,9 @@ Value FunctionsLibrary::funcRound(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::round(args[0].f);
 		case Value::VEC3:
-			return glm::round(args[0].v3);
+			return glm::round(args[0].v3());
 		case Value::VEC4:
-			return glm::round(args[0].v4);
+			return glm::round(args[0].v4());
 		default:
 			break;
 	}
@@ -914,9 +992,9 @@ Value FunctionsLibrary::funcTrunc(const std::vector<Value>& args, ExpEval& evalu
 		case Value::FLOAT:
 			return glm::trunc(args[0].f);
 		case Value::VEC3:
-			return glm::trunc(args[0].v3);
+			return glm::trunc(args[0].v3());
 		case Value::VEC4:
-			return glm::trunc(args[0].v4);
+			return glm::trunc(args[0].v4());
 		default:
 			break;
 	}
@@ -926,10 +1004,10 @@ Value FunctionsLibrary::funcTrunc(const std::vector<Value>& args, ExpEval& evalu
 Value FunctionsLibrary::funcOuterProduct(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(allArgs(args, Value::VEC3)){
-		return glm::outerProduct(args[0].v3, args[1].v3);
+		return glm::outerProduct(args[0].v3(), args[1].v3());
 	}
 	if(allArgs(args, Value::VEC4)){
-		return glm::outerProduct(args[0].v4, args[1].v4);
+		return glm::outerProduct(args[0].v4(), args[1].v4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -937,10 +1015,10 @@ Value FunctionsLibrary::funcOuterProduct(const std::vector<Value>& args, ExpEval
 Value FunctionsLibrary::funcDeterminant(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 1);
 	if(args[0].type == Value::MAT3){
-		return glm::determinant(args[0].m3);
+		return glm::determinant(args[0].m3());
 	}
 	if(args[0].type == Value::MAT4){
-		return glm::determinant(args[0].m4);
+		return glm::determinant(args[0].m4());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -948,7 +1026,7 @@ Value FunctionsLibrary::funcDeterminant(const std::vector<Value>& args, ExpEval&
 Value FunctionsLibrary::funcLookAt(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 3);
 	if(allArgs(args, Value::VEC3)){
-		return glm::lookAt(args[0].v3, args[1].v3, args[2].v3);
+		return glm::lookAt(args[0].v3(), args[1].v3(), args[2].v3());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -972,7 +1050,7 @@ Value FunctionsLibrary::funcOrthographic(const std::vector<Value>& args, ExpEval
 Value FunctionsLibrary::funcAxisRotationMat(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 2);
 	if(args[0].type == Value::FLOAT && args[1].type == Value::VEC3){
-		return glm::rotate(glm::mat4(1.0f), float(args[0].f), args[1].v3);
+		return glm::rotate(glm::mat4(1.0f), float(args[0].f), args[1].v3());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -980,7 +1058,7 @@ Value FunctionsLibrary::funcAxisRotationMat(const std::vector<Value>& args, ExpE
 Value FunctionsLibrary::funcTranslationMat(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 1);
 	if(args[0].type == Value::VEC3){
-		return glm::translate(glm::mat4(1.0f), args[0].v3);
+		return glm::translate(glm::mat4(1.0f), args[0].v3());
 	}
 	EXIT("Unsupported type " + TypeString(args[0].type) + " for function " + name + ".");
 }
@@ -988,7 +1066,7 @@ Value FunctionsLibrary::funcTranslationMat(const std::vector<Value>& args, ExpEv
 Value FunctionsLibrary::funcScalingMat(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name){
 	assert(args.size() == 1);
 	if(args[0].type == Value::VEC3){
-		return glm::scale(glm::mat4(1.0f), args[0].v3);
+		return glm::scale(glm::mat4(1.0f), args[0].v3());
 	} else if(args[0].type == Value::FLOAT){
 		return glm::scale(glm::mat4(1.0f), glm::vec3(float(args[0].f)));
 	}
@@ -1003,9 +1081,9 @@ Value FunctionsLibrary::constructorVec3(const std::vector<Value>& args, ExpEval&
 			case Value::FLOAT:
 				return glm::vec3(float(args[0].f));
 			case Value::VEC3:
-				return args[0].v3;
+				return args[0].v3();
 			case Value::VEC4:
-				return glm::vec3(args[0].v4);
+				return glm::vec3(args[0].v4());
 			default:
 				break;
 		}
@@ -1029,16 +1107,16 @@ Value FunctionsLibrary::constructorVec4(const std::vector<Value>& args, ExpEval&
 			case Value::FLOAT:
 				return glm::vec4(float(args[0].f));
 			case Value::VEC4:
-				return args[0].v4;
+				return args[0].v4();
 			default:
 				break;
 		}
 	} else if(args.size() == 2){
 		if(args[0].type == Value::FLOAT && args[1].type == Value::VEC3){
-			return glm::vec4(args[0].f, args[1].v3);
+			return glm::vec4(args[0].f, args[1].v3());
 		}
 		if(args[0].type == Value::VEC3 && args[1].type == Value::FLOAT){
-			return glm::vec4(args[0].v3, args[1].f);
+			return glm::vec4(args[0].v3(), args[1].f);
 		}
 	} else if(args.size() == 4){
 		std::array<Value, 4> cargs;
@@ -1060,9 +1138,9 @@ Value FunctionsLibrary::constructorMat3(const std::vector<Value>& args, ExpEval&
 			case Value::FLOAT:
 				return glm::mat3(float(args[0].f));
 			case Value::MAT3:
-				return args[0].m3;
+				return args[0].m3();
 			case Value::MAT4:
-				return glm::mat3(args[0].m4);
+				return glm::mat3(args[0].m4());
 			default:
 				break;
 		}
@@ -1074,7 +1152,7 @@ Value FunctionsLibrary::constructorMat3(const std::vector<Value>& args, ExpEval&
 				EXIT("Unable to convert argument to type vec3.");
 			}
 		}
-		return glm::mat3(cargs[0].v3, cargs[1].v3, cargs[2].v3);
+		return glm::mat3(cargs[0].v3(), cargs[1].v3(), cargs[2].v3());
 
 	} else if(args.size() == 9){
 		std::array<Value, 9> cargs;
@@ -1099,9 +1177,9 @@ Value FunctionsLibrary::constructorMat4(const std::vector<Value>& args, ExpEval&
 			case Value::FLOAT:
 				return glm::mat4(float(args[0].f));
 			case Value::MAT3:
-				return glm::mat4(args[0].m3);
+				return glm::mat4(args[0].m3());
 			case Value::MAT4:
-				return args[0].m4;
+				return args[0].m4();
 			default:
 				break;
 		}
@@ -1113,7 +1191,7 @@ Value FunctionsLibrary::constructorMat4(const std::vector<Value>& args, ExpEval&
 				EXIT("Unable to convert argument to type vec4.");
 			}
 		}
-		return glm::mat4(cargs[0].v4, cargs[1].v4, cargs[2].v4, cargs[3].v4);
+		return glm::mat4(cargs[0].v4(), cargs[1].v4(), cargs[2].v4(), cargs[3].v4());
 
 	} else if(args.size() == 16){
 		std::array<Value, 16> cargs;
@@ -1209,6 +1287,10 @@ FunctionsLibrary::FunctionsLibrary(){
 		{ "mat4", { &FunctionsLibrary::constructorMat4, {1, 4, 16}, "(m), (cols...), (coeffs...)" } },
 		{ "float4x4", { &FunctionsLibrary::constructorMat4, {1, 4, 16} , "(m), (cols...), (coeffs...)"} },
 	};
+	// Functions need their name for error messages.
+	for(auto& func : _funcMap){
+		func.second.name = func.first;
+	}
 }
 
 bool FunctionsLibrary::hasFunc(const std::string& name) const {
@@ -1216,12 +1298,25 @@ bool FunctionsLibrary::hasFunc(const std::string& name) const {
 }
 
 bool FunctionsLibrary::validArgCount(const std::string& name, size_t argCount) const {
-	const std::vector<size_t>& counts = _funcMap.at(name).allowedCounts;
-	return std::find(counts.begin(), counts.end(), argCount) != counts.end();
+	return validArgCount(_funcMap.at(name), argCount);
 }
 
 Value FunctionsLibrary::eval(const std::string& name, const std::vector<Value>& args, ExpEval& evaluator) {
-	return (this->*(_funcMap.at(name).call))(args, evaluator, name);
+	return eval(_funcMap.at(name), args, evaluator);
+}
+
+const FunctionsLibrary::FunctionInfos* FunctionsLibrary::find(const std::string& name) const {
+	const auto func = _funcMap.find(name);
+	return func != _funcMap.end() ? &(func->second) : nullptr;
+}
+
+bool FunctionsLibrary::validArgCount(const FunctionInfos& func, size_t argCount) const {
+	const std::vector<size_t>& counts = func.allowedCounts;
+	return std::find(counts.begin(), counts.end(), argCount) != counts.end();
+}
+
+Value FunctionsLibrary::eval(const FunctionInfos& func, const std::vector<Value>& args, ExpEval& evaluator) {
+	return (this->*(func.call))(args, evaluator, func.name);
 }
 
 void FunctionsLibrary::populateDescriptions(std::unordered_map<std::string, std::string>& list) const {
@@ -2,6 +2,7 @@
 #include "core/Common.hpp"
 #include "core/Types.hpp"
 #include <unordered_map>
+#include <unordered_set>
 
 class ExpEval;
 
@@ -11,6 +12,22 @@ public:
 	using VariableList = std::unordered_map<std::string, Value>;
 	using FunctionList = std::unordered_map<std::string, std::shared_ptr<FunctionDef>>;
 
+	// A variable or a function of the scope.
+	struct Definition {
+		std::string name;
+		bool function;
+	};
+
+	// Source of a definition and the names it refers to, to recompute it when one of them changes.
+	struct Dependencies {
+		std::string source;
+		std::unordered_set<std::string> variables;
+		std::unordered_set<std::string> functions;
+	};
+
+	// Indexed by definition key.
+	using DependencyList = std::unordered_map<std::string, Dependencies>;
+
 	void setVar(const std::string& name, const Value& value);
 
 	bool hasVar(const std::string& name) const;
@@ -27,16 +44,43 @@ public:
 
 	const FunctionList& getFuncs() const { return _functions; }
 
+	// Incremented each time a variable or a function is set.
+	uint64_t version() const { return _version; }
+
+	// Returns false if the definition would depend on itself, in which case it is not recorded.
+	bool setDependencies(const Definition& def, const Dependencies& dependencies);
+
+	void removeDependencies(const Definition& def);
+
+	// Returns nullptr if the definition is not recorded.
+	const Dependencies* getDependencies(const Definition& def) const;
+
+	const DependencyList& getDependencies() const { return _dependencies; }
+
+	// All definitions depending on def directly or not, each one listed after its own dependencies.
+	std::vector<Definition> dependents(const Definition& def) const;
+
 private:
 
+	static std::string key(const Definition& def);
+
 	VariableList _variables;
 	FunctionList _functions;
+	DependencyList _dependencies;
+	uint64_t _version = 0;
 
 };
 
 class FunctionsLibrary {
 public:
 
+	struct FunctionInfos {
+		Value (FunctionsLibrary::*call)(const std::vector<Value>&, ExpEval& evaluator, const std::string&);
+		std::vector<size_t> allowedCounts;
+		std::string description;
+		std::string name = "";
+	};
+
 	FunctionsLibrary();
 
 	bool hasFunc(const std::string& name) const ;
@@ -44,6 +88,11 @@ public:
 
 	Value eval(const std::string& name, const std::vector<Value>& args, ExpEval& evaluator);
 
+	// Resolve a function once, to call it repeatedly without name lookups. Returns nullptr if not found.
+	const FunctionInfos* find(const std::string& name) const;
+	bool validArgCount(const FunctionInfos& func, size_t argCount) const;
+	Value eval(const FunctionInfos& func, const std::vector<Value>& args, ExpEval& evaluator);
+
 	void populateDescriptions(std::unordered_map<std::string, std::string>& list) const;
 
 private:
@@ -115,11 +164,5 @@ private:
 	Value constructorMat3(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name);
 	Value constructorMat4(const std::vector<Value>& args, ExpEval& evaluator, const std::string& name);
 
-	struct FunctionInfos {
-		Value (FunctionsLibrary::*call)(const std::vector<Value>&, ExpEval& evaluator, const std::string&);
-		std::vector<size_t> allowedCounts;
-		std::string description;
-	};
-
 	std::unordered_map<std::string, FunctionInfos> _funcMap;
 };
@@ -0,0 +1,32 @@
+#include "core/InputCache.hpp"
+
+InputCache::InputCache(size_t capacity) : _capacity(capacity) {
+	assert(_capacity != 0);
+}
+
+InputCache::Entry& InputCache::get(const std::string& input){
+	const auto it = _index.find(input);
+	if(it != _index.end()){
+		_entries.splice(_entries.begin(), _entries, it->second);
+		return it->second->second;
+	}
+	if(_entries.size() >= _capacity){
+		_index.erase(_entries.back().first);
+		_entries.pop_back();
+	}
+	_entries.emplace_front(input, Entry());
+	_index[input] = _entries.begin();
+	return _entries.front().second;
+}
+
+InputCache::Entry* InputCache::previous(){
+	if(_entries.size() < 2){
+		return nullptr;
+	}
+	return &std::next(_entries.begin())->second;
+}
+
+void InputCache::clear(){
+	_index.clear();
+	_entries.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Types.hpp"
+#include "core/Scanner.hpp"
+
+#include <list>
+#include <unordered_map>
+
+/** Scanned and parsed inputs, with the result of their last temporary evaluation. This avoids running the whole
+ pipeline again when the same text is evaluated repeatedly while being edited, then committed. The least recently
+ used input is evicted when full. */
+class InputCache {
+public:
+
+	struct Entry {
+		// Null until the input is scanned.
+		std::unique_ptr<Scanner> scanner;
+		Status scanResult;
+		Status parseResult;
+		// Substitutions modify the tree of a function definition, which is then owned by the scope:
+		// it is dropped after evaluation and parsed again from the tokens.
+		std::shared_ptr<Expression> tree;
+		bool parsed = false;
+
+		// Last temporary evaluation, valid for a given scope version and input format.
+		Value output;
+		uint64_t version = 0;
+		Format inputFormat = Format::INTERNAL;
+		Format outputFormat = Format::INTERNAL;
+		bool success = false;
+		bool evaluated = false;
+	};
+
+	explicit InputCache(size_t capacity);
+
+	// Returns the entry for this input, empty if it is new. The reference is valid until the next call.
+	Entry& get(const std::string& input);
+
+	// Entry used before the last one returned by get, or nullptr. Usually the same line before the last edit.
+	Entry* previous();
+
+	void clear();
+
+private:
+
+	using Entries = std::list<std::pair<std::string, Entry>>;
+
+	// Most recently used first.
+	Entries _entries;
+	std::unordered_map<std::string, Entries::iterator> _index;
+	const size_t _capacity;
+};
@@ -0,0 +1,872 @@
+#include "core/Interval.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define EXIT(exp, msg) registerError(msg, exp); return false;
+
+namespace {
+
+	constexpr double INF = std::numeric_limits<double>::infinity();
+
+	double scalarValue(const Value& value){
+		switch(value.type){
+			case Value::BOOL:
+				return value.b ? 1.0 : 0.0;
+			case Value::INTEGER:
+				return double(value.i);
+			default:
+				break;
+		}
+		return value.f;
+	}
+
+	// Bounds only reached by NaN.
+	Interval nanOnly(Value::Type type){
+		return Interval(INF, -INF, type, true);
+	}
+
+	// Ranges reduced to a single value are constant. A float zero is kept as a range, as its sign is unknown.
+	Interval bounds(double min, double max, Value::Type type, bool nan){
+		// Undefined bounds (infinity minus infinity,...) are only reached by NaN.
+		if(std::isnan(min)){
+			min = -INF;
+			nan = true;
+		}
+		if(std::isnan(max)){
+			max = INF;
+			nan = true;
+		}
+		if(!nan && min == max && (min != 0.0 || type != Value::FLOAT)){
+			switch(type){
+				case Value::BOOL:
+					return Interval(Value(min != 0.0));
+				case Value::INTEGER:
+					if(std::abs(min) < 9007199254740992.0){
+						return Interval(Value((long long)min));
+					}
+					break;
+				case Value::FLOAT:
+					return Interval(Value(min));
+				default:
+					break;
+			}
+		}
+		return Interval(min, max, type, nan);
+	}
+
+	Interval truthBounds(Interval::Truth truth){
+		if(truth == Interval::Truth::UNKNOWN){
+			return Interval(0.0, 1.0, Value::BOOL);
+		}
+		return Interval(Value(truth == Interval::Truth::TRUE));
+	}
+
+	Interval::Truth truthFrom(bool canBeTrue, bool canBeFalse){
+		if(canBeTrue && canBeFalse){
+			return Interval::Truth::UNKNOWN;
+		}
+		return canBeTrue ? Interval::Truth::TRUE : Interval::Truth::FALSE;
+	}
+
+	// Library functions are not always correctly rounded, include the neighbouring values.
+	void widen(double& min, double& max){
+		min = std::nextafter(min, -INF);
+		max = std::nextafter(max, INF);
+	}
+
+	struct Monotonic {
+		double (*func)(double);
+		// NaN outside of the domain.
+		double lower;
+		double upper;
+		bool increasing;
+		bool rounded;
+	};
+
+	Interval monotonic(const Interval& x, const Monotonic& f){
+		const bool nan = x.nan || x.min < f.lower || x.max > f.upper;
+		const double a = std::max(x.min, f.lower);
+		const double b = std::min(x.max, f.upper);
+		if(x.empty() || a > b){
+			return nanOnly(Value::FLOAT);
+		}
+		double min = f.func(f.increasing ? a : b);
+		double max = f.func(f.increasing ? b : a);
+		if(f.rounded){
+			widen(min, max);
+		}
+		return bounds(min, max, Value::FLOAT, nan);
+	}
+
+	const std::unordered_map<std::string, Monotonic>& monotonicFunctions(){
+		static const std::unordered_map<std::string, Monotonic> functions = {
+			{ "exp", { [](double x){ return glm::exp(x); }, -INF, INF, true, true } },
+			{ "exp2", { [](double x){ return glm::exp2(x); }, -INF, INF, true, true } },
+			{ "log", { [](double x){ return glm::log(x); }, 0.0, INF, true, true } },
+			{ "log2", { [](double x){ return glm::log2(x); }, 0.0, INF, true, true } },
+			{ "sqrt", { [](double x){ return glm::sqrt(x); }, 0.0, INF, true, true } },
+			{ "asin", { [](double x){ return glm::asin(x); }, -1.0, 1.0, true, true } },
+			{ "acos", { [](double x){ return glm::acos(x); }, -1.0, 1.0, false, true } },
+			{ "atan", { [](double x){ return glm::atan(x); }, -INF, INF, true, true } },
+			{ "sinh", { [](double x){ return glm::sinh(x); }, -INF, INF, true, true } },
+			{ "tanh", { [](double x){ return glm::tanh(x); }, -INF, INF, true, true } },
+			{ "asinh", { [](double x){ return glm::asinh(x); }, -INF, INF, true, true } },
+			{ "acosh", { [](double x){ return glm::acosh(x); }, 1.0, INF, true, true } },
+			{ "atanh", { [](double x){ return glm::atanh(x); }, -1.0, 1.0, true, true } },
+			{ "radians", { [](double x){ return glm::radians(x); }, -INF, INF, true, true } },
+			{ "degrees", { [](double x){ return glm::degrees(x); }, -INF, INF, true, true } },
+			{ "floor", { [](double x){ return glm::floor(x); }, -INF, INF, true, false } },
+			{ "ceil", { [](double x){ return glm::ceil(x); }, -INF, INF, true, false } },
+			{ "trunc", { [](double x){ return glm::trunc(x); }, -INF, INF, true, false } },
+			{ "round", { [](double x){ return glm::round(x); }, -INF, INF, true, false } },
+			{ "saturate", { [](double x){ return glm::clamp(x, 0.0, 1.0); }, -INF, INF, true, false } },
+		};
+		return functions;
+	}
+
+	// Is there a point c + k.period in the range, with some margin for the rounding of the period multiple.
+	bool containsPeriodic(const Interval& x, double c, double period){
+		const double margin = 1e-9 * (1.0 + std::abs(x.min) + std::abs(x.max));
+		const double k = std::ceil((x.min - margin - c) / period);
+		return c + k * period <= x.max + margin;
+	}
+
+	// Sine or cosine, with a maximum at peak.
+	Interval periodic(const Interval& x, double (*func)(double), double peak){
+		if(x.empty()){
+			return nanOnly(Value::FLOAT);
+		}
+		const double twoPi = glm::two_pi<double>();
+		const bool infinite = std::isinf(x.min) || std::isinf(x.max);
+		if(infinite || x.max - x.min >= twoPi){
+			return Interval(-1.0, 1.0, Value::FLOAT, x.nan || infinite);
+		}
+		double min = std::min(func(x.min), func(x.max));
+		double max = std::max(func(x.min), func(x.max));
+		widen(min, max);
+		if(containsPeriodic(x, peak, twoPi)){
+			max = 1.0;
+		}
+		if(containsPeriodic(x, peak + glm::pi<double>(), twoPi)){
+			min = -1.0;
+		}
+		return bounds(min, max, Value::FLOAT, x.nan);
+	}
+
+	Interval tangent(const Interval& x){
+		if(x.empty()){
+			return nanOnly(Value::FLOAT);
+		}
+		const double pi = glm::pi<double>();
+		if(std::isinf(x.min) || std::isinf(x.max) || x.max - x.min >= pi || containsPeriodic(x, 0.5 * pi, pi)){
+			return Interval::any();
+		}
+		double min = glm::tan(x.min);
+		double max = glm::tan(x.max);
+		widen(min, max);
+		return bounds(min, max, Value::FLOAT, x.nan);
+	}
+
+	Interval absolute(const Interval& x){
+		if(x.empty()){
+			return nanOnly(Value::FLOAT);
+		}
+		if(x.min >= 0.0){
+			return bounds(x.min, x.max, Value::FLOAT, x.nan);
+		}
+		if(x.max <= 0.0){
+			return bounds(-x.max, -x.min, Value::FLOAT, x.nan);
+		}
+		return bounds(0.0, std::max(-x.min, x.max), Value::FLOAT, x.nan);
+	}
+
+	// Same as glm, a NaN in the second operand returns the first one.
+	Interval minimum(const Interval& a, const Interval& b){
+		if(a.empty() || b.empty()){
+			return a;
+		}
+		const double max = b.nan ? a.max : std::min(a.max, b.max);
+		return bounds(std::min(a.min, b.min), max, Value::FLOAT, a.nan);
+	}
+
+	Interval maximum(const Interval& a, const Interval& b){
+		if(a.empty() || b.empty()){
+			return a;
+		}
+		const double min = b.nan ? a.min : std::max(a.min, b.min);
+		return bounds(min, std::max(a.max, b.max), Value::FLOAT, a.nan);
+	}
+
+	Interval fractional(const Interval& x){
+		if(x.empty()){
+			return nanOnly(Value::FLOAT);
+		}
+		if(std::isinf(x.min) || std::isinf(x.max)){
+			return Interval(0.0, 1.0, Value::FLOAT, true);
+		}
+		const double floorMin = glm::floor(x.min);
+		if(floorMin == glm::floor(x.max)){
+			return bounds(x.min - floorMin, x.max - floorMin, Value::FLOAT, x.nan);
+		}
+		return Interval(0.0, 1.0, Value::FLOAT, x.nan);
+	}
+
+	Interval modulo(const Interval& x, const Interval& m){
+		if(!m.exact || !(m.min > 0.0) || std::isinf(m.min)){
+			return Interval::any();
+		}
+		if(x.empty()){
+			return nanOnly(Value::FLOAT);
+		}
+		if(std::isinf(x.min) || std::isinf(x.max)){
+			return Interval(0.0, m.min, Value::FLOAT, true);
+		}
+		const double y = m.min;
+		const double quotient = glm::floor(x.min / y);
+		if(quotient == glm::floor(x.max / y)){
+			return bounds(x.min - y * quotient, x.max - y * quotient, Value::FLOAT, x.nan);
+		}
+		// The rounded quotient can be off by one.
+		return Interval(-1e-12 * y, y * (1.0 + 1e-12), Value::FLOAT, x.nan);
+	}
+
+	// glm::step(e, x) is 0 if x < e, 1 otherwise.
+	Interval step(const Interval& e, const Interval& x){
+		const bool canBeZero = !x.empty() && !e.empty() && x.min < e.max;
+		const bool canBeOne = x.nan || e.nan || (!x.empty() && !e.empty() && x.max >= e.min);
+		if(canBeOne && canBeZero){
+			return Interval(0.0, 1.0, Value::FLOAT);
+		}
+		return Interval(Value(canBeOne ? 1.0 : 0.0));
+	}
+
+	Interval smoothstep(const Interval& e0, const Interval& e1, const Interval& x){
+		if(!e0.exact || !e1.exact || !(e0.min < e1.min) || std::isinf(e1.min - e0.min)){
+			return Interval::any();
+		}
+		if(x.empty()){
+			return nanOnly(Value::FLOAT);
+		}
+		double min = glm::smoothstep(e0.min, e1.min, x.min);
+		double max = glm::smoothstep(e0.min, e1.min, x.max);
+		widen(min, max);
+		widen(min, max);
+		return bounds(min, max, Value::FLOAT, x.nan);
+	}
+
+}
+
+Interval::Interval(const Value& _value) : value(_value), type(_value.type), exact(true) {
+	if(scalar()){
+		const double v = scalarValue(value);
+		if(std::isnan(v)){
+			min = INF;
+			max = -INF;
+			nan = true;
+		} else {
+			min = max = v;
+		}
+	}
+}
+
+Interval::Interval(double _min, double _max, Value::Type _type, bool _nan) : min(_min), max(_max), type(_type), nan(_nan) {
+}
+
+Interval Interval::any(Value::Type type){
+	if(type == Value::BOOL){
+		return Interval(0.0, 1.0, Value::BOOL);
+	}
+	return Interval(-INF, INF, type, true);
+}
+
+Interval::Truth Interval::truth() const {
+	if(!scalar()){
+		return Truth::UNKNOWN;
+	}
+	// NaN is converted to true.
+	const bool canBeTrue = nan || (!empty() && (min != 0.0 || max != 0.0));
+	const bool canBeFalse = !empty() && min <= 0.0 && max >= 0.0;
+	return truthFrom(canBeTrue, canBeFalse);
+}
+
+IntervalEval::IntervalEval(const Scope& scope, FunctionsLibrary& stdlib) : _eval(scope, stdlib, Format::INTERNAL) {
+}
+
+bool IntervalEval::evaluate(const FunctionDef& def, const std::vector<Interval>& args, Interval& result){
+	if(def.args.size() != args.size()){
+		return false;
+	}
+	const bool success = evaluateFunction(def, args) && !_failed;
+	result = _result;
+	return success;
+}
+
+bool IntervalEval::evaluateFunction(const FunctionDef& def, const std::vector<Interval>& args){
+	auto& currentScope = _localScopes.emplace();
+	const size_t argCount = args.size();
+	for(size_t aid = 0; aid < argCount; ++aid){
+		currentScope[def.args[aid]] = args[aid];
+	}
+	const bool success = def.expr->evaluate(*this).b;
+	_localScopes.pop();
+	return success;
+}
+
+bool IntervalEval::applyExact(const Value& value){
+	if(_eval.hasFailed()){
+		registerError(_eval.getStatus().message, nullptr);
+		return false;
+	}
+	_result = Interval(value);
+	return true;
+}
+
+Value IntervalEval::process(const Unary& exp) {
+	if(!exp.exp->evaluate(*this).b){
+		return false;
+	}
+	const Interval v = _result;
+	return applyUnary(exp.op, v);
+}
+
+bool IntervalEval::applyUnary(Operator op, const Interval& v){
+	if(v.exact){
+		return applyExact(_eval.applyUnary(op, v.value));
+	}
+	switch(op){
+		case Operator::Plus:
+			_result = v;
+			return true;
+		case Operator::Minus:
+			if(v.type == Value::BOOL){
+				return false;
+			}
+			_result = bounds(-v.max, -v.min, v.type, v.nan);
+			return true;
+		case Operator::BoolNot:
+			if(v.type != Value::BOOL){
+				_result = Interval::any(Value::BOOL);
+				return true;
+			}
+			switch(v.truth()){
+				case Interval::Truth::TRUE:
+					_result = truthBounds(Interval::Truth::FALSE);
+					return true;
+				case Interval::Truth::FALSE:
+					_result = truthBounds(Interval::Truth::TRUE);
+					return true;
+				default:
+					break;
+			}
+			_result = truthBounds(Interval::Truth::UNKNOWN);
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+Value IntervalEval::process(const Binary& exp) {
+	if(!exp.left->evaluate(*this).b){
+		return false;
+	}
+	const Interval left = _result;
+	// Same short-circuit as the evaluator.
+	const Interval::Truth leftTruth = left.truth();
+	if(exp.op == Operator::BoolAnd && leftTruth == Interval::Truth::FALSE){
+		_result = truthBounds(Interval::Truth::FALSE);
+		return true;
+	}
+	if(exp.op == Operator::BoolOr && leftTruth == Interval::Truth::TRUE){
+		_result = truthBounds(Interval::Truth::TRUE);
+		return true;
+	}
+	if(!exp.right->evaluate(*this).b){
+		return false;
+	}
+	const Interval right = _result;
+	return applyBinary(exp.op, left, right);
+}
+
+bool IntervalEval::applyBinary(Operator op, const Interval& l, const Interval& r){
+	if(l.exact && r.exact){
+		return applyExact(_eval.applyBinary(op, l.value, r.value));
+	}
+	if(!l.scalar() || !r.scalar()){
+		return false;
+	}
+
+	switch(op){
+		case Operator::BoolAnd:
+		case Operator::BoolOr:
+		case Operator::BoolXor:
+		{
+			const Interval::Truth tl = l.truth();
+			const Interval::Truth tr = r.truth();
+			const bool known = tl != Interval::Truth::UNKNOWN && tr != Interval::Truth::UNKNOWN;
+			const bool vl = tl == Interval::Truth::TRUE;
+			const bool vr = tr == Interval::Truth::TRUE;
+			Interval::Truth truth = Interval::Truth::UNKNOWN;
+			if(op == Operator::BoolAnd){
+				if(tl == Interval::Truth::FALSE || tr == Interval::Truth::FALSE){
+					truth = Interval::Truth::FALSE;
+				} else if(known){
+					truth = Interval::Truth::TRUE;
+				}
+			} else if(op == Operator::BoolOr){
+				if(tl == Interval::Truth::TRUE || tr == Interval::Truth::TRUE){
+					truth = Interval::Truth::TRUE;
+				} else if(known){
+					truth = Interval::Truth::FALSE;
+				}
+			} else if(known){
+				truth = vl != vr ? Interval::Truth::TRUE : Interval::Truth::FALSE;
+			}
+			_result = truthBounds(truth);
+			return true;
+		}
+		case Operator::LessThan:
+		case Operator::GreaterThan:
+		case Operator::LessThanEqual:
+		case Operator::GreaterThanEqual:
+		case Operator::Equal:
+		case Operator::Different:
+			return applyComparison(op, l, r);
+		case Operator::Plus:
+		case Operator::Minus:
+		case Operator::Product:
+		case Operator::Divide:
+		case Operator::Power:
+			break;
+		default:
+			// Integer operations, no useful bounds.
+			_result = Interval::any(std::max({ l.type, r.type, Value::INTEGER }));
+			return true;
+	}
+
+	// Same type promotion as the evaluator.
+	const bool toFloat = op == Operator::Divide || op == Operator::Power;
+	const Value::Type type = std::max({ l.type, r.type, toFloat ? Value::FLOAT : Value::INTEGER });
+	bool nan = l.nan || r.nan;
+	if(l.empty() || r.empty()){
+		_result = nanOnly(type);
+		return true;
+	}
+	// Rounding is monotonic, so bounds computed with the same operations as the evaluator are exact.
+	switch(op){
+		case Operator::Plus:
+			// Opposite infinities can be reached together.
+			nan = nan || (l.max == INF && r.min == -INF) || (l.min == -INF && r.max == INF);
+			_result = bounds(l.min + r.min, l.max + r.max, type, nan);
+			return true;
+		case Operator::Minus:
+			nan = nan || (l.max == INF && r.max == INF) || (l.min == -INF && r.min == -INF);
+			_result = bounds(l.min - r.max, l.max - r.min, type, nan);
+			return true;
+		case Operator::Product:
+		{
+			// Zero inside one range, infinity at the end of the other.
+			const bool lZero = l.min <= 0.0 && l.max >= 0.0;
+			const bool rZero = r.min <= 0.0 && r.max >= 0.0;
+			const bool lInfinite = std::isinf(l.min) || std::isinf(l.max);
+			const bool rInfinite = std::isinf(r.min) || std::isinf(r.max);
+			nan = nan || (lZero && rInfinite) || (rZero && lInfinite);
+			double min = INF;
+			double max = -INF;
+			for(const double a : { l.min, l.max }){
+				for(const double b : { r.min, r.max }){
+					double p = a * b;
+					// Zero times infinity, already flagged.
+					if(std::isnan(p)){
+						p = 0.0;
+					}
+					min = std::min(min, p);
+					max = std::max(max, p);
+				}
+			}
+			_result = bounds(min, max, type, nan);
+			return true;
+		}
+		case Operator::Divide:
+		{
+			if(r.min <= 0.0 && r.max >= 0.0){
+				_result = Interval::any(type);
+				return true;
+			}
+			double min = INF;
+			double max = -INF;
+			for(const double a : { l.min, l.max }){
+				for(const double b : { r.min, r.max }){
+					const double q = a / b;
+					// Infinity divided by infinity.
+					if(std::isnan(q)){
+						_result = Interval::any(type);
+						return true;
+					}
+					min = std::min(min, q);
+					max = std::max(max, q);
+				}
+			}
+			_result = bounds(min, max, type, nan);
+			return true;
+		}
+		default:
+			break;
+	}
+
+	// Power, integer exponents are common.
+	if(r.exact && r.min == glm::round(r.min) && std::abs(r.min) < 1e9){
+		const double n = r.min;
+		if(n == 0.0){
+			_result = Interval(Value(1.0));
+			return true;
+		}
+		const bool even = glm::mod(n, 2.0) == 0.0;
+		const bool containsZero = l.min <= 0.0 && l.max >= 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		if(even){
+			const double low = containsZero ? 0.0 : std::min(std::abs(l.min), std::abs(l.max));
+			const double high = std::max(std::abs(l.min), std::abs(l.max));
+			min = glm::pow(n > 0.0 ? low : high, n);
+			max = glm::pow(n > 0.0 ? high : low, n);
+		} else {
+			if(n < 0.0 && containsZero){
+				_result = Interval::any();
+				return true;
+			}
+			min = glm::pow(n > 0.0 ? l.min : l.max, n);
+			max = glm::pow(n > 0.0 ? l.max : l.min, n);
+		}
+		widen(min, max);
+		_result = bounds(min, max, Value::FLOAT, l.nan);
+		return true;
+	}
+	// For positive bases, the extrema of y.log(x) are reached at the corners.
+	if(l.min > 0.0 || (l.min >= 0.0 && r.min > 0.0)){
+		double min = INF;
+		double max = -INF;
+		for(const double a : { l.min, l.max }){
+			for(const double b : { r.min, r.max }){
+				const double p = glm::pow(a, b);
+				min = std::min(min, p);
+				max = std::max(max, p);
+			}
+		}
+		widen(min, max);
+		_result = bounds(min, max, Value::FLOAT, nan);
+		return true;
+	}
+	_result = Interval::any();
+	return true;
+}
+
+bool IntervalEval::applyComparison(Operator op, const Interval& l, const Interval& r){
+	bool canBeTrue = false;
+	bool canBeFalse = false;
+	if(!l.empty() && !r.empty()){
+		const bool overlap = l.min <= r.max && r.min <= l.max;
+		const bool single = l.min == l.max && r.min == r.max && l.min == r.min;
+		switch(op){
+			case Operator::LessThan:
+				canBeTrue = l.min < r.max;
+				canBeFalse = l.max >= r.min;
+				break;
+			case Operator::GreaterThan:
+				canBeTrue = l.max > r.min;
+				canBeFalse = l.min <= r.max;
+				break;
+			case Operator::LessThanEqual:
+				canBeTrue = l.min <= r.max;
+				canBeFalse = l.max > r.min;
+				break;
+			case Operator::GreaterThanEqual:
+				canBeTrue = l.max >= r.min;
+				canBeFalse = l.min < r.max;
+				break;
+			case Operator::Equal:
+				canBeTrue = overlap;
+				canBeFalse = !single;
+				break;
+			case Operator::Different:
+				canBeTrue = !single;
+				canBeFalse = overlap;
+				break;
+			default:
+				return false;
+		}
+	}
+	// Comparisons with NaN are false, except for difference.
+	if(l.nan || r.nan){
+		if(op == Operator::Different){
+			canBeTrue = true;
+		} else {
+			canBeFalse = true;
+		}
+	}
+	_result = truthBounds(truthFrom(canBeTrue, canBeFalse));
+	return true;
+}
+
+Value IntervalEval::process(const Ternary& exp) {
+	if(!exp.condition->evaluate(*this).b){
+		return false;
+	}
+	const Interval::Truth truth = _result.truth();
+	if(truth == Interval::Truth::TRUE){
+		return exp.pass->evaluate(*this);
+	}
+	if(truth == Interval::Truth::FALSE){
+		return exp.fail->evaluate(*this);
+	}
+	// Both branches can be selected.
+	if(!exp.pass->evaluate(*this).b){
+		return false;
+	}
+	const Interval pass = _result;
+	if(!exp.fail->evaluate(*this).b){
+		return false;
+	}
+	const Interval fail = _result;
+	if(!pass.scalar() || !fail.scalar()){
+		EXIT(&exp, "Unsupported non-scalar branches.");
+	}
+	const Value::Type type = std::max(pass.type, fail.type);
+	// Operations depend on the type of each value.
+	if(pass.type != fail.type){
+		_result = Interval::any(type);
+		return true;
+	}
+	if(pass.empty() || fail.empty()){
+		const Interval& other = pass.empty() ? fail : pass;
+		_result = bounds(other.min, other.max, type, true);
+		return true;
+	}
+	_result = bounds(std::min(pass.min, fail.min), std::max(pass.max, fail.max), type, pass.nan || fail.nan);
+	return true;
+}
+
+Value IntervalEval::process(const Member& exp) {
+	if(!exp.parent->evaluate(*this).b){
+		return false;
+	}
+	if(!_result.exact){
+		EXIT(&exp, "Unsupported member of a range.");
+	}
+	const Value parent = _result.value;
+	return applyExact(_eval.applyMember(parent, exp.member, &exp));
+}
+
+Value IntervalEval::process(const Literal& exp) {
+	_result = Interval(exp.val);
+	return true;
+}
+
+Value IntervalEval::process(const Variable& exp) {
+	EXIT(&exp, "Unexpected variable " + exp.name + " in function declaration.");
+}
+
+Value IntervalEval::process(const VariableDef& exp) {
+	EXIT(&exp, "Unexpected variable definition (" + exp.name + ") in function declaration.");
+}
+
+Value IntervalEval::process(const FunctionDef& exp) {
+	EXIT(&exp, "Unexpected nested function declaration (" + exp.name + ").");
+}
+
+Value IntervalEval::process(FunctionVar& exp) {
+	// Baked global variables are constants.
+	if(exp.hasValue()){
+		_result = Interval(exp.value());
+		return true;
+	}
+	if(!_localScopes.empty()){
+		const auto& currentScope = _localScopes.top();
+		const auto arg = currentScope.find(exp.name);
+		if(arg != currentScope.end()){
+			_result = arg->second;
+			return true;
+		}
+	}
+	EXIT(&exp, "Undefined variable " + exp.name + ".");
+}
+
+Value IntervalEval::process(const FunctionCall& exp) {
+	const size_t argCount = exp.args.size();
+	std::vector<Interval> args(argCount);
+	bool exact = true;
+	for(size_t aid = 0; aid < argCount; ++aid){
+		if(!exp.args[aid]->evaluate(*this).b){
+			return false;
+		}
+		args[aid] = _result;
+		exact = exact && _result.exact;
+	}
+	if(exact){
+		std::vector<Value> values(argCount);
+		for(size_t aid = 0; aid < argCount; ++aid){
+			values[aid] = args[aid].value;
+		}
+		return applyExact(_eval.callFunction(exp.name, values, &exp));
+	}
+
+	const FunctionDef* def = _eval.findFunction(exp.name);
+	if(def){
+		if(def->args.size() != argCount){
+			EXIT(&exp, "Incorrect number of arguments for function " + exp.name + ".");
+		}
+		return evaluateFunction(*def, args);
+	}
+	const FunctionsLibrary::FunctionInfos* builtin = _eval.stdlib().find(exp.name);
+	if(!builtin || !_eval.stdlib().validArgCount(*builtin, argCount)){
+		EXIT(&exp, "Undefined function " + exp.name + ".");
+	}
+	return callBuiltin(exp.name, args);
+}
+
+bool IntervalEval::callBuiltin(const std::string& name, const std::vector<Interval>& args){
+	for(const Interval& arg : args){
+		if(!arg.scalar()){
+			EXIT(nullptr, "Unsupported non-scalar argument for function " + name + ".");
+		}
+	}
+	// Arguments are converted to the type of one of them, only floats are supported.
+	const size_t argCount = args.size();
+	auto floatArg = [&args](size_t aid){
+		return args[aid].type == Value::FLOAT;
+	};
+
+	const auto& functions = monotonicFunctions();
+	const auto monotonicFunc = functions.find(name);
+	if(monotonicFunc != functions.end() && argCount == 1){
+		if(!floatArg(0)){
+			return false;
+		}
+		_result = monotonic(args[0], monotonicFunc->second);
+		return true;
+	}
+
+	if(argCount == 1){
+		const Interval& x = args[0];
+		if(name == "sin" || name == "cos" || name == "tan" || name == "abs" || name == "cosh" || name == "sign"
+		   || name == "fract" || name == "frac" || name == "rcp" || name == "inversesqrt"){
+			if(!floatArg(0)){
+				return false;
+			}
+		}
+		if(name == "sin"){
+			_result = periodic(x, [](double v){ return glm::sin(v); }, glm::half_pi<double>());
+			return true;
+		}
+		if(name == "cos"){
+			_result = periodic(x, [](double v){ return glm::cos(v); }, 0.0);
+			return true;
+		}
+		if(name == "tan"){
+			_result = tangent(x);
+			return true;
+		}
+		if(name == "abs"){
+			_result = absolute(x);
+			return true;
+		}
+		if(name == "cosh"){
+			// Even function.
+			_result = monotonic(absolute(x), { [](double v){ return glm::cosh(v); }, -INF, INF, true, true });
+			return true;
+		}
+		if(name == "sign"){
+			// The sign of NaN is 0.
+			if(x.empty()){
+				_result = Interval(Value(0.0));
+				return true;
+			}
+			double min = glm::sign(x.min);
+			double max = glm::sign(x.max);
+			if(x.nan){
+				min = std::min(min, 0.0);
+				max = std::max(max, 0.0);
+			}
+			_result = bounds(min, max, Value::FLOAT, false);
+			return true;
+		}
+		if(name == "fract" || name == "frac"){
+			_result = fractional(x);
+			return true;
+		}
+		if(name == "rcp"){
+			return applyBinary(Operator::Divide, Interval(Value(1.0)), x);
+		}
+		if(name == "inversesqrt"){
+			const Interval root = monotonic(x, functions.at("sqrt"));
+			return applyBinary(Operator::Divide, Interval(Value(1.0)), root);
+		}
+	}
+
+	if(argCount == 2){
+		if(name == "min" || name == "max"){
+			if(std::max(args[0].type, args[1].type) != Value::FLOAT){
+				return false;
+			}
+			_result = name == "min" ? minimum(args[0], args[1]) : maximum(args[0], args[1]);
+			return true;
+		}
+		if(name == "pow"){
+			return floatArg(0) && applyBinary(Operator::Power, args[0], args[1]);
+		}
+		if(name == "mod"){
+			if(!floatArg(0)){
+				return false;
+			}
+			_result = modulo(args[0], args[1]);
+			return true;
+		}
+		if(name == "step"){
+			if(!floatArg(1)){
+				return false;
+			}
+			_result = step(args[0], args[1]);
+			return true;
+		}
+	}
+
+	if(argCount == 3){
+		if(name == "clamp"){
+			if(!floatArg(0)){
+				return false;
+			}
+			_result = minimum(maximum(args[0], args[1]), args[2]);
+			return true;
+		}
+		if(name == "smoothstep"){
+			if(!floatArg(2)){
+				return false;
+			}
+			_result = smoothstep(args[0], args[1], args[2]);
+			return true;
+		}
+		if(name == "mix" || name == "lerp"){
+			if(!floatArg(0)){
+				return false;
+			}
+			// x * (1 - t) + y * t, as computed by glm.
+			if(!applyBinary(Operator::Minus, Interval(Value(1.0)), args[2])){
+				return false;
+			}
+			const Interval oneMinusT = _result;
+			if(!applyBinary(Operator::Product, args[0], oneMinusT)){
+				return false;
+			}
+			const Interval left = _result;
+			if(!applyBinary(Operator::Product, args[1], args[2])){
+				return false;
+			}
+			const Interval right = _result;
+			return applyBinary(Operator::Plus, left, right);
+		}
+	}
+
+	EXIT(nullptr, "Unsupported function " + name + " on ranges.");
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Types.hpp"
+#include "core/Functions.hpp"
+#include "core/Evaluator.hpp"
+
+#include <stack>
+#include <unordered_map>
+
+/** Bounds of the values taken by a scalar expression when its arguments vary in ranges. Constant values are kept exactly,
+ so that they follow the same rules as the evaluator. Booleans are bounded in [0, 1]. Whether some points of the range
+ are not a number is tracked separately, the bounds only apply to the other points. */
+struct Interval {
+
+	enum class Truth {
+		FALSE, TRUE, UNKNOWN
+	};
+
+	Interval() = default;
+
+	// A single value, of any type.
+	explicit Interval(const Value& value);
+
+	// All values between min and max included, of a scalar type.
+	Interval(double min, double max, Value::Type type = Value::FLOAT, bool nan = false);
+
+	// Any number, or not a number.
+	static Interval any(Value::Type type = Value::FLOAT);
+
+	// Only NaN.
+	bool empty() const { return min > max; }
+
+	bool scalar() const { return type <= Value::FLOAT; }
+
+	// Possible results when converting to a boolean.
+	Truth truth() const;
+
+	Value value;
+	double min = 0.0;
+	double max = 0.0;
+	Value::Type type = Value::FLOAT;
+	bool exact = false;
+	bool nan = false;
+};
+
+/** Conservative evaluation of a function over ranges of its arguments, using interval arithmetic.
+ Exact subexpressions are computed with the regular evaluator, vector and matrix ranges are not supported.
+ Any value computed by the evaluator for arguments in the ranges is included in the result. */
+class IntervalEval final : public TreeVisitor {
+public:
+
+	IntervalEval(const Scope& scope, FunctionsLibrary& stdlib);
+
+	Value process(const Unary& exp) override;
+	Value process(const Binary& exp) override;
+	Value process(const Ternary& exp) override;
+	Value process(const Member& exp) override;
+	Value process(const Literal& exp) override;
+	Value process(const Variable& exp) override;
+	Value process(const VariableDef& exp) override;
+	Value process(const FunctionDef& exp) override;
+	Value process(		FunctionVar& exp) override;
+	Value process(const FunctionCall& exp) override;
+
+	// Returns false if the function can't be bounded on these ranges.
+	bool evaluate(const FunctionDef& def, const std::vector<Interval>& args, Interval& result);
+
+private:
+
+	bool applyUnary(Operator op, const Interval& v);
+	bool applyBinary(Operator op, const Interval& l, const Interval& r);
+	bool applyComparison(Operator op, const Interval& l, const Interval& r);
+	bool callBuiltin(const std::string& name, const std::vector<Interval>& args);
+	bool evaluateFunction(const FunctionDef& def, const std::vector<Interval>& args);
+
+	// Evaluate exactly when all operands are constant.
+	bool applyExact(const Value& value);
+
+	ExpEval _eval;
+	std::stack<std::unordered_map<std::string, Interval>> _localScopes;
+	// Bounds of the last processed expression.
+	Interval _result;
+};
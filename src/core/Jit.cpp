@@ -0,0 +1,574 @@
+#include "core/Jit.hpp"
+#include "core/Program.hpp"
+#include "core/Kernels.hpp"
+
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(__EMSCRIPTEN__)
+#	define JIT_X64
+#	ifdef _WIN32
+#		include <windows.h>
+#	else
+#		include <sys/mman.h>
+#	endif
+#endif
+
+namespace {
+
+	/** Operation on float slots, independent of the instruction set. */
+	struct Step {
+
+		enum class Kind : uchar {
+			ARITHMETIC,	// dst = operands[0] op operands[1]
+			NEGATE,		// dst = -operands[0]
+			MOVE,		// dst = operands[0]
+			CALL		// kernel(operands..., dst, sample count)
+		};
+
+		Kind kind;
+		// SSE opcode of the arithmetic operation.
+		uchar opcode = 0;
+		uint dst = 0;
+		uint operands[3] = {0, 0, 0};
+		uint operandCount = 0;
+		const void* kernel = nullptr;
+	};
+
+#ifdef JIT_X64
+
+	enum Register : uchar {
+		RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R12 = 12, R13 = 13, R14 = 14
+	};
+
+#ifdef _WIN32
+	const Register ARGUMENT_REGISTERS[] = { RCX, RDX, R8, R9 };
+	const uint REGISTER_ARGUMENT_COUNT = 4;
+#else
+	const Register ARGUMENT_REGISTERS[] = { RDI, RSI, RDX, RCX, R8 };
+	const uint REGISTER_ARGUMENT_COUNT = 5;
+#endif
+	// Shadow space for Windows calls and room for a fifth argument, keeps the stack aligned.
+	const uchar STACK_SIZE = 48;
+
+	/** Emit machine code evaluating a block of samples, slots are stored as columns of samples.
+	 Slots are addressed relative to rbx and constants relative to rbp, r13 contains the sample count.
+	 SSE2 scalar instructions use xmm0 and xmm1, AVX packed instructions for four samples use ymm0 and ymm1. */
+	class Assembler {
+	public:
+
+		Assembler(uint lanes, uint slotStride) : _lanes(lanes), _slotStride(slotStride), _constantStride(8 * lanes) {}
+
+		void prologue(){
+			emit({ 0x53 });					// push rbx
+			emit({ 0x55 });					// push rbp
+			emit({ 0x41, 0x54 });			// push r12
+			emit({ 0x41, 0x55 });			// push r13
+			emit({ 0x41, 0x56 });			// push r14
+			emit({ 0x48, 0x83, 0xEC, STACK_SIZE });	// sub rsp, STACK_SIZE
+			movRegister(RBX, ARGUMENT_REGISTERS[0]);
+			movRegister(RBP, ARGUMENT_REGISTERS[1]);
+			movRegister(R13, ARGUMENT_REGISTERS[2]);
+			movRegister(R14, RBX);
+		}
+
+		void epilogue(){
+			if(_lanes > 1){
+				vzeroupper();
+			}
+			emit({ 0x48, 0x83, 0xC4, STACK_SIZE });	// add rsp, STACK_SIZE
+			emit({ 0x41, 0x5E });			// pop r14
+			emit({ 0x41, 0x5D });			// pop r13
+			emit({ 0x41, 0x5C });			// pop r12
+			emit({ 0x5D });					// pop rbp
+			emit({ 0x5B });					// pop rbx
+			emit({ 0xC3 });					// ret
+		}
+
+		// Repeat the following instructions for each group of lanes, rbx points to the current samples.
+		void beginLoop(){
+			movRegister(R12, R13);
+			if(_lanes == 4){
+				emit({ 0x49, 0xC1, 0xEC, 0x02 });	// shr r12, 2
+			}
+			emit({ 0x4D, 0x85, 0xE4 });		// test r12, r12
+			emit({ 0x0F, 0x84 });			// jz end
+			_loopSkip = _code.size();
+			emit32(0);
+			_loopStart = _code.size();
+		}
+
+		void endLoop(){
+			emit({ 0x48, 0x81, 0xC3 });		// add rbx, lanes size
+			emit32(8 * _lanes);
+			emit({ 0x49, 0xFF, 0xCC });		// dec r12
+			emit({ 0x0F, 0x85 });			// jnz start
+			emit32(uint(int(_loopStart) - int(_code.size() + 4)));
+			patch32(_loopSkip, uint(_code.size() - (_loopSkip + 4)));
+			movRegister(RBX, R14);
+		}
+
+		void load(uchar xmm, uint operand){
+			if(_lanes > 1){
+				emit({ 0xC5, 0xFD, 0x10 });	// vmovupd ymm, m256
+			} else {
+				emit({ 0xF2, 0x0F, 0x10 });	// movsd xmm, m64
+			}
+			address(xmm, operand);
+		}
+
+		void store(uint slot, uchar xmm){
+			if(_lanes > 1){
+				emit({ 0xC5, 0xFD, 0x11 });	// vmovupd m256, ymm
+			} else {
+				emit({ 0xF2, 0x0F, 0x11 });	// movsd m64, xmm
+			}
+			address(xmm, slot);
+		}
+
+		// xmm0 = xmm0 op xmm1
+		void arithmetic(uchar opcode){
+			if(_lanes > 1){
+				emit({ 0xC5, 0xFD, opcode, 0xC1 });
+			} else {
+				emit({ 0xF2, 0x0F, opcode, 0xC1 });
+			}
+		}
+
+		// xmm0 = xmm0 ^ xmm1, on all bits.
+		void bitwiseXor(){
+			if(_lanes > 1){
+				emit({ 0xC5, 0xFD, 0x57, 0xC1 });	// vxorpd ymm0, ymm0, ymm1
+			} else {
+				emit({ 0x66, 0x0F, 0x57, 0xC1 });	// xorpd xmm0, xmm1
+			}
+		}
+
+		// Call an array kernel on all samples, outside of loops.
+		void call(const void* kernel, const uint* operands, uint operandCount, uint dst){
+			if(_lanes > 1){
+				vzeroupper();
+			}
+			uint arg = 0;
+			for(uint oid = 0; oid < operandCount; ++oid){
+				lea(ARGUMENT_REGISTERS[arg++], operands[oid]);
+			}
+			lea(ARGUMENT_REGISTERS[arg++], dst);
+			if(arg < REGISTER_ARGUMENT_COUNT){
+				movRegister(ARGUMENT_REGISTERS[arg], R13);
+			} else {
+				emit({ 0x4C, 0x89, 0x6C, 0x24, 0x20 });	// mov [rsp + 32], r13
+			}
+			emit({ 0x48, 0xB8 });			// mov rax, imm64
+			const uint64_t target = uint64_t(reinterpret_cast<uintptr_t>(kernel));
+			emit32(uint(target & 0xFFFFFFFFu));
+			emit32(uint(target >> 32u));
+			emit({ 0xFF, 0xD0 });			// call rax
+		}
+
+		const std::vector<uchar>& code() const { return _code; }
+
+	private:
+
+		void emit(std::initializer_list<uchar> bytes){
+			_code.insert(_code.end(), bytes);
+		}
+
+		void emit32(uint value){
+			for(uint i = 0; i < 4; ++i){
+				_code.push_back(uchar((value >> (8u * i)) & 0xFFu));
+			}
+		}
+
+		void patch32(size_t offset, uint value){
+			for(uint i = 0; i < 4; ++i){
+				_code[offset + i] = uchar((value >> (8u * i)) & 0xFFu);
+			}
+		}
+
+		// ModRM and displacement for [rbx + slot] or [rbp + constant].
+		void address(uchar reg, uint operand){
+			const bool constant = (operand & Instruction::CONSTANT_FLAG) != 0;
+			const uint index = operand & ~Instruction::CONSTANT_FLAG;
+			const uchar base = constant ? RBP : RBX;
+			_code.push_back(uchar(0x80 | ((reg & 0x7) << 3) | base));
+			emit32(index * (constant ? _constantStride : _slotStride));
+		}
+
+		void lea(Register reg, uint operand){
+			emit({ uchar(0x48 | (reg >= R8 ? 0x04 : 0x00)), 0x8D });
+			address(uchar(reg), operand);
+		}
+
+		void movRegister(Register dst, Register src){
+			emit({ uchar(0x48 | (src >= R8 ? 0x04 : 0x00) | (dst >= R8 ? 0x01 : 0x00)), 0x89, uchar(0xC0 | ((src & 0x7) << 3) | (dst & 0x7)) });
+		}
+
+		void vzeroupper(){
+			emit({ 0xC5, 0xF8, 0x77 });
+		}
+
+		std::vector<uchar> _code;
+		size_t _loopSkip = 0;
+		size_t _loopStart = 0;
+		const uint _lanes;
+		const uint _slotStride;
+		const uint _constantStride;
+	};
+
+	// Consecutive operators are evaluated in a single loop over the samples, kernels are called on all samples at once.
+	std::vector<uchar> generate(const std::vector<Step>& steps, uint signMask, uint lanes, uint slotStride){
+		Assembler assembler(lanes, slotStride);
+		assembler.prologue();
+		bool inLoop = false;
+		for(const Step& step : steps){
+			const bool isCall = step.kind == Step::Kind::CALL;
+			if(inLoop && isCall){
+				assembler.endLoop();
+				inLoop = false;
+			} else if(!inLoop && !isCall){
+				assembler.beginLoop();
+				inLoop = true;
+			}
+			switch(step.kind){
+				case Step::Kind::ARITHMETIC:
+					assembler.load(0, step.operands[0]);
+					assembler.load(1, step.operands[1]);
+					assembler.arithmetic(step.opcode);
+					assembler.store(step.dst, 0);
+					break;
+				case Step::Kind::NEGATE:
+					// Flip the sign bit, as the interpreter does, including for zeros and NaNs.
+					assembler.load(0, step.operands[0]);
+					assembler.load(1, signMask);
+					assembler.bitwiseXor();
+					assembler.store(step.dst, 0);
+					break;
+				case Step::Kind::MOVE:
+					assembler.load(0, step.operands[0]);
+					assembler.store(step.dst, 0);
+					break;
+				case Step::Kind::CALL:
+					assembler.call(step.kernel, step.operands, step.operandCount, step.dst);
+					break;
+			}
+		}
+		if(inLoop){
+			assembler.endLoop();
+		}
+		assembler.epilogue();
+		return assembler.code();
+	}
+
+	void* allocateExecutable(const std::vector<uchar>& code){
+#ifdef _WIN32
+		void* memory = VirtualAlloc(nullptr, code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if(memory == nullptr){
+			return nullptr;
+		}
+		std::memcpy(memory, code.data(), code.size());
+		DWORD previous;
+		if(!VirtualProtect(memory, code.size(), PAGE_EXECUTE_READ, &previous)){
+			VirtualFree(memory, 0, MEM_RELEASE);
+			return nullptr;
+		}
+		FlushInstructionCache(GetCurrentProcess(), memory, code.size());
+		return memory;
+#else
+		void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(memory == MAP_FAILED){
+			return nullptr;
+		}
+		std::memcpy(memory, code.data(), code.size());
+		if(mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0){
+			munmap(memory, code.size());
+			return nullptr;
+		}
+		return memory;
+#endif
+	}
+
+	void freeExecutable(void* memory, size_t size){
+#ifdef _WIN32
+		(void)size;
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, size);
+#endif
+	}
+
+#endif
+
+	std::atomic<bool> compilationEnabled{true};
+
+}
+
+/** Flatten a specialization into operations on float slots, user functions called are inlined. */
+class JitFunction::Translator {
+public:
+
+	// Translate a specialization, its frame is allocated after the current slots.
+	// Arguments are copied from the given operands, or already in place if nullptr.
+	// Returns false if it uses anything other than floats or contains jumps.
+	bool translate(const Program& program, const Specialization& specialization, const uint* argOperands, uint depth, uint& result){
+		const uint slotOffset = slotCount;
+		slotCount += specialization.registerCount;
+		_floatSlots.resize(slotCount, false);
+		const uint constantOffset = uint(constants.size());
+		for(const Value& constant : specialization.constants){
+			const bool isFloatConstant = constant.type == Value::FLOAT;
+			constants.push_back(isFloatConstant ? constant.f : 0.0);
+			_floatConstants.push_back(isFloatConstant);
+		}
+
+		auto global = [slotOffset, constantOffset](uint operand){
+			if(operand & Instruction::CONSTANT_FLAG){
+				return ((operand & ~Instruction::CONSTANT_FLAG) + constantOffset) | Instruction::CONSTANT_FLAG;
+			}
+			return operand + slotOffset;
+		};
+
+		for(uint aid = 0; aid < program._argCount; ++aid){
+			if(argOperands && !add(Step::Kind::MOVE, slotOffset + aid, &argOperands[aid], 1)){
+				return false;
+			}
+			_floatSlots[slotOffset + aid] = true;
+		}
+
+		// Destination of the last standard library call, until the type of its result has been checked.
+		uint pendingCall = slotCount;
+
+		for(const Instruction& ins : specialization.instructions){
+			const uint dst = global(ins.dst);
+			const uint operands[2] = { global(ins.a), global(ins.b) };
+			bool success = false;
+			switch(ins.code){
+				case Instruction::Code::FLOAT_BINARY:
+					switch(ins.op){
+						case Operator::Plus:	success = add(Step::Kind::ARITHMETIC, dst, operands, 2, 0x58); break;
+						case Operator::Minus:	success = add(Step::Kind::ARITHMETIC, dst, operands, 2, 0x5C); break;
+						case Operator::Product:	success = add(Step::Kind::ARITHMETIC, dst, operands, 2, 0x59); break;
+						case Operator::Divide:	success = add(Step::Kind::ARITHMETIC, dst, operands, 2, 0x5E); break;
+						case Operator::Power:
+						case Operator::Modulo:
+							success = add(Step::Kind::CALL, dst, operands, 2, 0, (const void*)Kernels::binaryOperator(ins.op));
+							break;
+						default:
+							// Comparisons produce booleans.
+							break;
+					}
+					break;
+				case Instruction::Code::FLOAT_UNARY:
+					success = add(Step::Kind::NEGATE, dst, operands, 1);
+					break;
+				case Instruction::Code::MOVE:
+					success = add(Step::Kind::MOVE, dst, operands, 1);
+					break;
+				case Instruction::Code::CALL:
+				{
+					const Program::Callee& callee = program._callees[ins.c];
+					if(callee.function || !callee.builtin || ins.b == 0 || ins.b > 3){
+						break;
+					}
+					uint callOperands[3];
+					for(uint aid = 0; aid < ins.b; ++aid){
+						callOperands[aid] = global(program._operands[ins.a + aid]);
+					}
+					const std::string& name = callee.builtin->name;
+					const void* kernel = ins.b == 1 ? (const void*)Kernels::unaryFunction(name)
+										: (ins.b == 2 ? (const void*)Kernels::binaryFunction(name) : (const void*)Kernels::ternaryFunction(name));
+					success = add(Step::Kind::CALL, dst, callOperands, ins.b, 0, kernel);
+					// The result type is checked by the next instruction.
+					_floatSlots[dst] = false;
+					pendingCall = dst;
+					break;
+				}
+				case Instruction::Code::CHECK_TYPE:
+					// Kernels always return floats.
+					if(Value::Type(ins.b) == Value::FLOAT && (operands[0] == pendingCall || isFloat(operands[0]))){
+						_floatSlots[operands[0]] = true;
+						success = true;
+					}
+					break;
+				case Instruction::Code::CALL_SPECIALIZED:
+				{
+					if(depth >= MAX_INLINE_DEPTH){
+						break;
+					}
+					const Specialization::Call& call = specialization.calls[ins.c];
+					std::vector<uint> callOperands(ins.b);
+					for(uint aid = 0; aid < ins.b; ++aid){
+						callOperands[aid] = global(program._operands[ins.a + aid]);
+					}
+					uint calleeResult = 0;
+					success = translate(*call.program, *call.specialization, callOperands.data(), depth + 1, calleeResult)
+						&& add(Step::Kind::MOVE, dst, &calleeResult, 1);
+					break;
+				}
+				default:
+					break;
+			}
+			if(!success){
+				return false;
+			}
+		}
+		result = global(program._result);
+		return isFloat(result);
+	}
+
+	std::vector<Step> steps;
+	std::vector<double> constants;
+	uint slotCount = 0;
+
+private:
+
+	static constexpr uint MAX_INLINE_DEPTH = 8;
+
+	bool isFloat(uint operand) const {
+		if(operand & Instruction::CONSTANT_FLAG){
+			return _floatConstants[operand & ~Instruction::CONSTANT_FLAG];
+		}
+		return _floatSlots[operand];
+	}
+
+	bool add(Step::Kind kind, uint dst, const uint* operands, uint operandCount, uchar opcode = 0, const void* kernel = nullptr){
+		if(kind == Step::Kind::CALL && kernel == nullptr){
+			return false;
+		}
+		Step step;
+		step.kind = kind;
+		step.opcode = opcode;
+		step.dst = dst;
+		step.operandCount = operandCount;
+		step.kernel = kernel;
+		for(uint oid = 0; oid < operandCount; ++oid){
+			if(!isFloat(operands[oid])){
+				return false;
+			}
+			step.operands[oid] = operands[oid];
+			// Kernels expect an array of samples for each argument, copy constants to a slot.
+			if(kind == Step::Kind::CALL && (operands[oid] & Instruction::CONSTANT_FLAG)){
+				const uint slot = slotCount++;
+				_floatSlots.push_back(false);
+				add(Step::Kind::MOVE, slot, &operands[oid], 1);
+				step.operands[oid] = slot;
+			}
+		}
+		_floatSlots[dst] = true;
+		steps.push_back(step);
+		return true;
+	}
+
+	std::vector<bool> _floatSlots;
+	std::vector<bool> _floatConstants;
+};
+
+std::unique_ptr<const JitFunction> JitFunction::compile(const Program& program, const Specialization& specialization){
+#ifdef JIT_X64
+	if(!compilationEnabled){
+		return nullptr;
+	}
+	Translator translator;
+	uint result = 0;
+	if(!translator.translate(program, specialization, nullptr, 0, result)){
+		return nullptr;
+	}
+
+	std::unique_ptr<JitFunction> function(new JitFunction());
+	function->_argCount = program._argCount;
+	function->_slotCount = translator.slotCount;
+	function->_result = result;
+	function->_constants = translator.constants;
+	// Only the sign bit is set in -0.0.
+	const uint signMask = uint(function->_constants.size()) | Instruction::CONSTANT_FLAG;
+	function->_constants.push_back(-0.0);
+	for(const double constant : function->_constants){
+		function->_wideConstants.insert(function->_wideConstants.end(), 4, constant);
+	}
+
+	// Single sample, and blocks of samples with four samples per instruction if possible.
+	std::vector<uchar> code = generate(translator.steps, signMask, 1, 8);
+	const size_t blockOffset = code.size();
+	const bool vectorized = Kernels::usesAVX2();
+	const std::vector<uchar> blockCode = generate(translator.steps, signMask, vectorized ? 4 : 1, 8 * BLOCK_SIZE);
+	code.insert(code.end(), blockCode.begin(), blockCode.end());
+
+	function->_code = allocateExecutable(code);
+	if(function->_code == nullptr){
+		return nullptr;
+	}
+	function->_codeSize = code.size();
+	uchar* const start = static_cast<uchar*>(function->_code);
+	function->_scalar = reinterpret_cast<Entry>(start);
+	function->_block = reinterpret_cast<Entry>(start + blockOffset);
+	function->_lanes = vectorized ? 4 : 1;
+	return function;
+#else
+	(void)program;
+	(void)specialization;
+	return nullptr;
+#endif
+}
+
+void JitFunction::setEnabled(bool enabled){
+	compilationEnabled = enabled;
+}
+
+JitFunction::~JitFunction(){
+#ifdef JIT_X64
+	if(_code){
+		freeExecutable(_code, _codeSize);
+	}
+#endif
+}
+
+double JitFunction::run(const double* args) const {
+	// Small frames are allocated on the stack.
+	double localFrame[LOCAL_FRAME_SIZE];
+	thread_local std::vector<double> largeFrame;
+	double* frame = localFrame;
+	if(_slotCount > LOCAL_FRAME_SIZE){
+		largeFrame.resize(_slotCount);
+		frame = largeFrame.data();
+	}
+	std::copy(args, args + _argCount, frame);
+	_scalar(frame, _constants.data(), 1);
+	if(_result & Instruction::CONSTANT_FLAG){
+		return _constants[_result & ~Instruction::CONSTANT_FLAG];
+	}
+	return frame[_result];
+}
+
+void JitFunction::run(const double* const* args, const size_t* strides, double* out, size_t count) const {
+	thread_local std::vector<double> slots;
+	slots.resize(BLOCK_SIZE * _slotCount);
+	const std::vector<double>& constants = _lanes > 1 ? _wideConstants : _constants;
+
+	for(size_t start = 0; start < count; start += BLOCK_SIZE){
+		const size_t sampleCount = std::min(BLOCK_SIZE, count - start);
+		// Complete the last group of lanes by repeating the last sample.
+		const size_t laneCount = ((sampleCount + _lanes - 1) / _lanes) * _lanes;
+		for(uint aid = 0; aid < _argCount; ++aid){
+			double* dst = slots.data() + aid * BLOCK_SIZE;
+			if(strides[aid] == 0){
+				std::fill(dst, dst + laneCount, args[aid][0]);
+				continue;
+			}
+			const double* src = args[aid] + start * strides[aid];
+			for(size_t sid = 0; sid < sampleCount; ++sid){
+				dst[sid] = src[sid * strides[aid]];
+			}
+			std::fill(dst + sampleCount, dst + laneCount, dst[sampleCount - 1]);
+		}
+
+		_block(slots.data(), constants.data(), laneCount);
+
+		if(_result & Instruction::CONSTANT_FLAG){
+			std::fill(out + start, out + start + sampleCount, _constants[_result & ~Instruction::CONSTANT_FLAG]);
+		} else {
+			const double* result = slots.data() + _result * BLOCK_SIZE;
+			std::copy(result, result + sampleCount, out + start);
+		}
+	}
+}
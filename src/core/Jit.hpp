@@ -0,0 +1,59 @@
+#pragma once
+#include "core/Common.hpp"
+
+class Program;
+struct Specialization;
+
+/** Native x86-64 code for a specialization where all arguments, registers and constants are floats.
+ Each register is stored in a slot, operators are translated to SSE2 instructions (AVX for four samples at once),
+ other operations and standard library functions call the array kernels, user functions are inlined.
+ Only straight-line code is supported. */
+class JitFunction {
+public:
+
+	// Returns nullptr if the specialization can't be compiled, if the platform is not supported or if disabled.
+	static std::unique_ptr<const JitFunction> compile(const Program& program, const Specialization& specialization);
+
+	// Disable compilation, to compare with the interpreter. Specializations already built keep their native code.
+	static void setEnabled(bool enabled);
+
+	~JitFunction();
+
+	// Evaluate one sample.
+	double run(const double* args) const;
+
+	// Evaluate many samples. Each argument is an array of samples, or a single value if its stride is 0.
+	void run(const double* const* args, const size_t* strides, double* out, size_t count) const;
+
+	uint argCount() const { return _argCount; }
+
+private:
+
+	// Evaluate sampleCount samples, each slot is a column of samples.
+	using Entry = void (*)(double* slots, const double* constants, size_t sampleCount);
+
+	class Translator;
+
+	// Frames with more slots are allocated on the heap.
+	static constexpr uint LOCAL_FRAME_SIZE = 32;
+	// Samples evaluated by each call to the block code.
+	static constexpr size_t BLOCK_SIZE = 256;
+
+	JitFunction() = default;
+
+	JitFunction(const JitFunction&) = delete;
+	JitFunction& operator=(const JitFunction&) = delete;
+
+	void* _code = nullptr;
+	size_t _codeSize = 0;
+	Entry _scalar = nullptr;
+	Entry _block = nullptr;
+	std::vector<double> _constants;
+	// Each constant repeated for each lane.
+	std::vector<double> _wideConstants;
+	// Samples processed by each instruction of the block code, 4 with AVX.
+	uint _lanes = 1;
+	uint _argCount = 0;
+	uint _slotCount = 0;
+	uint _result = 0;
+};
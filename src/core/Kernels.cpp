@@ -0,0 +1,584 @@
+#include "core/Kernels.hpp"
+
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#	define KERNELS_X64
+#	include <immintrin.h>
+#	if defined(_MSC_VER) && !defined(__clang__)
+#		include <intrin.h>
+#		define AVX2_TARGET
+#	else
+#		define AVX2_TARGET __attribute__((target("avx2")))
+#	endif
+#endif
+
+namespace {
+
+	struct KernelSet {
+		std::unordered_map<Operator, Kernels::Unary> unaryOperators;
+		std::unordered_map<Operator, Kernels::Binary> binaryOperators;
+		std::unordered_map<std::string, Kernels::Unary> unaryFunctions;
+		std::unordered_map<std::string, Kernels::Binary> binaryFunctions;
+		std::unordered_map<std::string, Kernels::Ternary> ternaryFunctions;
+		std::string name;
+	};
+
+	// Scalar versions, identical to the evaluator operators and standard library functions.
+
+	double sIdentity(double x){ return x; }
+	double sNegate(double x){ return -x; }
+	double sBoolNot(double x){ return x != 0.0 ? 0.0 : 1.0; }
+	double sAdd(double a, double b){ return a + b; }
+	double sSubtract(double a, double b){ return a - b; }
+	double sProduct(double a, double b){ return a * b; }
+	double sDivide(double a, double b){ return a / b; }
+	double sPower(double a, double b){ return glm::pow(a, b); }
+	double sModulo(double a, double b){ return glm::mod(a, b); }
+	double sLessThan(double a, double b){ return a < b ? 1.0 : 0.0; }
+	double sGreaterThan(double a, double b){ return a > b ? 1.0 : 0.0; }
+	double sLessThanEqual(double a, double b){ return a <= b ? 1.0 : 0.0; }
+	double sGreaterThanEqual(double a, double b){ return a >= b ? 1.0 : 0.0; }
+	double sEqual(double a, double b){ return a == b ? 1.0 : 0.0; }
+	double sDifferent(double a, double b){ return a != b ? 1.0 : 0.0; }
+	double sBoolOr(double a, double b){ return (a != 0.0 || b != 0.0) ? 1.0 : 0.0; }
+	double sBoolAnd(double a, double b){ return (a != 0.0 && b != 0.0) ? 1.0 : 0.0; }
+	double sBoolXor(double a, double b){ return ((a != 0.0) != (b != 0.0)) ? 1.0 : 0.0; }
+
+	double sCos(double x){ return glm::cos(x); }
+	double sSin(double x){ return glm::sin(x); }
+	double sTan(double x){ return glm::tan(x); }
+	double sAcos(double x){ return glm::acos(x); }
+	double sAsin(double x){ return glm::asin(x); }
+	double sAtan(double x){ return glm::atan(x); }
+	double sExp(double x){ return glm::exp(x); }
+	double sLog(double x){ return glm::log(x); }
+	double sExp2(double x){ return glm::exp2(x); }
+	double sLog2(double x){ return glm::log2(x); }
+	double sSqrt(double x){ return glm::sqrt(x); }
+	double sFloor(double x){ return glm::floor(x); }
+	double sCeil(double x){ return glm::ceil(x); }
+	double sFract(double x){ return glm::fract(x); }
+	double sAbs(double x){ return glm::abs(x); }
+	double sInversesqrt(double x){ return glm::inversesqrt(x); }
+	double sRcp(double x){ return 1.0 / x; }
+	double sSign(double x){ return glm::sign(x); }
+	double sSaturate(double x){ return glm::clamp(x, 0.0, 1.0); }
+	double sRadians(double x){ return glm::radians(x); }
+	double sDegrees(double x){ return glm::degrees(x); }
+	double sSinh(double x){ return glm::sinh(x); }
+	double sCosh(double x){ return glm::cosh(x); }
+	double sTanh(double x){ return glm::tanh(x); }
+	double sAsinh(double x){ return glm::asinh(x); }
+	double sAcosh(double x){ return glm::acosh(x); }
+	double sAtanh(double x){ return glm::atanh(x); }
+	double sRound(double x){ return glm::round(x); }
+	double sTrunc(double x){ return glm::trunc(x); }
+
+	double sMin(double a, double b){ return glm::min(a, b); }
+	double sMax(double a, double b){ return glm::max(a, b); }
+	double sStep(double e, double x){ return glm::step(e, x); }
+	double sAtan2(double y, double x){ return glm::atan(y, x); }
+
+	double sClamp(double x, double a, double b){ return glm::clamp(x, a, b); }
+	double sMix(double x, double y, double t){ return glm::mix(x, y, t); }
+	double sSmoothstep(double e0, double e1, double x){ return glm::smoothstep(e0, e1, x); }
+
+	template<double (*S)(double)>
+	void scalarUnary(const double* x, double* out, size_t count){
+		for(size_t i = 0; i < count; ++i){
+			out[i] = S(x[i]);
+		}
+	}
+
+	template<double (*S)(double, double)>
+	void scalarBinary(const double* a, const double* b, double* out, size_t count){
+		for(size_t i = 0; i < count; ++i){
+			out[i] = S(a[i], b[i]);
+		}
+	}
+
+	template<double (*S)(double, double, double)>
+	void scalarTernary(const double* a, const double* b, const double* c, double* out, size_t count){
+		for(size_t i = 0; i < count; ++i){
+			out[i] = S(a[i], b[i], c[i]);
+		}
+	}
+
+	KernelSet scalarKernels(){
+		KernelSet set;
+		set.name = "scalar";
+		set.unaryOperators = {
+			{ Operator::Plus, &scalarUnary<sIdentity> },
+			{ Operator::Minus, &scalarUnary<sNegate> },
+			{ Operator::BoolNot, &scalarUnary<sBoolNot> },
+		};
+		set.binaryOperators = {
+			{ Operator::Plus, &scalarBinary<sAdd> },
+			{ Operator::Minus, &scalarBinary<sSubtract> },
+			{ Operator::Product, &scalarBinary<sProduct> },
+			{ Operator::Divide, &scalarBinary<sDivide> },
+			{ Operator::Power, &scalarBinary<sPower> },
+			{ Operator::Modulo, &scalarBinary<sModulo> },
+			{ Operator::LessThan, &scalarBinary<sLessThan> },
+			{ Operator::GreaterThan, &scalarBinary<sGreaterThan> },
+			{ Operator::LessThanEqual, &scalarBinary<sLessThanEqual> },
+			{ Operator::GreaterThanEqual, &scalarBinary<sGreaterThanEqual> },
+			{ Operator::Equal, &scalarBinary<sEqual> },
+			{ Operator::Different, &scalarBinary<sDifferent> },
+			{ Operator::BoolOr, &scalarBinary<sBoolOr> },
+			{ Operator::BoolAnd, &scalarBinary<sBoolAnd> },
+			{ Operator::BoolXor, &scalarBinary<sBoolXor> },
+		};
+		set.unaryFunctions = {
+			{ "cos", &scalarUnary<sCos> },
+			{ "sin", &scalarUnary<sSin> },
+			{ "tan", &scalarUnary<sTan> },
+			{ "acos", &scalarUnary<sAcos> },
+			{ "asin", &scalarUnary<sAsin> },
+			{ "atan", &scalarUnary<sAtan> },
+			{ "exp", &scalarUnary<sExp> },
+			{ "log", &scalarUnary<sLog> },
+			{ "exp2", &scalarUnary<sExp2> },
+			{ "log2", &scalarUnary<sLog2> },
+			{ "sqrt", &scalarUnary<sSqrt> },
+			{ "floor", &scalarUnary<sFloor> },
+			{ "ceil", &scalarUnary<sCeil> },
+			{ "fract", &scalarUnary<sFract> },
+			{ "frac", &scalarUnary<sFract> },
+			{ "abs", &scalarUnary<sAbs> },
+			{ "inversesqrt", &scalarUnary<sInversesqrt> },
+			{ "rcp", &scalarUnary<sRcp> },
+			{ "sign", &scalarUnary<sSign> },
+			{ "saturate", &scalarUnary<sSaturate> },
+			{ "radians", &scalarUnary<sRadians> },
+			{ "degrees", &scalarUnary<sDegrees> },
+			{ "sinh", &scalarUnary<sSinh> },
+			{ "cosh", &scalarUnary<sCosh> },
+			{ "tanh", &scalarUnary<sTanh> },
+			{ "asinh", &scalarUnary<sAsinh> },
+			{ "acosh", &scalarUnary<sAcosh> },
+			{ "atanh", &scalarUnary<sAtanh> },
+			{ "round", &scalarUnary<sRound> },
+			{ "trunc", &scalarUnary<sTrunc> },
+		};
+		set.binaryFunctions = {
+			{ "pow", &scalarBinary<sPower> },
+			{ "min", &scalarBinary<sMin> },
+			{ "max", &scalarBinary<sMax> },
+			{ "mod", &scalarBinary<sModulo> },
+			{ "step", &scalarBinary<sStep> },
+			{ "atan", &scalarBinary<sAtan2> },
+			{ "atan2", &scalarBinary<sAtan2> },
+		};
+		set.ternaryFunctions = {
+			{ "clamp", &scalarTernary<sClamp> },
+			{ "mix", &scalarTernary<sMix> },
+			{ "lerp", &scalarTernary<sMix> },
+			{ "smoothstep", &scalarTernary<sSmoothstep> },
+		};
+		return set;
+	}
+
+#ifdef KERNELS_X64
+
+	// AVX2 versions, processing four doubles at once. Arithmetic follows the exact same sequence of operations
+	// as the scalar versions (and avoids fused multiply-add) so that results are identical.
+	// Transcendental functions use polynomial approximations (from Cephes) and are accurate to a few ulps,
+	// lanes outside of their validity range fall back to the scalar version.
+
+	AVX2_TARGET inline __m256d vSet(double x){ return _mm256_set1_pd(x); }
+	AVX2_TARGET inline __m256d vAdd(__m256d a, __m256d b){ return _mm256_add_pd(a, b); }
+	AVX2_TARGET inline __m256d vSub(__m256d a, __m256d b){ return _mm256_sub_pd(a, b); }
+	AVX2_TARGET inline __m256d vMul(__m256d a, __m256d b){ return _mm256_mul_pd(a, b); }
+	AVX2_TARGET inline __m256d vDiv(__m256d a, __m256d b){ return _mm256_div_pd(a, b); }
+	AVX2_TARGET inline __m256d vFloor(__m256d x){ return _mm256_round_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+	AVX2_TARGET inline __m256d vCeil(__m256d x){ return _mm256_round_pd(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+	AVX2_TARGET inline __m256d vTrunc(__m256d x){ return _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+	// Select a where the mask is set, b elsewhere.
+	AVX2_TARGET inline __m256d vSelect(__m256d mask, __m256d a, __m256d b){ return _mm256_blendv_pd(b, a, mask); }
+	AVX2_TARGET inline __m256d vFromMask(__m256d mask){ return _mm256_and_pd(mask, vSet(1.0)); }
+	AVX2_TARGET inline __m256d vNonZero(__m256d x){ return _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NEQ_UQ); }
+	AVX2_TARGET inline __m256d vFlipSign(__m256d x){ return _mm256_xor_pd(x, vSet(-0.0)); }
+	// glm::min(a, b) is (b < a) ? b : a, and the min instruction returns its second operand if the first one is not smaller.
+	AVX2_TARGET inline __m256d vMin(__m256d a, __m256d b){ return _mm256_min_pd(b, a); }
+	AVX2_TARGET inline __m256d vMax(__m256d a, __m256d b){ return _mm256_max_pd(b, a); }
+
+	// Multiply by 2^n, for integer n in [-1022, 1023].
+	AVX2_TARGET inline __m256d vPow2(__m256d x, __m256d n){
+		const __m256i ni = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+		const __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(ni, _mm256_set1_epi64x(1023)), 52);
+		return vMul(x, _mm256_castsi256_pd(bits));
+	}
+
+	// Replace lanes outside of the valid mask by the scalar version.
+	template<double (*S)(double)>
+	AVX2_TARGET inline __m256d vFallback(__m256d x, __m256d res, __m256d valid){
+		const int validLanes = _mm256_movemask_pd(valid);
+		if(validLanes == 0xF){
+			return res;
+		}
+		alignas(32) double xs[4];
+		alignas(32) double rs[4];
+		_mm256_store_pd(xs, x);
+		_mm256_store_pd(rs, res);
+		for(int l = 0; l < 4; ++l){
+			if((validLanes & (1 << l)) == 0){
+				rs[l] = S(xs[l]);
+			}
+		}
+		return _mm256_load_pd(rs);
+	}
+
+	AVX2_TARGET __m256d vIdentity(__m256d x){ return x; }
+	AVX2_TARGET __m256d vNegate(__m256d x){ return vFlipSign(x); }
+	AVX2_TARGET __m256d vBoolNot(__m256d x){ return vFromMask(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ)); }
+	AVX2_TARGET __m256d vModulo(__m256d a, __m256d b){ return vSub(a, vMul(b, vFloor(vDiv(a, b)))); }
+	AVX2_TARGET __m256d vLessThan(__m256d a, __m256d b){ return vFromMask(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+	AVX2_TARGET __m256d vGreaterThan(__m256d a, __m256d b){ return vFromMask(_mm256_cmp_pd(a, b, _CMP_GT_OQ)); }
+	AVX2_TARGET __m256d vLessThanEqual(__m256d a, __m256d b){ return vFromMask(_mm256_cmp_pd(a, b, _CMP_LE_OQ)); }
+	AVX2_TARGET __m256d vGreaterThanEqual(__m256d a, __m256d b){ return vFromMask(_mm256_cmp_pd(a, b, _CMP_GE_OQ)); }
+	AVX2_TARGET __m256d vEqual(__m256d a, __m256d b){ return vFromMask(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+	AVX2_TARGET __m256d vDifferent(__m256d a, __m256d b){ return vFromMask(_mm256_cmp_pd(a, b, _CMP_NEQ_UQ)); }
+	AVX2_TARGET __m256d vBoolOr(__m256d a, __m256d b){ return vFromMask(_mm256_or_pd(vNonZero(a), vNonZero(b))); }
+	AVX2_TARGET __m256d vBoolAnd(__m256d a, __m256d b){ return vFromMask(_mm256_and_pd(vNonZero(a), vNonZero(b))); }
+	AVX2_TARGET __m256d vBoolXor(__m256d a, __m256d b){ return vFromMask(_mm256_xor_pd(vNonZero(a), vNonZero(b))); }
+
+	AVX2_TARGET __m256d vSqrt(__m256d x){ return _mm256_sqrt_pd(x); }
+	AVX2_TARGET __m256d vFract(__m256d x){ return vSub(x, vFloor(x)); }
+	AVX2_TARGET __m256d vInversesqrt(__m256d x){ return vDiv(vSet(1.0), _mm256_sqrt_pd(x)); }
+	AVX2_TARGET __m256d vRcp(__m256d x){ return vDiv(vSet(1.0), x); }
+	AVX2_TARGET __m256d vSaturate(__m256d x){ return vMin(vMax(x, _mm256_setzero_pd()), vSet(1.0)); }
+	AVX2_TARGET __m256d vRadians(__m256d x){ return vMul(x, vSet(static_cast<double>(0.01745329251994329576923690768489))); }
+	AVX2_TARGET __m256d vDegrees(__m256d x){ return vMul(x, vSet(static_cast<double>(57.295779513082320876798154814105))); }
+
+	AVX2_TARGET __m256d vAbs(__m256d x){
+		// Same as x >= 0 ? x : -x
+		return vSelect(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GE_OQ), x, vFlipSign(x));
+	}
+
+	AVX2_TARGET __m256d vSign(__m256d x){
+		const __m256d zero = _mm256_setzero_pd();
+		return vSub(vFromMask(_mm256_cmp_pd(zero, x, _CMP_LT_OQ)), vFromMask(_mm256_cmp_pd(x, zero, _CMP_LT_OQ)));
+	}
+
+	AVX2_TARGET __m256d vRound(__m256d x){
+		// Halfway cases are rounded away from zero.
+		const __m256d t = vTrunc(x);
+		const __m256d diff = vAbs(vSub(x, t));
+		const __m256d away = _mm256_or_pd(vSet(1.0), _mm256_and_pd(x, vSet(-0.0)));
+		return vSelect(_mm256_cmp_pd(diff, vSet(0.5), _CMP_GE_OQ), vAdd(t, away), t);
+	}
+
+	AVX2_TARGET __m256d vStep(__m256d e, __m256d x){
+		return vFromMask(_mm256_cmp_pd(x, e, _CMP_NLT_UQ));
+	}
+
+	AVX2_TARGET __m256d vClamp(__m256d x, __m256d a, __m256d b){
+		return vMin(vMax(x, a), b);
+	}
+
+	AVX2_TARGET __m256d vMix(__m256d x, __m256d y, __m256d t){
+		return vAdd(vMul(x, vSub(vSet(1.0), t)), vMul(y, t));
+	}
+
+	AVX2_TARGET __m256d vSmoothstep(__m256d e0, __m256d e1, __m256d x){
+		const __m256d t = vClamp(vDiv(vSub(x, e0), vSub(e1, e0)), _mm256_setzero_pd(), vSet(1.0));
+		return vMul(vMul(t, t), vSub(vSet(3.0), vMul(vSet(2.0), t)));
+	}
+
+	AVX2_TARGET __m256d vExp(__m256d x){
+		const __m256d xr = x;
+		const __m256d n = vFloor(vAdd(vMul(vSet(1.4426950408889634073599), x), vSet(0.5)));
+		x = vSub(x, vMul(n, vSet(6.93145751953125E-1)));
+		x = vSub(x, vMul(n, vSet(1.42860682030941723212E-6)));
+		const __m256d xx = vMul(x, x);
+		__m256d p = vAdd(vMul(vSet(1.26177193074810590878E-4), xx), vSet(3.02994407707441961300E-2));
+		p = vMul(x, vAdd(vMul(p, xx), vSet(9.99999999999999999910E-1)));
+		__m256d q = vAdd(vMul(vSet(3.00198505138664455042E-6), xx), vSet(2.52448340349684104192E-3));
+		q = vAdd(vMul(q, xx), vSet(2.27265548208155028766E-1));
+		q = vAdd(vMul(q, xx), vSet(2.00000000000000000009E0));
+		x = vDiv(p, vSub(q, p));
+		x = vAdd(vSet(1.0), vMul(vSet(2.0), x));
+		const __m256d res = vPow2(x, n);
+		const __m256d valid = _mm256_and_pd(_mm256_cmp_pd(xr, vSet(-7.08e2), _CMP_GE_OQ), _mm256_cmp_pd(xr, vSet(7.09e2), _CMP_LE_OQ));
+		return vFallback<sExp>(xr, res, valid);
+	}
+
+	AVX2_TARGET __m256d vLog(__m256d x){
+		const __m256d one = vSet(1.0);
+		const __m256d half = vSet(0.5);
+		// Decompose x = m * 2^e with m in [0.5, 1)
+		const __m256i bits = _mm256_castpd_si256(x);
+		const __m256i biased = _mm256_srli_epi64(bits, 52);
+		const __m256d magic = vSet(4503599627370496.0);
+		const __m256d e = vSub(vSub(_mm256_castsi256_pd(_mm256_or_si256(biased, _mm256_castpd_si256(magic))), magic), vSet(1022.0));
+		const __m256i mantissa = _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll));
+		const __m256d m = _mm256_castsi256_pd(_mm256_or_si256(mantissa, _mm256_set1_epi64x(0x3FE0000000000000ll)));
+		const __m256d small = _mm256_cmp_pd(m, vSet(0.70710678118654752440), _CMP_LT_OQ);
+		const __m256d ef = vSub(e, _mm256_and_pd(small, one));
+
+		// Large exponents.
+		__m256d zl = vSub(m, half);
+		zl = vSelect(small, zl, vSub(zl, half));
+		const __m256d yl = vSelect(small, vAdd(vMul(half, zl), half), vAdd(vMul(half, m), half));
+		const __m256d xl = vDiv(zl, yl);
+		const __m256d zzl = vMul(xl, xl);
+		__m256d r = vAdd(vMul(vSet(-7.89580278884799154124E-1), zzl), vSet(1.63866645699558079767E1));
+		r = vAdd(vMul(r, zzl), vSet(-6.41409952958715622951E1));
+		__m256d s = vAdd(zzl, vSet(-3.56722798256324312549E1));
+		s = vAdd(vMul(s, zzl), vSet(3.12093766372244180303E2));
+		s = vAdd(vMul(s, zzl), vSet(-7.69691943550460008604E2));
+		__m256d resl = vMul(xl, vDiv(vMul(zzl, r), s));
+		resl = vSub(resl, vMul(ef, vSet(2.121944400546905827679e-4)));
+		resl = vAdd(resl, xl);
+		resl = vAdd(resl, vMul(ef, vSet(0.693359375)));
+
+		// Small exponents.
+		const __m256d xs = vSelect(small, vSub(vAdd(m, m), one), vSub(m, one));
+		const __m256d zs = vMul(xs, xs);
+		__m256d p = vAdd(vMul(vSet(1.01875663804580931796E-4), xs), vSet(4.97494994976747001425E-1));
+		p = vAdd(vMul(p, xs), vSet(4.70579119878881725854E0));
+		p = vAdd(vMul(p, xs), vSet(1.44989225341610930846E1));
+		p = vAdd(vMul(p, xs), vSet(1.79368678507819816313E1));
+		p = vAdd(vMul(p, xs), vSet(7.70838733755885391666E0));
+		__m256d q = vAdd(xs, vSet(1.12873587189167450590E1));
+		q = vAdd(vMul(q, xs), vSet(4.52279145837532221105E1));
+		q = vAdd(vMul(q, xs), vSet(8.29875266912776603211E1));
+		q = vAdd(vMul(q, xs), vSet(7.11544750618563894466E1));
+		q = vAdd(vMul(q, xs), vSet(2.31251620126765340583E1));
+		__m256d ys = vMul(xs, vDiv(vMul(zs, p), q));
+		ys = vSub(ys, vMul(ef, vSet(2.121944400546905827679e-4)));
+		ys = vSub(ys, vMul(half, zs));
+		__m256d ress = vAdd(xs, ys);
+		ress = vAdd(ress, vMul(ef, vSet(0.693359375)));
+
+		const __m256d large = _mm256_cmp_pd(vAbs(e), vSet(2.0), _CMP_GT_OQ);
+		const __m256d res = vSelect(large, resl, ress);
+		// Zero, negative, denormal, infinite and NaN inputs.
+		const __m256d valid = _mm256_and_pd(_mm256_cmp_pd(x, vSet(2.2250738585072014e-308), _CMP_GE_OQ), _mm256_cmp_pd(x, vSet(1.7976931348623157e308), _CMP_LE_OQ));
+		return vFallback<sLog>(x, res, valid);
+	}
+
+	// Lanes whose reduced argument is too close to a zero of the result for the reduction precision are not valid.
+	AVX2_TARGET inline __m256d vSinCos(__m256d x, bool cosine, __m256d& valid){
+		const __m256d one = vSet(1.0);
+		const __m256d ax = _mm256_andnot_pd(vSet(-0.0), x);
+		// Octant of the input.
+		__m256d y = vFloor(vDiv(ax, vSet(7.85398163397448309616E-1)));
+		__m256d j = vSub(y, vMul(vSet(16.0), vFloor(vMul(y, vSet(0.0625)))));
+		const __m256d odd = vFromMask(_mm256_cmp_pd(vSub(j, vMul(vSet(2.0), vFloor(vMul(j, vSet(0.5))))), one, _CMP_EQ_OQ));
+		j = vAdd(j, odd);
+		y = vAdd(y, odd);
+		j = vSub(j, vMul(vSet(8.0), vFloor(vMul(j, vSet(0.125)))));
+		const __m256d upper = _mm256_cmp_pd(j, vSet(3.0), _CMP_GT_OQ);
+		j = vSub(j, _mm256_and_pd(upper, vSet(4.0)));
+		// j is now 0 or 2.
+		const __m256d second = _mm256_cmp_pd(j, vSet(2.0), _CMP_EQ_OQ);
+
+		// Extended precision reduction.
+		__m256d z = vSub(ax, vMul(y, vSet(7.85398125648498535156E-1)));
+		z = vSub(z, vMul(y, vSet(3.77489470793079817668E-8)));
+		z = vSub(z, vMul(y, vSet(2.69515142907905952645E-15)));
+		const __m256d zz = vMul(z, z);
+		// The reduction has an absolute error around 3e-31 * y, large relative to results close to zero.
+		valid = _mm256_and_pd(valid, _mm256_cmp_pd(vAbs(z), vMul(y, vSet(1.0e-13)), _CMP_GE_OQ));
+
+		__m256d c = vAdd(vMul(vSet(-1.13585365213876817300E-11), zz), vSet(2.08757008419747316778E-9));
+		c = vAdd(vMul(c, zz), vSet(-2.75573141792967388112E-7));
+		c = vAdd(vMul(c, zz), vSet(2.48015872888517045348E-5));
+		c = vAdd(vMul(c, zz), vSet(-1.38888888888730564116E-3));
+		c = vAdd(vMul(c, zz), vSet(4.16666666666665929218E-2));
+		const __m256d cosPoly = vAdd(vSub(one, vMul(zz, vSet(0.5))), vMul(vMul(zz, zz), c));
+
+		__m256d s = vAdd(vMul(vSet(1.58962301576546568060E-10), zz), vSet(-2.50507477628578072866E-8));
+		s = vAdd(vMul(s, zz), vSet(2.75573136213857245213E-6));
+		s = vAdd(vMul(s, zz), vSet(-1.98412698295895385996E-4));
+		s = vAdd(vMul(s, zz), vSet(8.33333333332211858878E-3));
+		s = vAdd(vMul(s, zz), vSet(-1.66666666666666307295E-1));
+		const __m256d sinPoly = vAdd(z, vMul(z, vMul(zz, s)));
+
+		__m256d res;
+		__m256d negate;
+		if(cosine){
+			res = vSelect(second, sinPoly, cosPoly);
+			negate = _mm256_xor_pd(upper, second);
+		} else {
+			res = vSelect(second, cosPoly, sinPoly);
+			negate = _mm256_xor_pd(upper, _mm256_and_pd(x, vSet(-0.0)));
+		}
+		res = vSelect(negate, vFlipSign(res), res);
+		return res;
+	}
+
+	AVX2_TARGET __m256d vSin(__m256d x){
+		__m256d valid = _mm256_cmp_pd(_mm256_andnot_pd(vSet(-0.0), x), vSet(1.0e6), _CMP_LE_OQ);
+		const __m256d res = vSinCos(x, false, valid);
+		return vFallback<sSin>(x, res, valid);
+	}
+
+	AVX2_TARGET __m256d vCos(__m256d x){
+		__m256d valid = _mm256_cmp_pd(_mm256_andnot_pd(vSet(-0.0), x), vSet(1.0e6), _CMP_LE_OQ);
+		const __m256d res = vSinCos(x, true, valid);
+		return vFallback<sCos>(x, res, valid);
+	}
+
+	template<__m256d (*V)(__m256d), double (*S)(double)>
+	AVX2_TARGET void vectorUnary(const double* x, double* out, size_t count){
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4){
+			_mm256_storeu_pd(out + i, V(_mm256_loadu_pd(x + i)));
+		}
+		for(; i < count; ++i){
+			out[i] = S(x[i]);
+		}
+	}
+
+	template<__m256d (*V)(__m256d, __m256d), double (*S)(double, double)>
+	AVX2_TARGET void vectorBinary(const double* a, const double* b, double* out, size_t count){
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4){
+			_mm256_storeu_pd(out + i, V(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+		}
+		for(; i < count; ++i){
+			out[i] = S(a[i], b[i]);
+		}
+	}
+
+	template<__m256d (*V)(__m256d, __m256d, __m256d), double (*S)(double, double, double)>
+	AVX2_TARGET void vectorTernary(const double* a, const double* b, const double* c, double* out, size_t count){
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4){
+			_mm256_storeu_pd(out + i, V(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _mm256_loadu_pd(c + i)));
+		}
+		for(; i < count; ++i){
+			out[i] = S(a[i], b[i], c[i]);
+		}
+	}
+
+	KernelSet avx2Kernels(){
+		// Start from the scalar versions for everything that is not vectorized.
+		KernelSet set = scalarKernels();
+		set.name = "AVX2";
+		set.unaryOperators[Operator::Plus] = &vectorUnary<vIdentity, sIdentity>;
+		set.unaryOperators[Operator::Minus] = &vectorUnary<vNegate, sNegate>;
+		set.unaryOperators[Operator::BoolNot] = &vectorUnary<vBoolNot, sBoolNot>;
+
+		set.binaryOperators[Operator::Plus] = &vectorBinary<vAdd, sAdd>;
+		set.binaryOperators[Operator::Minus] = &vectorBinary<vSub, sSubtract>;
+		set.binaryOperators[Operator::Product] = &vectorBinary<vMul, sProduct>;
+		set.binaryOperators[Operator::Divide] = &vectorBinary<vDiv, sDivide>;
+		set.binaryOperators[Operator::Modulo] = &vectorBinary<vModulo, sModulo>;
+		set.binaryOperators[Operator::LessThan] = &vectorBinary<vLessThan, sLessThan>;
+		set.binaryOperators[Operator::GreaterThan] = &vectorBinary<vGreaterThan, sGreaterThan>;
+		set.binaryOperators[Operator::LessThanEqual] = &vectorBinary<vLessThanEqual, sLessThanEqual>;
+		set.binaryOperators[Operator::GreaterThanEqual] = &vectorBinary<vGreaterThanEqual, sGreaterThanEqual>;
+		set.binaryOperators[Operator::Equal] = &vectorBinary<vEqual, sEqual>;
+		set.binaryOperators[Operator::Different] = &vectorBinary<vDifferent, sDifferent>;
+		set.binaryOperators[Operator::BoolOr] = &vectorBinary<vBoolOr, sBoolOr>;
+		set.binaryOperators[Operator::BoolAnd] = &vectorBinary<vBoolAnd, sBoolAnd>;
+		set.binaryOperators[Operator::BoolXor] = &vectorBinary<vBoolXor, sBoolXor>;
+
+		set.unaryFunctions["cos"] = &vectorUnary<vCos, sCos>;
+		set.unaryFunctions["sin"] = &vectorUnary<vSin, sSin>;
+		set.unaryFunctions["exp"] = &vectorUnary<vExp, sExp>;
+		set.unaryFunctions["log"] = &vectorUnary<vLog, sLog>;
+		set.unaryFunctions["sqrt"] = &vectorUnary<vSqrt, sSqrt>;
+		set.unaryFunctions["floor"] = &vectorUnary<vFloor, sFloor>;
+		set.unaryFunctions["ceil"] = &vectorUnary<vCeil, sCeil>;
+		set.unaryFunctions["fract"] = &vectorUnary<vFract, sFract>;
+		set.unaryFunctions["frac"] = &vectorUnary<vFract, sFract>;
+		set.unaryFunctions["abs"] = &vectorUnary<vAbs, sAbs>;
+		set.unaryFunctions["inversesqrt"] = &vectorUnary<vInversesqrt, sInversesqrt>;
+		set.unaryFunctions["rcp"] = &vectorUnary<vRcp, sRcp>;
+		set.unaryFunctions["sign"] = &vectorUnary<vSign, sSign>;
+		set.unaryFunctions["saturate"] = &vectorUnary<vSaturate, sSaturate>;
+		set.unaryFunctions["radians"] = &vectorUnary<vRadians, sRadians>;
+		set.unaryFunctions["degrees"] = &vectorUnary<vDegrees, sDegrees>;
+		set.unaryFunctions["round"] = &vectorUnary<vRound, sRound>;
+		set.unaryFunctions["trunc"] = &vectorUnary<vTrunc, sTrunc>;
+
+		set.binaryFunctions["min"] = &vectorBinary<vMin, sMin>;
+		set.binaryFunctions["max"] = &vectorBinary<vMax, sMax>;
+		set.binaryFunctions["mod"] = &vectorBinary<vModulo, sModulo>;
+		set.binaryFunctions["step"] = &vectorBinary<vStep, sStep>;
+
+		set.ternaryFunctions["clamp"] = &vectorTernary<vClamp, sClamp>;
+		set.ternaryFunctions["mix"] = &vectorTernary<vMix, sMix>;
+		set.ternaryFunctions["lerp"] = &vectorTernary<vMix, sMix>;
+		set.ternaryFunctions["smoothstep"] = &vectorTernary<vSmoothstep, sSmoothstep>;
+		return set;
+	}
+
+	bool supportsAVX2(){
+#if defined(_MSC_VER) && !defined(__clang__)
+		int infos[4];
+		__cpuid(infos, 0);
+		if(infos[0] < 7){
+			return false;
+		}
+		// AVX support, including saving the registers by the OS.
+		__cpuid(infos, 1);
+		const bool osxsave = (infos[2] & (1 << 27)) != 0;
+		const bool avx = (infos[2] & (1 << 28)) != 0;
+		if(!osxsave || !avx || ((_xgetbv(0) & 0x6) != 0x6)){
+			return false;
+		}
+		__cpuidex(infos, 7, 0);
+		return (infos[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+#endif
+
+	const KernelSet& kernels(Kernels::Target target = Kernels::Target::BEST){
+		if(target == Kernels::Target::SCALAR){
+			static const KernelSet scalarSet = scalarKernels();
+			return scalarSet;
+		}
+#ifdef KERNELS_X64
+		static const KernelSet set = supportsAVX2() ? avx2Kernels() : scalarKernels();
+#else
+		static const KernelSet set = scalarKernels();
+#endif
+		return set;
+	}
+
+	template<typename T, typename K>
+	T find(const std::unordered_map<K, T>& table, const K& key){
+		const auto it = table.find(key);
+		return it != table.end() ? it->second : nullptr;
+	}
+
+}
+
+Kernels::Unary Kernels::unaryOperator(Operator op, Target target){
+	return find(kernels(target).unaryOperators, op);
+}
+
+Kernels::Binary Kernels::binaryOperator(Operator op, Target target){
+	return find(kernels(target).binaryOperators, op);
+}
+
+Kernels::Unary Kernels::unaryFunction(const std::string& name, Target target){
+	return find(kernels(target).unaryFunctions, name);
+}
+
+Kernels::Binary Kernels::binaryFunction(const std::string& name, Target target){
+	return find(kernels(target).binaryFunctions, name);
+}
+
+Kernels::Ternary Kernels::ternaryFunction(const std::string& name, Target target){
+	return find(kernels(target).ternaryFunctions, name);
+}
+
+const std::string& Kernels::instructionSet(){
+	return kernels().name;
+}
+
+bool Kernels::usesAVX2(){
+	return kernels().name == "AVX2";
+}
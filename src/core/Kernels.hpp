@@ -0,0 +1,33 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Types.hpp"
+
+/** Element-wise operations on arrays of doubles, used by the batch evaluation. Booleans are stored as 0.0 or 1.0.
+ Vectorized implementations are selected at runtime depending on the CPU features, with a scalar fallback. */
+class Kernels {
+public:
+
+	using Unary = void (*)(const double* x, double* out, size_t count);
+	using Binary = void (*)(const double* a, const double* b, double* out, size_t count);
+	using Ternary = void (*)(const double* a, const double* b, const double* c, double* out, size_t count);
+
+	// Fastest implementations supported by the CPU, or scalar fallback only.
+	enum class Target {
+		BEST, SCALAR
+	};
+
+	// Operators, nullptr if not supported on floats.
+	static Unary unaryOperator(Operator op, Target target = Target::BEST);
+	static Binary binaryOperator(Operator op, Target target = Target::BEST);
+
+	// Standard library functions with float arguments, nullptr if not available.
+	static Unary unaryFunction(const std::string& name, Target target = Target::BEST);
+	static Binary binaryFunction(const std::string& name, Target target = Target::BEST);
+	static Ternary ternaryFunction(const std::string& name, Target target = Target::BEST);
+
+	static const std::string& instructionSet();
+
+	// Whether the AVX2 kernels are used.
+	static bool usesAVX2();
+
+};
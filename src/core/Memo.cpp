@@ -0,0 +1,128 @@
+#include "core/Memo.hpp"
+
+#include <cstring>
+
+namespace {
+
+	size_t hashBytes(const void* data, size_t size, size_t hash){
+		// FNV-1a
+		const uchar* bytes = static_cast<const uchar*>(data);
+		for(size_t i = 0; i < size; ++i){
+			hash = (hash ^ bytes[i]) * size_t(1099511628211ull);
+		}
+		return hash;
+	}
+
+	// Values are compared bit by bit, to distinguish -0.0 and 0.0 and to match NaNs.
+	const void* payload(const Value& value, size_t& size){
+		switch(value.type){
+			case Value::BOOL:
+				size = sizeof(bool);
+				return &value.b;
+			case Value::INTEGER:
+				size = sizeof(long long);
+				return &value.i;
+			case Value::FLOAT:
+				size = sizeof(double);
+				return &value.f;
+			case Value::VEC3:
+				size = sizeof(glm::vec3);
+				return &value.v3();
+			case Value::VEC4:
+				size = sizeof(glm::vec4);
+				return &value.v4();
+			case Value::MAT3:
+				size = sizeof(glm::mat3);
+				return &value.m3();
+			case Value::MAT4:
+				size = sizeof(glm::mat4);
+				return &value.m4();
+			default:
+				break;
+		}
+		const std::string& str = value.str();
+		size = str.size();
+		return str.data();
+	}
+
+}
+
+size_t FunctionMemo::KeyHash::operator()(const Key& key) const {
+	size_t hash = size_t(14695981039346656037ull);
+	for(size_t aid = 0; aid < key.count; ++aid){
+		const Value& arg = key.args[aid];
+		const uchar type = uchar(arg.type);
+		hash = hashBytes(&type, 1, hash);
+		size_t size = 0;
+		const void* data = payload(arg, size);
+		hash = hashBytes(data, size, hash);
+	}
+	return hash;
+}
+
+bool FunctionMemo::KeyEqual::operator()(const Key& a, const Key& b) const {
+	if(a.count != b.count){
+		return false;
+	}
+	for(size_t aid = 0; aid < a.count; ++aid){
+		if(a.args[aid].type != b.args[aid].type){
+			return false;
+		}
+		size_t sizeA = 0;
+		size_t sizeB = 0;
+		const void* dataA = payload(a.args[aid], sizeA);
+		const void* dataB = payload(b.args[aid], sizeB);
+		if(sizeA != sizeB || std::memcmp(dataA, dataB, sizeA) != 0){
+			return false;
+		}
+	}
+	return true;
+}
+
+FunctionMemo::FunctionMemo(size_t capacity) : _capacity(capacity) {
+}
+
+bool FunctionMemo::find(const Value* args, size_t count, Value& result){
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto it = _index.find({ args, count });
+	if(it == _index.end()){
+		++_misses;
+		return false;
+	}
+	++_hits;
+	_entries.splice(_entries.begin(), _entries, it->second);
+	result = it->second->result;
+	return true;
+}
+
+void FunctionMemo::insert(const Value* args, size_t count, const Value& result){
+	if(_capacity == 0){
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Another thread might have computed the same result.
+	const auto it = _index.find({ args, count });
+	if(it != _index.end()){
+		_entries.splice(_entries.begin(), _entries, it->second);
+		return;
+	}
+	if(_entries.size() >= _capacity){
+		const Entry& last = _entries.back();
+		_index.erase({ last.args.data(), last.args.size() });
+		_entries.pop_back();
+	}
+	_entries.push_front({ std::vector<Value>(args, args + count), result });
+	const Entry& entry = _entries.front();
+	_index[{ entry.args.data(), entry.args.size() }] = _entries.begin();
+}
+
+void FunctionMemo::clear(){
+	std::lock_guard<std::mutex> lock(_mutex);
+	_index.clear();
+	_entries.clear();
+}
+
+size_t FunctionMemo::size() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries.size();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Types.hpp"
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+/** Bounded cache of the results of a user function for given arguments. User functions are pure,
+ so results stay valid until a function is redefined. The least recently used entry is evicted when full. */
+class FunctionMemo {
+public:
+
+	explicit FunctionMemo(size_t capacity);
+
+	// Returns false if the result for these arguments is not known.
+	bool find(const Value* args, size_t count, Value& result);
+
+	void insert(const Value* args, size_t count, const Value& result);
+
+	void clear();
+
+	size_t capacity() const { return _capacity; }
+	size_t size() const;
+	size_t hits() const { return _hits; }
+	size_t misses() const { return _misses; }
+
+private:
+
+	struct Entry {
+		std::vector<Value> args;
+		Value result;
+	};
+
+	// Arguments of an entry, or of a lookup.
+	struct Key {
+		const Value* args;
+		size_t count;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	struct KeyEqual {
+		bool operator()(const Key& a, const Key& b) const;
+	};
+
+	using Entries = std::list<Entry>;
+
+	// Most recently used first, keys point to the arguments stored in the entries.
+	Entries _entries;
+	std::unordered_map<Key, Entries::iterator, KeyHash, KeyEqual> _index;
+	mutable std::mutex _mutex;
+	const size_t _capacity;
+	std::atomic<size_t> _hits{0};
+	std::atomic<size_t> _misses{0};
+};
@@ -45,8 +45,9 @@
 
 #define EXIT_IF_FAILED(a) if(a == nullptr){ _failedToken = _failed ? _failedToken : _position; _failed = true; return nullptr;}
 #define EXIT(message) if(true){ if(!_failed){ _failedToken = _position; _failedMessage = message; _failed = true; };  return nullptr; }
+#define GROW(height) if(!grow(height)){ EXIT("Expression is too deeply nested"); }
 
-Parser::Parser(const std::vector<Token>& tokens) : _tokens(tokens), _tree(nullptr), _position(0), _tokenCount(long(tokens.size())) {
+Parser::Parser(const std::vector<Token>& tokens) : _tokens(tokens), _arena(new Arena()), _tree(nullptr), _position(0), _tokenCount(long(tokens.size())) {
 
 }
 
@@ -95,6 +96,12 @@ bool Parser::match(std::initializer_list<Operator> ops) {
 	return false;
 }
 
+bool Parser::grow(long& height){
+	height = std::max(height, _height) + 1;
+	_height = height;
+	return height <= MAX_HEIGHT;
+}
+
 void Parser::advance(){
 	++_position;
 }
@@ -141,7 +148,7 @@ Parser::Result Parser::statement(){
 			// Parse the rest of the line.
 			Result expr = expression();
 			EXIT_IF_FAILED(expr);
-			return Expression::Ptr(new VariableDef(name, expr, position));
+			return _arena->make<VariableDef>(name, expr, position);
 		}
 
 		if(match(Operator::OpenParenth)){
@@ -155,7 +162,7 @@ Parser::Result Parser::statement(){
 				// Parse the rest of the line.
 				Result expr = expression();
 				EXIT_IF_FAILED(expr);
-				return Expression::Ptr(new FunctionDef(name, {}, expr, position));
+				return _arena->make<FunctionDef>(name, std::vector<std::string>(), expr, position);
 			}
 
 			// Else parse arguments
@@ -182,7 +189,7 @@ Parser::Result Parser::statement(){
 			Result expr = expression();
 			EXIT_IF_FAILED(expr);
 			
-			return Expression::Ptr(new FunctionDef(name, arguments, expr, position));
+			return _arena->make<FunctionDef>(name, arguments, expr, position);
 
 		}
 		// Else impossible
@@ -194,12 +201,20 @@ Parser::Result Parser::statement(){
 }
 
 Parser::Result Parser::expression(){
-	return ternary();
+	// Each nested expression recurses through all precedence levels.
+	if(++_nesting > MAX_NESTING){
+		EXIT("Expression is too deeply nested");
+	}
+	Result root = ternary();
+	EXIT_IF_FAILED(root);
+	--_nesting;
+	return root;
 }
 
 Parser::Result Parser::ternary(){
 	Result condition = boolOr();
 	EXIT_IF_FAILED(condition);
+	long height = _height;
 
 	// "?", or just an expression.
 	if(!match(Operator::QuestionMark)){
@@ -208,6 +223,7 @@ Parser::Result Parser::ternary(){
 
 	Result pass = boolOr();
 	EXIT_IF_FAILED(pass);
+	height = std::max(height, _height);
 
 	// ":"
 	if(!match(Operator::Colon)){
@@ -217,8 +233,9 @@ Parser::Result Parser::ternary(){
 
 	Result fail = boolOr();
 	EXIT_IF_FAILED(fail);
+	GROW(height);
 
-	Expression::Ptr root = std::make_shared<Ternary>(condition, pass, fail, condition->dbgStartPos, fail->dbgEndPos);
+	Expression::Ptr root = _arena->make<Ternary>(condition, pass, fail, condition->dbgStartPos, fail->dbgEndPos);
 	return root;
 }
 
@@ -226,12 +243,14 @@ Parser::Result Parser::boolOr(){
 	Result left = boolXor();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::BoolOr)){
 		Result right = boolXor();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::BoolOr, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::BoolOr, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -240,12 +259,14 @@ Parser::Result Parser::boolXor(){
 	Result left = boolAnd();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::BoolXor)){
 		Result right = boolAnd();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::BoolXor, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::BoolXor, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -254,12 +275,14 @@ Parser::Result Parser::boolAnd(){
 	Result left = bitOr();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::BoolAnd)){
 		Result right = bitOr();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::BoolAnd, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::BoolAnd, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -268,12 +291,14 @@ Parser::Result Parser::bitOr(){
 	Result left = bitXor();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::BitOr)){
 		Result right = bitXor();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::BitOr, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::BitOr, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -282,12 +307,14 @@ Parser::Result Parser::bitXor(){
 	Result left = bitAnd();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::BitXor)){
 		Result right = bitAnd();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::BitXor, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::BitXor, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -296,12 +323,14 @@ Parser::Result Parser::bitAnd(){
 	Result left = equality();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::BitAnd)){
 		Result right = equality();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::BitAnd, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::BitAnd, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -310,13 +339,15 @@ Parser::Result Parser::equality(){
 	Result left = comparison();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match({Operator::Equal, Operator::Different})){
 		const Operator op = previousOp();
 		Result right = comparison();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -325,13 +356,15 @@ Parser::Result Parser::comparison(){
 	Result left = bitshift();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match({Operator::GreaterThan, Operator::GreaterThanEqual, Operator::LessThan, Operator::LessThanEqual})){
 		const Operator op = previousOp();
 		Result right = bitshift();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -340,13 +373,15 @@ Parser::Result Parser::bitshift(){
 	Result left = term();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match({Operator::ShiftLeft, Operator::ShiftRight})){
 		const Operator op = previousOp();
 		Result right = term();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -355,13 +390,15 @@ Parser::Result Parser::term(){
 	Result left = factor();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match({Operator::Plus, Operator::Minus})){
 		const Operator op = previousOp();
 		Result right = factor();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -370,40 +407,48 @@ Parser::Result Parser::factor(){
 	Result left = unary();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match({Operator::Product, Operator::Divide, Operator::Modulo})){
 		const Operator op = previousOp();
 		Result right = unary();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(op, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
 
 Parser::Result Parser::unary(){
-	const long position = _position;
-	if(match({Operator::BitNot, Operator::BoolNot, Operator::Plus, Operator::Minus})){
-		const Operator op = previousOp();
-		Result right = unary();
-		EXIT_IF_FAILED(right);
-
-		return Expression::Ptr(new Unary(op, right, position, right->dbgEndPos));
+	// Prefix operators are collected first, to avoid recursing on each of them.
+	std::vector<long> positions;
+	while(match({Operator::BitNot, Operator::BoolNot, Operator::Plus, Operator::Minus})){
+		positions.push_back(_position - 1);
 	}
+	Result root = power();
+	EXIT_IF_FAILED(root);
 
-	return power();
+	long height = _height;
+	for(auto position = positions.rbegin(); position != positions.rend(); ++position){
+		GROW(height);
+		root = _arena->make<Unary>(_tokens[*position].opVal, root, *position, root->dbgEndPos);
+	}
+	return root;
 }
 
 Parser::Result Parser::power(){
 	Result left = member();
 	EXIT_IF_FAILED(left);
 
+	long height = _height;
 	Expression::Ptr root = left;
 	while(match(Operator::Power)){
 		Result right = member();
 		EXIT_IF_FAILED(right);
+		GROW(height);
 
-		root = std::make_shared<Binary>(Operator::Power, root, right, left->dbgStartPos, right->dbgEndPos);
+		root = _arena->make<Binary>(Operator::Power, root, right, left->dbgStartPos, right->dbgEndPos);
 	}
 	return root;
 }
@@ -412,6 +457,7 @@ Parser::Result Parser::member(){
 	Result parent = terminal();
 	EXIT_IF_FAILED(parent);
 
+	long height = _height;
 	Expression::Ptr root = parent;
 	while(match(Operator::Dot)){
 		if(!valid()){
@@ -424,7 +470,8 @@ Parser::Result Parser::member(){
 		}
 		const long position = _position;
 		advance();
-		root = std::make_shared<Member>(root, member.sVal, position);
+		GROW(height);
+		root = _arena->make<Member>(root, member.sVal, position);
 	}
 	return root;
 }
@@ -438,12 +485,14 @@ Parser::Result Parser::terminal(){
 	const long position = _position;
 	if(current.type == Token::Type::Float){
 		advance();
-		return Expression::Ptr(new Literal(Value(current.fVal), position));
+		_height = 1;
+		return _arena->make<Literal>(Value(current.fVal), position);
 	}
 	if(current.type == Token::Type::Integer){
 		advance();
+		_height = 1;
 		// For now, just store as float.
-		return Expression::Ptr(new Literal(Value(current.iVal), position));
+		return _arena->make<Literal>(Value(current.iVal), position);
 	}
 	if(current.type == Token::Type::Identifier){
 		advance();
@@ -451,29 +500,34 @@ Parser::Result Parser::terminal(){
 		if(match(Operator::OpenParenth)){
 			if(match(Operator::CloseParenth)){
 				// No arguments.
-				return Expression::Ptr(new FunctionCall(current.sVal, {}, position, position));
+				_height = 1;
+				return _arena->make<FunctionCall>(current.sVal, std::vector<Expression::Ptr>(), position, position);
 			}
 
 			// Else parse arguments
 			std::vector<Expression::Ptr> arguments;
+			long height = 0;
 			do {
 				Result arg = expression();
 				EXIT_IF_FAILED(arg);
 				arguments.push_back(arg);
+				height = std::max(height, _height);
 			} while(match(Operator::Comma));
+			GROW(height);
 
 			const long endPosition = _position;
 			if(!match(Operator::CloseParenth)){
 				EXIT("Unexpected character, expected parenthesis");
 			}
 
-			return Expression::Ptr(new FunctionCall(current.sVal, arguments, position, endPosition));
+			return _arena->make<FunctionCall>(current.sVal, arguments, position, endPosition);
 		} else {
 			// Simple variable.
+			_height = 1;
 			if(_parsingFunctionDeclaration){
-				return Expression::Ptr(new FunctionVar(current.sVal, position));
+				return _arena->make<FunctionVar>(current.sVal, position);
 			} else {
-				return Expression::Ptr(new Variable(current.sVal, position));
+				return _arena->make<Variable>(current.sVal, position);
 			}
 		}
 	}
@@ -494,6 +548,8 @@ Parser::Result Parser::terminal(){
 Status Parser::parse(){
 	_tree = nullptr;
 	_parsingFunctionDeclaration = false;
+	_height = 0;
+	_nesting = 0;
 
 	Result res = statement();
 	if(res != nullptr){
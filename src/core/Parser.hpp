@@ -11,12 +11,18 @@ public:
 
 	Status parse();
 
-	const Expression::Ptr& tree() const {
-		return _tree;
+	// The returned pointer keeps all nodes of the tree alive.
+	std::shared_ptr<Expression> tree() const {
+		return std::shared_ptr<Expression>(_arena, _tree);
 	}
 
 private:
 
+	// The parser and the tree visitors are recursive, deeper inputs are rejected.
+	// Height of the tree, and nesting of parentheses and calls.
+	static constexpr long MAX_HEIGHT = 512;
+	static constexpr long MAX_NESTING = 128;
+
 	bool valid() const;
 
 	bool expect(Operator op) const;
@@ -25,6 +31,9 @@ private:
 
 	bool match(std::initializer_list<Operator> ops);
 
+	// Height of a node whose highest child so far has the given height, including the last parsed child.
+	bool grow(long& height);
+
 	void advance();
 
 	const Token& peek() const;
@@ -57,11 +66,15 @@ private:
 
 
 	std::vector<Token> _tokens;
+	std::shared_ptr<Arena> _arena;
 	Expression::Ptr _tree;
 	std::string _failedMessage;
 	long _position;
 	long _tokenCount;
 	long _failedToken = -1;
+	// Height of the last parsed subtree.
+	long _height = 0;
+	long _nesting = 0;
 	bool _failed = false;
 	bool _parsingFunctionDeclaration = false;
 };
@@ -0,0 +1,331 @@
+#include "core/Program.hpp"
+#include "core/Evaluator.hpp"
+#include "core/Memo.hpp"
+
+bool Swizzle::parse(const std::string& member, Swizzle& swizzle){
+	if(member.size() > 4){
+		return false;
+	}
+	swizzle.size = uchar(member.size());
+	for(size_t cid = 0; cid < member.size(); ++cid){
+		switch(member[cid]){
+			case 'x': swizzle.indices[cid] = 0; break;
+			case 'y': swizzle.indices[cid] = 1; break;
+			case 'z': swizzle.indices[cid] = 2; break;
+			case 'w': swizzle.indices[cid] = 3; break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+void Program::link(const Scope& scope, const FunctionsLibrary& stdlib){
+	for(Callee& callee : _callees){
+		callee.function = nullptr;
+		callee.builtin = nullptr;
+		// Calls with an incorrect number of arguments are left unresolved, to report the error when executed.
+		const uint argCount = callee.argCount;
+		if(scope.hasFunc(callee.name)){
+			const FunctionDef* def = scope.getFunc(callee.name).get();
+			if(def->args.size() == argCount){
+				callee.function = def;
+			}
+			continue;
+		}
+		const FunctionsLibrary::FunctionInfos* builtin = stdlib.find(callee.name);
+		if(builtin && stdlib.validArgCount(*builtin, argCount)){
+			callee.builtin = builtin;
+		}
+	}
+	for(Subscript& subscript : _subscripts){
+		subscript.valid = Swizzle::parse(subscript.member, subscript.swizzle);
+	}
+}
+
+const Specialization* Program::specialization(const Value::Type* argTypes, ExpEval& evaluator) const {
+	if(_argCount > MAX_SPECIALIZED_ARGS){
+		return nullptr;
+	}
+	// Three bits per argument type.
+	uint64_t signature = 0u;
+	for(uint aid = 0; aid < _argCount; ++aid){
+		signature |= uint64_t(argTypes[aid]) << (3u * aid);
+	}
+	{
+		std::lock_guard<std::mutex> lock(_specializationsMutex);
+		const auto existing = _specializations.find(signature);
+		if(existing != _specializations.end()){
+			return existing->second.get();
+		}
+		// Recursive calls will use the generic version while the specialization is built.
+		_specializations[signature] = nullptr;
+	}
+	std::unique_ptr<const Specialization> specialization = FuncSpecializer::specialize(*this, argTypes, evaluator);
+	std::lock_guard<std::mutex> lock(_specializationsMutex);
+	std::unique_ptr<const Specialization>& slot = _specializations[signature];
+	slot = std::move(specialization);
+	return slot.get();
+}
+
+Value VirtualMachine::run(const Program& program, FunctionMemo* memo, const Value* args, ExpEval& evaluator){
+	// Allocate a new frame on top of the current one.
+	const size_t base = _registers.size();
+	_registers.resize(base + program._registerCount);
+	for(uint aid = 0; aid < program._argCount; ++aid){
+		_registers[base + aid] = args[aid];
+	}
+	const Value result = enter(program, memo, base, evaluator);
+	_registers.resize(base);
+	return result;
+}
+
+Value VirtualMachine::enter(const Program& program, FunctionMemo* memo, size_t base, ExpEval& evaluator){
+	const Specialization* specialization = nullptr;
+	if(program._argCount <= Program::MAX_SPECIALIZED_ARGS){
+		Value::Type argTypes[Program::MAX_SPECIALIZED_ARGS];
+		for(uint aid = 0; aid < program._argCount; ++aid){
+			argTypes[aid] = _registers[base + aid].type;
+		}
+		specialization = program.specialization(argTypes, evaluator);
+	}
+	// Native code is cheaper than a memo lookup.
+	if(specialization && specialization->native){
+		return runNative(*specialization->native, base);
+	}
+	// Argument registers are never written, they are still valid after execution.
+	Value result;
+	if(memo && memo->find(_registers.data() + base, program._argCount, result)){
+		return result;
+	}
+	if(specialization && specialization->registerCount > program._registerCount){
+		_registers.resize(base + specialization->registerCount);
+	}
+	const uint baseChanges = evaluator.baseChanges();
+	if(!execute(program, specialization, base, evaluator, result)){
+		// Unexpected type, fall back to the generic version.
+		execute(program, nullptr, base, evaluator, result);
+	}
+	// Changing the display base is a side effect that can't be cached.
+	if(memo && !evaluator.hasFailed() && evaluator.baseChanges() == baseChanges){
+		memo->insert(_registers.data() + base, program._argCount, result);
+	}
+	return result;
+}
+
+Value VirtualMachine::runNative(const JitFunction& native, size_t base) const {
+	double args[Program::MAX_SPECIALIZED_ARGS];
+	for(uint aid = 0; aid < native.argCount(); ++aid){
+		args[aid] = _registers[base + aid].f;
+	}
+	return native.run(args);
+}
+
+bool VirtualMachine::execute(const Program& program, const Specialization* specialization, size_t base, ExpEval& evaluator, Value& result){
+
+	const std::vector<Instruction>& instructions = specialization ? specialization->instructions : program._instructions;
+	const std::vector<Value>& constants = specialization ? specialization->constants : program._constants;
+
+	// Nested calls can reallocate the registers, always access them through the frame base.
+	auto fetch = [this, base, &constants](uint operand) -> const Value& {
+		if(operand & Instruction::CONSTANT_FLAG){
+			return constants[operand & ~Instruction::CONSTANT_FLAG];
+		}
+		return _registers[base + operand];
+	};
+
+	const size_t instructionCount = instructions.size();
+	size_t pc = 0;
+	while(pc < instructionCount && !evaluator.hasFailed()){
+		const Instruction& ins = instructions[pc];
+		++pc;
+
+		switch(ins.code){
+			case Instruction::Code::UNARY:
+				_registers[base + ins.dst] = evaluator.applyUnary(ins.op, fetch(ins.a));
+				break;
+			case Instruction::Code::BINARY:
+				_registers[base + ins.dst] = evaluator.applyBinary(ins.op, fetch(ins.a), fetch(ins.b));
+				break;
+			case Instruction::Code::MEMBER:
+			{
+				const Program::Subscript& subscript = program._subscripts[ins.c];
+				if(subscript.valid){
+					_registers[base + ins.dst] = evaluator.applySwizzle(fetch(ins.a), subscript.swizzle, subscript.member, nullptr);
+				} else {
+					_registers[base + ins.dst] = evaluator.applyMember(fetch(ins.a), subscript.member, nullptr);
+				}
+				break;
+			}
+			case Instruction::Code::CALL:
+			{
+				const Program::Callee& callee = program._callees[ins.c];
+				// Compiled user functions are executed directly in a new frame.
+				if(callee.function && callee.function->program){
+					const Program& calleeProgram = *callee.function->program;
+					const size_t calleeBase = _registers.size();
+					_registers.resize(calleeBase + calleeProgram._registerCount);
+					for(uint aid = 0; aid < ins.b; ++aid){
+						_registers[calleeBase + aid] = fetch(program._operands[ins.a + aid]);
+					}
+					const Value res = enter(calleeProgram, callee.function->memo.get(), calleeBase, evaluator);
+					_registers.resize(calleeBase);
+					_registers[base + ins.dst] = res;
+					break;
+				}
+				if(_arguments.size() <= _depth){
+					_arguments.resize(_depth + 1);
+				}
+				std::vector<Value>& callArgs = _arguments[_depth];
+				callArgs.resize(ins.b);
+				for(uint aid = 0; aid < ins.b; ++aid){
+					callArgs[aid] = fetch(program._operands[ins.a + aid]);
+				}
+				// The evaluator can run other programs on this machine.
+				++_depth;
+				const Value res = evaluator.callFunction(callee, callArgs);
+				--_depth;
+				_registers[base + ins.dst] = res;
+				break;
+			}
+			case Instruction::Code::MOVE:
+				_registers[base + ins.dst] = fetch(ins.a);
+				break;
+			case Instruction::Code::JUMP:
+				pc = ins.b;
+				break;
+			case Instruction::Code::JUMP_IF_FALSE:
+			{
+				Value condBool;
+				if(!fetch(ins.a).convert(Value::BOOL, condBool)){
+					evaluator.registerError("Condition could not be converted to a boolean.", nullptr);
+					break;
+				}
+				if(!condBool.b){
+					pc = ins.b;
+				}
+				break;
+			}
+			case Instruction::Code::FLOAT_UNARY:
+				// Only negation.
+				_registers[base + ins.dst] = -fetch(ins.a).f;
+				break;
+			case Instruction::Code::INTEGER_UNARY:
+				_registers[base + ins.dst] = -fetch(ins.a).i;
+				break;
+			case Instruction::Code::BOOL_UNARY:
+				_registers[base + ins.dst] = !fetch(ins.a).b;
+				break;
+			case Instruction::Code::FLOAT_BINARY:
+			{
+				const double l = fetch(ins.a).f;
+				const double r = fetch(ins.b).f;
+				Value& dst = _registers[base + ins.dst];
+				switch(ins.op){
+					case Operator::Plus:				dst = l + r; break;
+					case Operator::Minus:				dst = l - r; break;
+					case Operator::Product:				dst = l * r; break;
+					case Operator::Divide:				dst = l / r; break;
+					case Operator::Power:				dst = glm::pow(l, r); break;
+					case Operator::Modulo:				dst = glm::mod(l, r); break;
+					case Operator::LessThan:			dst = l < r; break;
+					case Operator::GreaterThan:			dst = l > r; break;
+					case Operator::LessThanEqual:		dst = l <= r; break;
+					case Operator::GreaterThanEqual:	dst = l >= r; break;
+					case Operator::Equal:				dst = l == r; break;
+					case Operator::Different:			dst = l != r; break;
+					default:
+						assert(false);
+						break;
+				}
+				break;
+			}
+			case Instruction::Code::INTEGER_BINARY:
+			{
+				const long long l = fetch(ins.a).i;
+				const long long r = fetch(ins.b).i;
+				Value& dst = _registers[base + ins.dst];
+				switch(ins.op){
+					case Operator::Plus:				dst = l + r; break;
+					case Operator::Minus:				dst = l - r; break;
+					case Operator::Product:				dst = l * r; break;
+					case Operator::LessThan:			dst = l < r; break;
+					case Operator::GreaterThan:			dst = l > r; break;
+					case Operator::LessThanEqual:		dst = l <= r; break;
+					case Operator::GreaterThanEqual:	dst = l >= r; break;
+					case Operator::Equal:				dst = l == r; break;
+					case Operator::Different:			dst = l != r; break;
+					default:
+						assert(false);
+						break;
+				}
+				break;
+			}
+			case Instruction::Code::BOOL_BINARY:
+			{
+				const bool l = fetch(ins.a).b;
+				const bool r = fetch(ins.b).b;
+				Value& dst = _registers[base + ins.dst];
+				switch(ins.op){
+					case Operator::BoolOr:		dst = l || r; break;
+					case Operator::BoolAnd:		dst = l && r; break;
+					case Operator::BoolXor:		dst = l != r; break;
+					case Operator::Equal:		dst = l == r; break;
+					case Operator::Different:	dst = l != r; break;
+					default:
+						assert(false);
+						break;
+				}
+				break;
+			}
+			case Instruction::Code::CONVERT:
+			{
+				Value converted;
+				fetch(ins.a).convert(Value::Type(ins.b), converted);
+				_registers[base + ins.dst] = converted;
+				break;
+			}
+			case Instruction::Code::CALL_SPECIALIZED:
+			{
+				const Specialization::Call& call = specialization->calls[ins.c];
+				const size_t calleeBase = _registers.size();
+				_registers.resize(calleeBase + call.specialization->registerCount);
+				for(uint aid = 0; aid < ins.b; ++aid){
+					_registers[calleeBase + aid] = fetch(program._operands[ins.a + aid]);
+				}
+				Value res;
+				FunctionMemo* memo = call.function->memo.get();
+				if(call.specialization->native){
+					res = runNative(*call.specialization->native, calleeBase);
+				} else if(!(memo && memo->find(_registers.data() + calleeBase, ins.b, res))){
+					const uint baseChanges = evaluator.baseChanges();
+					if(!execute(*call.program, call.specialization, calleeBase, evaluator, res)){
+						execute(*call.program, nullptr, calleeBase, evaluator, res);
+					}
+					if(memo && !evaluator.hasFailed() && evaluator.baseChanges() == baseChanges){
+						memo->insert(_registers.data() + calleeBase, ins.b, res);
+					}
+					// The following instructions rely on the type of the result.
+					if(!evaluator.hasFailed() && call.specialization->resultKnown && res.type != call.specialization->result){
+						_registers.resize(calleeBase);
+						return false;
+					}
+				}
+				_registers.resize(calleeBase);
+				_registers[base + ins.dst] = res;
+				break;
+			}
+			case Instruction::Code::CHECK_TYPE:
+				if(fetch(ins.a).type != Value::Type(ins.b)){
+					return false;
+				}
+				break;
+			default:
+				assert(false);
+				break;
+		}
+	}
+
+	result = evaluator.hasFailed() ? Value(false) : fetch(program._result);
+	return true;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Types.hpp"
+#include "core/Functions.hpp"
+#include "core/Jit.hpp"
+
+#include <deque>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+class ExpEval;
+
+struct Instruction {
+
+	enum class Code : uchar {
+		UNARY,			// dst = op a
+		BINARY,			// dst = a op b
+		MEMBER,			// dst = a.subscripts[c]
+		CALL,			// dst = callees[c](operands[a], ..., operands[a+b-1])
+		MOVE,			// dst = a
+		JUMP,			// pc = b
+		JUMP_IF_FALSE,	// if(!a) pc = b
+		// Only in specializations, operands have the type of the instruction.
+		FLOAT_UNARY,	// dst = op a
+		FLOAT_BINARY,	// dst = a op b
+		INTEGER_UNARY,	// dst = op a
+		INTEGER_BINARY,	// dst = a op b
+		BOOL_UNARY,		// dst = op a
+		BOOL_BINARY,	// dst = a op b
+		CONVERT,		// dst = convert a to type b
+		CALL_SPECIALIZED, // dst = calls[c](operands[a], ..., operands[a+b-1])
+		CHECK_TYPE		// abort the specialization if a is not of type b
+	};
+
+	// Operands with this flag refer to the program constants instead of the frame registers.
+	static const uint CONSTANT_FLAG = 1u << 31u;
+
+	Code code;
+	Operator op;
+	uint dst;
+	uint a;
+	uint b;
+	uint c;
+};
+
+/** Components selected by a vector subscript, such as 'xy' or 'zzw'. */
+struct Swizzle {
+
+	// Returns false if the subscript contains unknown components or is too long.
+	static bool parse(const std::string& member, Swizzle& swizzle);
+
+	uchar size = 0;
+	uchar indices[4] = {0, 0, 0, 0};
+};
+
+class Program;
+
+/** Version of a program for a given signature of argument types, where the type of each register
+ has been inferred. Operations on scalars are replaced by typed instructions without conversions. */
+struct Specialization {
+
+	struct Call {
+		const FunctionDef* function;
+		const Program* program;
+		const Specialization* specialization;
+	};
+
+	std::vector<Instruction> instructions;
+	// Program constants, followed by converted constants.
+	std::vector<Value> constants;
+	std::vector<Call> calls;
+	uint registerCount = 0;
+	// Type of the result, if known.
+	Value::Type result = Value::STRING;
+	bool resultKnown = false;
+	// Native code when all arguments are floats, if possible.
+	std::unique_ptr<const JitFunction> native;
+};
+
+/** Register-based bytecode for a function expression. The first registers of a frame receive the function arguments. */
+class Program {
+public:
+
+	/** Function called by an instruction, resolved when linking. */
+	struct Callee {
+		std::string name;
+		uint argCount = 0;
+		// User functions have priority over the standard library.
+		const FunctionDef* function = nullptr;
+		const FunctionsLibrary::FunctionInfos* builtin = nullptr;
+	};
+
+	struct Subscript {
+		std::string member;
+		Swizzle swizzle;
+		bool valid = false;
+	};
+
+	// Functions with more arguments are never specialized.
+	static constexpr uint MAX_SPECIALIZED_ARGS = 16;
+
+	uint argCount() const { return _argCount; }
+	uint registerCount() const { return _registerCount; }
+	const std::vector<Callee>& callees() const { return _callees; }
+
+	// Resolve callees and subscripts. Callees point to the functions currently defined in the scope,
+	// programs have to be linked again when functions are (re)defined.
+	void link(const Scope& scope, const FunctionsLibrary& stdlib);
+
+	// Version specialized for the argument types, built on first use. Returns nullptr if not available.
+	const Specialization* specialization(const Value::Type* argTypes, ExpEval& evaluator) const;
+
+private:
+
+	std::vector<Instruction> _instructions;
+	std::vector<Value> _constants;
+	std::vector<Callee> _callees;
+	std::vector<Subscript> _subscripts;
+	std::vector<uint> _operands;
+	uint _argCount = 0;
+	uint _registerCount = 0;
+	uint _result = 0;
+
+	// Specializations for each signature of argument types, nullptr while being built or if not possible.
+	mutable std::unordered_map<uint64_t, std::unique_ptr<const Specialization>> _specializations;
+	mutable std::mutex _specializationsMutex;
+
+	friend class FuncCompiler;
+	friend class FuncSpecializer;
+	friend class VirtualMachine;
+	friend class BatchMachine;
+	friend class JitFunction;
+};
+
+class VirtualMachine {
+public:
+
+	// Results are cached in the memo if not null.
+	Value run(const Program& program, FunctionMemo* memo, const Value* args, ExpEval& evaluator);
+
+private:
+
+	// Execute a program on the frame starting at base, arguments already set, using a specialization if possible.
+	Value enter(const Program& program, FunctionMemo* memo, size_t base, ExpEval& evaluator);
+
+	// Execute native code, arguments are all floats.
+	Value runNative(const JitFunction& native, size_t base) const;
+
+	// Execute the program or one of its specializations. Returns false if a specialization met an unexpected type.
+	bool execute(const Program& program, const Specialization* specialization, size_t base, ExpEval& evaluator, Value& result);
+
+	// Frames of all nested calls, stacked.
+	std::vector<Value> _registers;
+	// Arguments of standard library calls for each depth, reused to avoid allocations.
+	std::deque<std::vector<Value>> _arguments;
+	size_t _depth = 0;
+};
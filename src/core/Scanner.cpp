@@ -56,14 +56,146 @@ bool Scanner::isIdentifierCharAt(long pos) const {
 
 Status Scanner::scan(){
 	_tokens.clear();
-	long position = 0;
-	long firstErrorPosition = -1;
+	_errors.clear();
+	lex(0, nullptr, { 0, 0, 0 });
 
-	if(_input.empty()){
-		return Status(true);
+	_words.resize(_tokens.size());
+	classify(0, _tokens.size());
+	return status();
+}
+
+Status Scanner::scan(const Scanner& previous, const Edit& edit){
+	assert(previous._inputSize - edit.removedSize + edit.insertedSize == _inputSize);
+	const std::vector<Token>& oldTokens = previous._tokens;
+	const size_t oldCount = oldTokens.size();
+
+	// A token ending right before the edit might be extended, and the scanner looks one character past a token.
+	size_t first = 0;
+	while(first < oldCount && oldTokens[first].location + oldTokens[first].size < edit.start){
+		++first;
+	}
+	const long restart = first == 0 ? 0 : (oldTokens[first - 1].location + oldTokens[first - 1].size);
+
+	_tokens.assign(oldTokens.begin(), oldTokens.begin() + first);
+	_errors.clear();
+	for(const long error : previous._errors){
+		if(error < restart){
+			_errors.push_back(error);
+		}
+	}
+	const size_t reused = lex(restart, &previous, edit);
+	const size_t count = _tokens.size() - first - reused;
+	const size_t oldChangedCount = oldCount - first - reused;
+
+	// Words depend on the previous token (operators) and the next one (identifiers).
+	const size_t firstWord = first == 0 ? 0 : first - 1;
+	const size_t lastWord = std::min(first + count + 1, _tokens.size());
+	const size_t oldLastWord = std::min(first + oldChangedCount + 1, oldCount);
+	_words.resize(_tokens.size());
+	std::copy(previous._words.begin(), previous._words.begin() + firstWord, _words.begin());
+	const long shift = edit.insertedSize - edit.removedSize;
+	for(size_t wid = lastWord, oldWid = oldLastWord; wid < _words.size(); ++wid, ++oldWid){
+		_words[wid] = previous._words[oldWid];
+		_words[wid].location += shift;
+	}
+	classify(firstWord, lastWord);
+	return status();
+}
+
+Scanner::Edit Scanner::difference(const std::string& before, const std::string& after){
+	const size_t minSize = std::min(before.size(), after.size());
+	size_t prefix = 0;
+	while(prefix < minSize && before[prefix] == after[prefix]){
+		++prefix;
+	}
+	size_t suffix = 0;
+	while(suffix < minSize - prefix && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]){
+		++suffix;
+	}
+	return { long(prefix), long(before.size() - prefix - suffix), long(after.size() - prefix - suffix) };
+}
+
+Status Scanner::status() const {
+	if(!_errors.empty()){
+		return Status(_errors.back(), "Syntax");
+	}
+	return Status(true);
+}
+
+void Scanner::classify(size_t first, size_t last){
+	const size_t tokenCount = _tokens.size();
+	for(size_t tid = first; tid < last; ++tid){
+
+		const Token& token = _tokens[tid];
+		Word& word = _words[tid];
+		switch(token.type){
+			case Token::Type::Operator:
+			{
+				// Special cases: ( ) , . and unary (operator following an operator or at beginning of line)
+				const bool isSeparator = token.opVal == Operator::OpenParenth || token.opVal == Operator::CloseParenth || token.opVal == Operator::Comma || token.opVal == Operator::Dot;
+				const bool followOperator = tid == 0 || (_tokens[tid-1].type == Token::Type::Operator && _tokens[tid-1].opVal != Operator::CloseParenth);
+				word.type = (isSeparator || followOperator) ? Word::SEPARATOR : Word::OPERATOR;
+				break;
+			}
+			case Token::Type::Identifier:
+			{
+				// If followed by a parenthesis, function. Otherwise, variable.
+				if(tid + 1 < tokenCount && _tokens[tid+1].type == Token::Type::Operator && _tokens[tid+1].opVal == Operator::OpenParenth){
+					word.type =  Word::FUNCTION;
+				} else {
+					word.type =  Word::VARIABLE;
+				}
+				break;
+			}
+			case Token::Type::Float:
+			case Token::Type::Integer:
+			default:
+				word.type = Word::LITERAL;
+			break;
+		}
+		word.location = token.location;
+		word.size = token.size;
+	}
+}
+
+size_t Scanner::lex(long position, const Scanner* previous, const Edit& edit){
+	// Previous tokens after the edit, shifted to the new input.
+	size_t candidate = 0;
+	const long shift = edit.insertedSize - edit.removedSize;
+	if(previous){
+		const long editEnd = edit.start + edit.removedSize;
+		while(candidate < previous->_tokens.size() && previous->_tokens[candidate].location < editEnd){
+			++candidate;
+		}
 	}
 
 	while(valid(position)){
+
+		// Once a previous token is reached in the same state, the rest of the input will be scanned identically.
+		if(previous){
+			const std::vector<Token>& oldTokens = previous->_tokens;
+			while(candidate < oldTokens.size() && oldTokens[candidate].location + shift < position){
+				++candidate;
+			}
+			if(candidate < oldTokens.size() && oldTokens[candidate].location + shift == position){
+				const bool wasMember = candidate != 0 && oldTokens[candidate - 1].type == Token::Type::Identifier;
+				const bool isMember = !_tokens.empty() && (_tokens.back().type == Token::Type::Identifier);
+				if(wasMember == isMember){
+					const long oldLocation = oldTokens[candidate].location;
+					for(size_t tid = candidate; tid < oldTokens.size(); ++tid){
+						_tokens.push_back(oldTokens[tid]);
+						_tokens.back().location += shift;
+					}
+					for(const long error : previous->_errors){
+						if(error >= oldLocation){
+							_errors.push_back(error + shift);
+						}
+					}
+					return oldTokens.size() - candidate;
+				}
+			}
+		}
+
 		const char c0 = at(position);
 		// Skip whitespace.
 		if(std::isspace(c0) || c0 == ';'){
@@ -172,7 +304,7 @@ Status Scanner::scan(){
 					_tokens.back().size = long(tokenSize);
 				}
 			} catch(...) {
-				firstErrorPosition = startPosition;
+				_errors.push_back(startPosition);
 			}
 			continue;
 		}
@@ -356,13 +488,8 @@ Status Scanner::scan(){
 		}
 
 		// Error.
-		firstErrorPosition = position;
+		_errors.push_back(position);
 		++position;
 	}
-
-	if(firstErrorPosition >= 0){
-		return Status(firstErrorPosition, "Syntax");
-	}
-
-	return Status(true);
+	return 0;
 }
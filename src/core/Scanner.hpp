@@ -22,20 +22,61 @@ struct Token {
 	long size;
 };
 
+/// Classification of a token for syntax highlighting.
+struct Word {
+	enum Type {
+		LITERAL = 0, VARIABLE, FUNCTION, OPERATOR, SEPARATOR, RESULT, COUNT
+	};
+
+	Type type;
+	long location;
+	long size;
+};
 
 class Scanner {
 public:
 
+	/// Replacement of removedSize characters at start by insertedSize characters.
+	struct Edit {
+		long start;
+		long removedSize;
+		long insertedSize;
+	};
+
 	Scanner(const std::string& input);
 
 	Status scan();
 
+	// Scan an edited version of the input of a previous scanner. Tokens before and after the edit are reused,
+	// only the edited span is scanned again.
+	Status scan(const Scanner& previous, const Edit& edit);
+
+	// Smallest edit transforming before into after.
+	static Edit difference(const std::string& before, const std::string& after);
+
+	const std::string& input() const {
+		return _input;
+	}
+
 	const std::vector<Token>& tokens() const {
 		return _tokens;
 	}
 
+	const std::vector<Word>& words() const {
+		return _words;
+	}
+
 private:
 
+	// Scan from position until the end of the input, or until the suffix of the previous tokens can be reused.
+	// Returns the number of reused tokens.
+	size_t lex(long position, const Scanner* previous, const Edit& edit);
+
+	// Classify tokens in [first, last).
+	void classify(size_t first, size_t last);
+
+	Status status() const;
+
 	char at(long pos) const;
 
 	bool valid(long pos) const;
@@ -53,4 +94,7 @@ private:
 	std::string _input;
 	long _inputSize;
 	std::vector<Token> _tokens;
+	std::vector<Word> _words;
+	// Positions of all errors.
+	std::vector<long> _errors;
 };
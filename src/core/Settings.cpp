@@ -27,6 +27,36 @@ CalcoConfig::CalcoConfig(const std::vector<std::string> & argv) : Config(argv) {
 			historyPath = arg.values[0];
 		}
 
+		if(arg.key == "script" && !arg.values.empty()){
+			scriptPath = arg.values[0];
+		}
+		if(arg.key == "no-save"){
+			noSave = true;
+		}
+		if(arg.key == "serve" && !arg.values.empty()){
+			servePath = arg.values[0];
+		}
+		if(arg.key == "connect" && !arg.values.empty()){
+			connectPath = arg.values[0];
+		}
+
+		// Sampling mode, only if requested first.
+		if(arg.key == "sample" && arg.values.size() == 1 && &arg == &arguments()[0]){
+			sampleFunction = arg.values[0];
+		}
+		if(arg.key == "from" && !arg.values.empty()){
+			sampleFrom = arg.values;
+		}
+		if(arg.key == "to" && !arg.values.empty()){
+			sampleTo = arg.values;
+		}
+		if(arg.key == "count" && !arg.values.empty()){
+			sampleCount = arg.values;
+		}
+		if(arg.key == "format" && !arg.values.empty()){
+			sampleFormat = arg.values[0];
+		}
+
 		if(arg.key == "version" || arg.key == "v") {
 			version = true;
 		}
@@ -44,6 +74,19 @@ CalcoConfig::CalcoConfig(const std::vector<std::string> & argv) : Config(argv) {
 	registerArgument("settings", "s", "Path to display settings (or use CALCO_SETTINGS environment variable)", "file path");
 	registerArgument("history", "h", "Path to a history file (or use CALCO_HISTORY environment variable)", "file path");
 
+	registerSection("Evaluation");
+	registerArgument("script", "", "Evaluate the statements of a file, one per line, instead of the command line", "file path|-");
+	registerArgument("no-save", "", "Don't save the state after evaluation");
+	registerArgument("serve", "", "Keep the state in memory and answer JSON requests on a local socket, one per line", "socket path");
+	registerArgument("connect", "", "Evaluate the command line with a running server", "socket path");
+
+	registerSection("Sampling");
+	registerArgument("sample", "", "Sample a function of one or two arguments on a grid, instead of evaluating an expression", "function");
+	registerArgument("from", "", "Start of the grid on each axis (default -1)", std::vector<std::string>{ "x", "y" });
+	registerArgument("to", "", "End of the grid on each axis (default 1)", std::vector<std::string>{ "x", "y" });
+	registerArgument("count", "", "Samples on each axis (default 100)", std::vector<std::string>{ "x", "y" });
+	registerArgument("format", "", "csv: one line per sample with its coordinates, bin: values only, as 64-bit floats", "csv|bin");
+
 	registerSection("Infos");
 	registerArgument("version", "v", "Displays the current Calco version.");
 	registerArgument("license", "", "Display the license message.");
@@ -10,6 +10,21 @@ public:
 	std::string historyPath;
 	std::string settingsPath;
 
+	// Statements to evaluate one per line, "-" for the standard input.
+	std::string scriptPath;
+	bool noSave = false;
+
+	// Socket to serve requests on, or to send the command line to.
+	std::string servePath;
+	std::string connectPath;
+
+	// Sampling of a function on a regular grid, bounds and counts are expressions, one per axis.
+	std::string sampleFunction;
+	std::vector<std::string> sampleFrom = { "-1" };
+	std::vector<std::string> sampleTo = { "1" };
+	std::vector<std::string> sampleCount = { "100" };
+	std::string sampleFormat = "csv";
+
 	// Messages.
 	bool version = false;
 	bool license = false;
@@ -0,0 +1,153 @@
+#include "core/ThreadPool.hpp"
+
+namespace {
+
+	// Pool and queue of the current thread, if it is a worker.
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local uint currentWorker = 0;
+
+}
+
+ThreadPool::ThreadPool(uint threadCount){
+#ifdef __EMSCRIPTEN__
+	// No threads available, tasks are executed immediately.
+	(void)threadCount;
+#else
+	if(threadCount == 0){
+		// Threads waiting for tasks also execute them.
+		const uint hardwareCount = std::thread::hardware_concurrency();
+		threadCount = hardwareCount > 1 ? hardwareCount - 1 : 1;
+	}
+	_workers.reserve(threadCount);
+	for(uint wid = 0; wid < threadCount; ++wid){
+		_workers.emplace_back(new Worker());
+	}
+	// Start threads once all queues exist, as they can steal from each other.
+	for(uint wid = 0; wid < threadCount; ++wid){
+		_workers[wid]->thread = std::thread(&ThreadPool::run, this, wid);
+	}
+#endif
+}
+
+ThreadPool::~ThreadPool(){
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for(auto& worker : _workers){
+		worker->thread.join();
+	}
+}
+
+void ThreadPool::submit(Task task){
+	if(_workers.empty()){
+		task();
+		return;
+	}
+	// Workers keep their own tasks, others are spread over all queues.
+	const uint index = currentPool == this ? currentWorker : (_next++ % threadCount());
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_queued;
+	}
+	{
+		Worker& worker = *_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	_wake.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task){
+	if(count == 0){
+		return;
+	}
+	if(_workers.empty() || count == 1){
+		for(size_t tid = 0; tid < count; ++tid){
+			task(tid);
+		}
+		return;
+	}
+
+	std::mutex doneMutex;
+	std::condition_variable done;
+	size_t remaining = count;
+	auto runTask = [&task, &doneMutex, &done, &remaining](size_t tid){
+		task(tid);
+		// Notify while locked, the waiting thread could otherwise return and destroy the condition first.
+		std::lock_guard<std::mutex> lock(doneMutex);
+		if(--remaining == 0){
+			done.notify_all();
+		}
+	};
+	for(size_t tid = 1; tid < count; ++tid){
+		submit([&runTask, tid](){ runTask(tid); });
+	}
+	runTask(0);
+
+	// Help with queued tasks, ours or not, until all calls are done.
+	const uint index = currentPool == this ? currentWorker : threadCount();
+	while(true){
+		{
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if(remaining == 0){
+				return;
+			}
+		}
+		if(!runPending(index)){
+			break;
+		}
+	}
+	// The last calls are running on other threads.
+	std::unique_lock<std::mutex> lock(doneMutex);
+	done.wait(lock, [&remaining](){ return remaining == 0; });
+}
+
+void ThreadPool::run(uint index){
+	currentPool = this;
+	currentWorker = index;
+	while(true){
+		if(runPending(index)){
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_wake.wait(lock, [this](){ return _stop || _queued != 0; });
+		// Remaining tasks are executed before stopping.
+		if(_stop && _queued == 0){
+			return;
+		}
+	}
+}
+
+bool ThreadPool::runPending(uint index){
+	const uint count = threadCount();
+	Task task;
+	bool found = false;
+	// Most recent task of our own queue first, for locality.
+	if(index < count){
+		Worker& worker = *_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if(!worker.tasks.empty()){
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			found = true;
+		}
+	}
+	// Else steal the oldest task of another queue.
+	for(uint offset = 1; !found && offset <= count; ++offset){
+		Worker& other = *_workers[(index + offset) % count];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		if(!other.tasks.empty()){
+			task = std::move(other.tasks.front());
+			other.tasks.pop_front();
+			found = true;
+		}
+	}
+	if(!found){
+		return false;
+	}
+	--_queued;
+	task();
+	return true;
+}
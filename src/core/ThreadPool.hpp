@@ -0,0 +1,54 @@
+#pragma once
+#include "core/Common.hpp"
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+/** Fixed set of worker threads executing tasks. Each worker has its own queue: tasks submitted by a worker are
+ added to its queue and executed last in first out, idle workers steal the oldest tasks from the other queues.
+ Threads waiting for tasks to complete help executing queued tasks, so that parallel loops can be nested. */
+class ThreadPool {
+public:
+
+	using Task = std::function<void()>;
+
+	// Use as many threads as the hardware supports by default.
+	explicit ThreadPool(uint threadCount = 0);
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool();
+
+	void submit(Task task);
+
+	// Call task(i) for i in [0, count), returns once all calls are done.
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	uint threadCount() const { return uint(_workers.size()); }
+
+private:
+
+	struct Worker {
+		std::deque<Task> tasks;
+		std::mutex mutex;
+		std::thread thread;
+	};
+
+	void run(uint index);
+
+	// Execute one queued task, from the given worker queue first, returns false if all queues were empty.
+	bool runPending(uint index);
+
+	std::vector<std::unique_ptr<Worker>> _workers;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	// Tasks in all queues.
+	std::atomic<size_t> _queued{0};
+	std::atomic<uint> _next{0};
+	bool _stop = false;
+};
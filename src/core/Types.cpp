@@ -1,5 +1,101 @@
 #include "core/Types.hpp"
 
+namespace {
+
+	// Released blocks of the current thread, reused to avoid allocations.
+	struct FreeBlocks {
+		void* head = nullptr;
+		uint count = 0;
+		bool closed = false;
+	};
+	// Kept trivially destructible, so that values released after the cleanup below can check it.
+	thread_local FreeBlocks freeBlocks;
+
+	struct FreeBlocksCleaner {
+		~FreeBlocksCleaner(){
+			while(freeBlocks.head){
+				void* next = *static_cast<void**>(freeBlocks.head);
+				::operator delete(freeBlocks.head);
+				freeBlocks.head = next;
+			}
+			freeBlocks.count = 0;
+			freeBlocks.closed = true;
+		}
+	};
+	thread_local FreeBlocksCleaner freeBlocksCleaner;
+
+	const uint MAX_FREE_BLOCKS = 1024;
+}
+
+Value::Value(const std::string& val) : type(STRING) {
+	Text* text = new Text();
+	text->str = val;
+	_shared = text;
+}
+
+Value::Value(const glm::vec3& val) : type(VEC3) {
+	Block* block = createBlock();
+	block->v3 = val;
+	_shared = block;
+}
+
+Value::Value(const glm::vec4& val) : type(VEC4) {
+	Block* block = createBlock();
+	block->v4 = val;
+	_shared = block;
+}
+
+Value::Value(const glm::mat3& val) : type(MAT3) {
+	Block* block = createBlock();
+	block->m3 = val;
+	_shared = block;
+}
+
+Value::Value(const glm::mat4& val) : type(MAT4) {
+	Block* block = createBlock();
+	block->m4 = val;
+	_shared = block;
+}
+
+const std::string& Value::str() const {
+	static const std::string empty = "empty";
+	static const std::string none = "";
+	if(type != STRING){
+		return none;
+	}
+	return _shared ? static_cast<const Text*>(_shared)->str : empty;
+}
+
+Value::Block* Value::createBlock(){
+	void* memory = freeBlocks.head;
+	if(memory){
+		freeBlocks.head = *static_cast<void**>(memory);
+		--freeBlocks.count;
+	} else {
+		// Ensure the cleaner is registered for this thread.
+		(void)freeBlocksCleaner;
+		memory = ::operator new(sizeof(Block));
+	}
+	return new (memory) Block();
+}
+
+void Value::destroy(){
+	if(type == STRING){
+		delete static_cast<Text*>(_shared);
+		return;
+	}
+	Block* block = static_cast<Block*>(_shared);
+	block->~Block();
+	void* memory = block;
+	if(freeBlocks.closed || freeBlocks.count >= MAX_FREE_BLOCKS){
+		::operator delete(memory);
+		return;
+	}
+	*static_cast<void**>(memory) = freeBlocks.head;
+	freeBlocks.head = memory;
+	++freeBlocks.count;
+}
+
 std::string Value::toString(Format format) const {
 	const bool internal = format == Format::INTERNAL;
 	const bool rowMajor = (format & Format::MAJOR_MASK) == Format::MAJOR_ROW_FLAG;
@@ -43,7 +139,7 @@ std::string Value::toString(Format format) const {
 		{
 			std::string ms = internal ? "vec3( " : "| ";
 			for(int cid = 0; cid < 3; ++cid){
-				ms.append(std::to_string(v3[cid]));
+				ms.append(std::to_string(v3()[cid]));
 				if(cid < 2){
 					ms.append(", ");
 				}
@@ -55,7 +151,7 @@ std::string Value::toString(Format format) const {
 		{
 			std::string ms = internal ? "vec4( " : "| ";
 			for(int cid = 0; cid < 4; ++cid){
-				ms.append(std::to_string(v4[cid]));
+				ms.append(std::to_string(v4()[cid]));
 				if(cid < 3){
 					ms.append(", ");
 				}
@@ -70,7 +166,7 @@ std::string Value::toString(Format format) const {
 			for(int cid = 0; cid < 3; ++cid){
 
 				for(int cjd = 0; cjd < 3; ++cjd){
-					const float val = rowMajor ? m3[cjd][cid] : m3[cid][cjd];
+					const float val = rowMajor ? m3()[cjd][cid] : m3()[cid][cjd];
 					ms.append(std::to_string(val));
 					if(cjd < 2){
 						ms.append(", ");
@@ -92,7 +188,7 @@ std::string Value::toString(Format format) const {
 			for(int cid = 0; cid < 4; ++cid){
 
 				for(int cjd = 0; cjd < 4; ++cjd){
-					const float val = rowMajor ? m4[cjd][cid] : m4[cid][cjd];
+					const float val = rowMajor ? m4()[cjd][cid] : m4()[cid][cjd];
 					ms.append(std::to_string(val));
 					if(cjd < 3){
 						ms.append(", ");
@@ -272,3 +368,22 @@ Status Expression::evaluate(TreeVisitor& visitor, Value& outValue){
 	outValue = evaluate(visitor);
 	return visitor.getStatus();
 }
+
+Arena::~Arena(){
+	// Release nodes in reverse order of creation.
+	for(auto node = _nodes.rbegin(); node != _nodes.rend(); ++node){
+		(*node)->~Expression();
+	}
+}
+
+void* Arena::allocate(size_t size, size_t alignment){
+	size_t start = (_offset + alignment - 1) & ~(alignment - 1);
+	if(_chunks.empty() || start + size > _capacity){
+		_capacity = std::max(size, CHUNK_SIZE);
+		// Chunks are allocated with the maximal fundamental alignment.
+		_chunks.emplace_back(new char[_capacity]);
+		start = 0;
+	}
+	_offset = start + size;
+	return _chunks.back().get() + start;
+}
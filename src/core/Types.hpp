@@ -1,6 +1,8 @@
 #pragma once
 #include "core/Common.hpp"
 #include <unordered_map>
+#include <atomic>
+#include <new>
 
 enum Format : uint {
 	// Use 3 bits for flags
@@ -55,6 +57,9 @@ struct Status {
 	}
 };
 
+/** Tagged value. Scalars are stored inline, vectors, matrices and strings are stored out-of-line in
+ immutable reference-counted blocks, shared between copies. This keeps values small (16 bytes) and
+ cheap to copy for the common scalar case. */
 struct Value {
 
 	enum Type {
@@ -68,39 +73,117 @@ struct Value {
 		STRING
 	};
 
-	Value() : type(STRING), str("empty"){}
+	// Empty string, without allocation.
+	Value() : type(STRING), _shared(nullptr){}
 
-	Value(bool val) : type(BOOL), b(val){}
+	Value(bool val) : type(BOOL), i(0){ b = val; }
 
 	Value(long long val) : type(INTEGER), i(val){}
 
 	Value(double val) : type(FLOAT), f(val){}
 
-	Value(const std::string& val) : type(STRING), str(val){}
-	
-	Value(const glm::vec3& val) : type(VEC3), v3(val){}
+	Value(const std::string& val);
+
+	Value(const glm::vec3& val);
+
+	Value(const glm::vec4& val);
+
+	Value(const glm::mat3& val);
+
+	Value(const glm::mat4& val);
+
+	Value(const Value& other) : type(other.type), i(other.i) {
+		retain();
+	}
+
+	Value(Value&& other) noexcept : type(other.type), i(other.i) {
+		other.type = BOOL;
+	}
 
-	Value(const glm::vec4& val) : type(VEC4), v4(val){}
+	Value& operator=(const Value& other){
+		if(this != &other){
+			other.retain();
+			release();
+			type = other.type;
+			i = other.i;
+		}
+		return *this;
+	}
 
-	Value(const glm::mat3& val) : type(MAT3), m3(val){}
+	Value& operator=(Value&& other) noexcept {
+		if(this != &other){
+			release();
+			type = other.type;
+			i = other.i;
+			other.type = BOOL;
+		}
+		return *this;
+	}
 
-	Value(const glm::mat4& val) : type(MAT4), m4(val){}
+	~Value(){
+		release();
+	}
 
 	bool convert(const Type& target, Value& outVal) const;
 
 	std::string toString(Format format) const;
 
+	// Out-of-line content, only valid for the corresponding type.
+	const glm::vec3& v3() const { return static_cast<const Block*>(_shared)->v3; }
+	const glm::vec4& v4() const { return static_cast<const Block*>(_shared)->v4; }
+	const glm::mat3& m3() const { return static_cast<const Block*>(_shared)->m3; }
+	const glm::mat4& m4() const { return static_cast<const Block*>(_shared)->m4; }
+	const std::string& str() const;
+
+private:
+
+	/** Out-of-line storage, immutable once created. */
+	struct Shared {
+		std::atomic<uint> refs{1u};
+	};
+
+	struct Block : Shared {
+		union {
+			glm::mat4 m4;
+			glm::mat3 m3;
+			glm::vec4 v4;
+			glm::vec3 v3;
+		};
+		Block() {}
+	};
+
+	struct Text : Shared {
+		std::string str;
+	};
+
+public:
+
 	Type type;
 	union {
-		glm::mat4 m4;
-		glm::mat3 m3;
-		glm::vec4 v4;
-		glm::vec3 v3;
 		double f;
 		long long i;
 		bool b;
+		Shared* _shared;
 	};
-	std::string str;
+
+private:
+
+	bool isBoxed() const { return type >= VEC3 && _shared != nullptr; }
+
+	void retain() const {
+		if(isBoxed()){
+			_shared->refs.fetch_add(1u, std::memory_order_relaxed);
+		}
+	}
+
+	void release(){
+		if(isBoxed() && _shared->refs.fetch_sub(1u, std::memory_order_acq_rel) == 1u){
+			destroy();
+		}
+	}
+
+	static Block* createBlock();
+	void destroy();
 };
 
 inline std::string TypeString(Value::Type type){
@@ -118,9 +201,11 @@ class Literal;
 class Variable;
 class VariableDef;
 class FunctionDef;
+class FunctionMemo;
 class FunctionVar;
 class FunctionCall;
 class Expression;
+class Program;
 
 class TreeVisitor {
 public:
@@ -137,6 +222,10 @@ public:
 
 	Status getStatus() const;
 
+	bool hasFailed() const {
+		return _failed;
+	}
+
 	Expression const * getErrorExpression() const {
 		return _failedExpression;
 	}
@@ -156,17 +245,51 @@ public:
 
 	Expression(long _start, long _end) : dbgStartPos(_start), dbgEndPos(_end) {}
 
+	virtual ~Expression() = default;
+
 	virtual Value evaluate(TreeVisitor& visitor) = 0;
 
 	Status evaluate(TreeVisitor& visitor, Value& outValue);
 
-	using Ptr = std::shared_ptr<Expression>;
+	// Nodes are owned by the arena they were allocated in.
+	using Ptr = Expression*;
 
 	const long dbgStartPos;
 	const long dbgEndPos;
 	
 };
 
+/** Storage for the nodes of expression trees. Nodes are allocated contiguously in large chunks
+ and all released at once when the arena is destroyed. */
+class Arena {
+public:
+
+	Arena() = default;
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena();
+
+	template<typename T, typename... Args>
+	T* make(Args&&... args){
+		T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		_nodes.push_back(node);
+		return node;
+	}
+
+private:
+
+	void* allocate(size_t size, size_t alignment);
+
+	static constexpr size_t CHUNK_SIZE = 4096;
+
+	std::vector<std::unique_ptr<char[]>> _chunks;
+	std::vector<Expression*> _nodes;
+	size_t _offset = 0;
+	size_t _capacity = 0;
+};
+
 class Unary final : public Expression {
 public:
 
@@ -263,6 +386,10 @@ public:
 	const std::string name;
 	std::vector<std::string> args;
 	const Expression::Ptr expr;
+	// Bytecode version of the expression, compiled once the function is registered.
+	std::shared_ptr<const Program> program;
+	// Results of previous calls, if enabled. Cleared when any function is redefined.
+	std::shared_ptr<FunctionMemo> memo;
 
 };
 
@@ -0,0 +1,186 @@
+#include "Tests.hpp"
+#include "core/Calculator.hpp"
+
+#include <limits>
+#include <sstream>
+
+namespace {
+
+	bool evaluate(Calculator& calculator, const std::string& input, Value& output){
+		std::vector<Calculator::Word> words;
+		Format format = Format::INTERNAL;
+		return calculator.evaluate(input, output, words, format, false);
+	}
+
+	double evaluateFloat(Calculator& calculator, const std::string& input){
+		Value output;
+		CHECK_MSG(evaluate(calculator, input, output), "Unable to evaluate " << input);
+		Value result;
+		CHECK_MSG(output.convert(Value::FLOAT, result), input << " is not a float");
+		return result.f;
+	}
+
+}
+
+TEST_CASE(liveModeReportsRecomputedFunctions){
+	Calculator calculator;
+	calculator.setLiveMode(true);
+	Value output;
+	CHECK(evaluate(calculator, "a = 2", output));
+	CHECK(evaluate(calculator, "f(x) = x * a", output));
+	CHECK(evaluate(calculator, "g(x) = f(x) + 1", output));
+	CHECK(evaluate(calculator, "h(x) = x", output));
+	CHECK(calculator.recomputedFunctions().empty());
+
+	CHECK(evaluate(calculator, "a = 3", output));
+	const std::vector<std::string> expected = { "f", "g" };
+	CHECK(calculator.recomputedFunctions() == expected);
+	CHECK(evaluateFloat(calculator, "g(2)") == 7.0);
+
+	// Only the last definition is reported.
+	CHECK(evaluate(calculator, "h(x) = 2 * x", output));
+	CHECK(calculator.recomputedFunctions().empty());
+
+	// Variables see the recomputed functions they call.
+	CHECK(evaluate(calculator, "b = g(1) * 10", output));
+	CHECK(evaluate(calculator, "a = 5", output));
+	CHECK(evaluateFloat(calculator, "b") == 60.0);
+	CHECK(evaluateFloat(calculator, "g(2)") == 11.0);
+
+	calculator.setLiveMode(false);
+	CHECK(evaluate(calculator, "a = 4", output));
+	CHECK(calculator.recomputedFunctions().empty());
+	CHECK(evaluateFloat(calculator, "g(2)") == 11.0);
+}
+
+TEST_CASE(liveModeSurvivesReload){
+	std::stringstream state;
+	{
+		Calculator calculator;
+		calculator.setLiveMode(true);
+		Value output;
+		CHECK(evaluate(calculator, "a = 1", output));
+		CHECK(evaluate(calculator, "b = a * 10", output));
+		CHECK(evaluate(calculator, "f(x) = x + a", output));
+		calculator.saveToStream(state);
+	}
+	Calculator calculator;
+	calculator.setLiveMode(true);
+	std::string header;
+	state >> header;
+	CHECK(header == "CALCSTATE");
+	calculator.loadFromStream(state);
+
+	Value output;
+	CHECK(evaluate(calculator, "a = 2", output));
+	CHECK(evaluateFloat(calculator, "b") == 20.0);
+	CHECK(evaluateFloat(calculator, "f(0)") == 2.0);
+}
+
+TEST_CASE(redefinitionsReachCallers){
+	Calculator calculator;
+	calculator.setMemoCapacity(16);
+	Value output;
+	CHECK(evaluate(calculator, "g(x) = x * 2", output));
+	CHECK(evaluate(calculator, "f(x) = g(x) + 1", output));
+	CHECK(evaluate(calculator, "h(x) = f(x) * 10", output));
+	CHECK(evaluateFloat(calculator, "h(1.0)") == 30.0);
+	// Callers of callers are linked to the new definition, and forget their cached results.
+	CHECK(evaluate(calculator, "g(x) = x * 3", output));
+	CHECK(evaluateFloat(calculator, "h(1.0)") == 40.0);
+
+	// Calls to the standard library might have been folded.
+	CHECK(evaluate(calculator, "k(x) = sin(0.0) + x", output));
+	CHECK(evaluateFloat(calculator, "k(1.0)") == 1.0);
+	CHECK(evaluate(calculator, "sin(x) = 5.0", output));
+	CHECK(evaluateFloat(calculator, "k(1.0)") == 6.0);
+}
+
+TEST_CASE(mixEvaluatesAllArguments){
+	Calculator calculator;
+	const double inf = std::numeric_limits<double>::infinity();
+	// A zero weight still propagates infinities and NaNs of the other end, and the sign of zeros follows x*(1-t)+y*t.
+	CHECK(std::isnan(evaluateFloat(calculator, "mix(2.0, 1.0/0.0, 0.0)")));
+	CHECK(std::isnan(evaluateFloat(calculator, "lerp(2.0, 1.0/0.0, 0)")));
+	CHECK(sameBits(evaluateFloat(calculator, "mix(-0.0, 0.0, 0.0)"), 0.0));
+
+	Value output;
+	CHECK(evaluate(calculator, "s(x) = mix(-0.0, x, 0.0)", output));
+	CHECK(evaluate(calculator, "r(x) = mix(x, 1.0/0.0, 0.0)", output));
+	// Calls as typed, and the same arguments for compiled and batch calls.
+	struct Case {
+		std::string call;
+		std::string name;
+		double x;
+		double expected;
+	};
+	const std::vector<Case> cases = {
+		{ "s(0.0)", "s", 0.0, 0.0 }, { "s(-0.0)", "s", -0.0, -0.0 }, { "s(1.0/0.0)", "s", inf, std::numeric_limits<double>::quiet_NaN() },
+		{ "r(2.0)", "r", 2.0, std::numeric_limits<double>::quiet_NaN() }, { "r(-0.0)", "r", -0.0, std::numeric_limits<double>::quiet_NaN() },
+	};
+	for(const Case& test : cases){
+		const double treeResult = evaluateFloat(calculator, test.call);
+		CHECK_MSG(ulpDistance(treeResult, test.expected) == 0, test.call << " = " << treeResult << ", expected " << test.expected);
+
+		Value result;
+		CHECK(calculator.evaluateFunction(test.name, { Value(test.x) }, result));
+		CHECK_MSG(result.type == Value::FLOAT && ulpDistance(result.f, test.expected) == 0, test.call << " = " << result.f << " in a compiled call, expected " << test.expected);
+
+		std::vector<double> xs(5, test.x), results(xs.size());
+		CHECK(calculator.evaluateFunctionBatch(test.name, { Column(xs.data()) }, results));
+		for(const double batchResult : results){
+			CHECK_MSG(ulpDistance(batchResult, test.expected) == 0, test.call << " = " << batchResult << " in a batch, expected " << test.expected);
+		}
+	}
+}
+
+TEST_CASE(integerModuloFailsOnTraps){
+	Calculator calculator;
+	Value output;
+	CHECK(evaluate(calculator, "7 % 3", output) && output.type == Value::INTEGER && output.i == 1);
+	CHECK(!evaluate(calculator, "7 % 0", output));
+	CHECK(!evaluate(calculator, "(-9223372036854775807 - 1) % -1", output));
+	CHECK(evaluateFloat(calculator, "7.0 % 0.0") != 0.0);
+
+	// Folded when defining the function, compiled, and per lane in batches.
+	CHECK(evaluate(calculator, "c(x) = x + 7 % 0", output));
+	CHECK(evaluate(calculator, "m(x, y) = x % y", output));
+	CHECK(evaluate(calculator, "l(x) = 7 % (x > 0.0 ? 1 : 0)", output));
+	CHECK(!evaluate(calculator, "c(1)", output));
+	CHECK(!evaluate(calculator, "m(7, 0)", output));
+	CHECK(!evaluate(calculator, "m(-9223372036854775807 - 1, -1)", output));
+	CHECK(evaluate(calculator, "l(1.0)", output) && output.i == 0);
+	CHECK(!evaluate(calculator, "l(-1.0)", output));
+
+	Value result;
+	CHECK(!calculator.evaluateFunction("m", { Value(7ll), Value(0ll) }, result));
+	CHECK(!calculator.evaluateFunction("l", { Value(-1.0) }, result));
+	std::vector<double> xs = { 1.0, 2.0, -1.0, 3.0 }, results(xs.size());
+	CHECK(!calculator.evaluateFunctionBatch("l", { Column(xs.data()) }, results));
+}
+
+TEST_CASE(deepInputsAreRejected){
+	Calculator calculator;
+	Value output;
+	std::string sum = "1";
+	for(int i = 1; i < 500; ++i){
+		sum += "+1";
+	}
+	CHECK(evaluateFloat(calculator, sum) == 500.0);
+	CHECK(evaluateFloat(calculator, std::string(100, '(') + "1" + std::string(100, ')')) == 1.0);
+
+	// Each of these would overflow the stack of a thread.
+	for(int i = 1; i < 300000; ++i){
+		sum += "+1";
+	}
+	CHECK(!evaluate(calculator, sum, output));
+	CHECK(!evaluate(calculator, std::string(300000, '(') + "1" + std::string(300000, ')'), output));
+	CHECK(!evaluate(calculator, std::string(300000, '-') + "1", output));
+	CHECK(!evaluate(calculator, "f(x) = " + std::string(300000, '-') + "x", output));
+	std::string calls;
+	for(int i = 0; i < 100000; ++i){
+		calls += "abs(";
+	}
+	CHECK(!evaluate(calculator, calls + "1" + std::string(100000, ')'), output));
+	CHECK(output.type == Value::STRING && output.str().find("too deeply nested") != std::string::npos);
+}
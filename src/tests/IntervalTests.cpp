@@ -0,0 +1,114 @@
+#include "Tests.hpp"
+#include "core/Calculator.hpp"
+
+#include <limits>
+#include <random>
+
+namespace {
+
+	const double inf = std::numeric_limits<double>::infinity();
+
+	struct Box {
+		double min;
+		double max;
+	};
+
+	// Bounds, zeros, extreme values inside the box, then random values.
+	std::vector<double> samples(const Box& box, std::mt19937_64& rng){
+		std::vector<double> values = { box.min, box.max };
+		for(const double value : { 0.0, -0.0, 1.0, -1.0, 1e308, -1e308, 1.7976931348623157e308, -1.7976931348623157e308 }){
+			if(value >= box.min && value <= box.max){
+				values.push_back(value);
+			}
+		}
+		const double low = std::max(box.min, -1e300);
+		const double high = std::min(box.max, 1e300);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		for(int i = 0; i < 24 && low <= high; ++i){
+			values.push_back(low + (high - low) * unit(rng));
+		}
+		return values;
+	}
+
+	// Each point of the box evaluates to a value inside the bounds, or to NaN if the bounds allow it.
+	void checkSound(Calculator& calculator, const std::string& definition, const std::vector<Box>& boxes){
+		Value output;
+		std::vector<Calculator::Word> words;
+		Format format = Format::INTERNAL;
+		CHECK_MSG(calculator.evaluate(definition, output, words, format, false), "Unable to define " << definition);
+		const std::string name = output.str();
+
+		std::vector<Interval> ranges;
+		for(const Box& box : boxes){
+			ranges.emplace_back(box.min, box.max);
+		}
+		Interval bounds;
+		if(!calculator.evaluateFunctionInterval(name, ranges, bounds)){
+			return;
+		}
+
+		std::mt19937_64 rng(11);
+		std::vector<std::vector<double>> values;
+		for(const Box& box : boxes){
+			values.push_back(samples(box, rng));
+		}
+		// All combinations of one or two arguments.
+		const size_t count0 = values[0].size();
+		const size_t count1 = values.size() > 1 ? values[1].size() : 1;
+		for(size_t i = 0; i < count0; ++i){
+			for(size_t j = 0; j < count1; ++j){
+				std::vector<Value> args = { Value(values[0][i]) };
+				if(values.size() > 1){
+					args.emplace_back(values[1][j]);
+				}
+				Value result;
+				Value resultFloat;
+				if(!calculator.evaluateFunction(name, args, result) || !result.convert(Value::FLOAT, resultFloat)){
+					continue;
+				}
+				const double x = resultFloat.f;
+				const bool inside = std::isnan(x) ? bounds.nan : (x >= bounds.min && x <= bounds.max);
+				CHECK_MSG(inside, definition << " at " << (args.size() > 1 ? "(" + args[0].toString(Format::INTERNAL) + ", " + args[1].toString(Format::INTERNAL) + ")" : args[0].toString(Format::INTERNAL)) << " = " << x
+					<< ", outside of [" << bounds.min << ", " << bounds.max << "]" << (bounds.nan ? " or NaN" : ""));
+				if(!inside){
+					return;
+				}
+			}
+		}
+	}
+
+}
+
+TEST_CASE(intervalBinaryOperatorsFlagNaN){
+	Calculator calculator;
+	const std::vector<Box> unbounded = { { -inf, inf }, { -inf, inf } };
+	checkSound(calculator, "p(x, y) = x + y", unbounded);
+	checkSound(calculator, "p(x, y) = x + y", { { 0.0, inf }, { -inf, 0.0 } });
+	checkSound(calculator, "m(x, y) = x - y", unbounded);
+	checkSound(calculator, "m(x, y) = x - y", { { 0.0, inf }, { 1.0, inf } });
+	checkSound(calculator, "q(x, y) = x * y", unbounded);
+	checkSound(calculator, "q(x, y) = x * y", { { -1.0, 1.0 }, { 2.0, inf } });
+	checkSound(calculator, "q(x, y) = x * y", { { -3.0, -1.0 }, { -inf, 2.0 } });
+
+	// Overflows inside the box, with infinities only reached by intermediate results.
+	checkSound(calculator, "f(x) = degrees(round(mix(x, x, 1e308)))", { { -2.98, 1.28 } });
+	checkSound(calculator, "g(x) = x * 1e308 - x * 1e308", { { -2.0, 3.0 } });
+	checkSound(calculator, "h(x) = (x * 1e308) * (x - 1.0)", { { 0.5, 4.0 } });
+
+	Interval bounds;
+	CHECK(calculator.evaluateFunctionInterval("f", { Interval(-2.98, 1.28) }, bounds));
+	CHECK(bounds.nan);
+	// Finite ranges don't produce NaN.
+	CHECK(calculator.evaluateFunctionInterval("q", { Interval(-1.0, 1.0), Interval(2.0, 5.0) }, bounds));
+	CHECK(!bounds.nan);
+}
+
+TEST_CASE(intervalFunctionsAreSound){
+	Calculator calculator;
+	checkSound(calculator, "a(x) = sin(x) * x + cos(2.0 * x)", { { -10.0, 10.0 } });
+	checkSound(calculator, "b(x) = sqrt(x) - log(x)", { { -1.0, 5.0 } });
+	checkSound(calculator, "c(x, y) = mix(x, y, 0.25) / (y * y + 1.0)", { { -4.0, 4.0 }, { -2.0, 3.0 } });
+	checkSound(calculator, "d(x) = fract(x) + abs(x) % 3.0", { { -7.5, 7.5 } });
+	checkSound(calculator, "e(x, y) = max(x, y) * min(x, 1e308 * y)", { { -inf, 2.0 }, { -1.0, inf } });
+	checkSound(calculator, "t(x) = tan(x) + smoothstep(0.0, 1.0, x)", { { 0.1, 1.4 } });
+}
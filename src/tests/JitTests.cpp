@@ -0,0 +1,101 @@
+#include "Tests.hpp"
+#include "core/Calculator.hpp"
+#include "core/Jit.hpp"
+
+#include <limits>
+
+namespace {
+
+	const std::vector<std::string> definitions = {
+		"a = 3", "f(x) = x * a + 2", "h(x) = sin(x) * cos(x) + exp(-x*x)",
+		"t(x) = 2 * pi / 180 * x", "p(x, y) = x ^ y + x % y - y / x", "c(x) = clamp(x, 0.0, 1.0) * mix(x, 2.0, 0.25)",
+		"m(x) = -x + +x * -1.5", "n(x) = h(x) + f(x)", "w(x) = -x / 3", "z(x) = -(x - x)", "i(x) = x + 1",
+		"o(x, y) = p(y, x) * n(x) - m(i(y))", "r(x) = o(x, 2.0) + o(1.5, x)",
+	};
+
+	// Signed zeros, infinities and NaNs of both signs.
+	const std::vector<double> inputs = {
+		0.5, -1.25, 2.0, 0.0, -0.0, 1e300, 7.25, -3.5,
+		std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+		std::numeric_limits<double>::quiet_NaN(), -std::numeric_limits<double>::quiet_NaN(),
+	};
+
+	void define(Calculator& calculator){
+		for(const std::string& definition : definitions){
+			Value output;
+			std::vector<Calculator::Word> words;
+			Format format = Format::INTERNAL;
+			CHECK_MSG(calculator.evaluate(definition, output, words, format, false), "Unable to define " << definition);
+		}
+	}
+
+	// Same calculators, one interpreted and one compiled to native code.
+	struct Calculators {
+
+		Calculators(){
+			JitFunction::setEnabled(false);
+			define(interpreted);
+			// Build the interpreted specializations now, as they are cached.
+			for(const std::string name : { "f", "h", "t", "p", "c", "m", "n", "w", "z", "o", "r" }){
+				const int argCount = interpreted.functionArgumentCount(name);
+				Value output;
+				interpreted.evaluateFunction(name, std::vector<Value>(argCount, Value(1.0)), output);
+				std::vector<double> results(4);
+				interpreted.evaluateFunctionBatch(name, std::vector<Column>(argCount, Column(Value(1.0))), results);
+			}
+			JitFunction::setEnabled(true);
+			define(compiled);
+		}
+
+		Calculator interpreted;
+		Calculator compiled;
+	};
+
+}
+
+TEST_CASE(jitScalarMatchesInterpreter){
+	Calculators calculators;
+	for(const std::string name : { "f", "h", "t", "p", "c", "m", "n", "w", "z", "o", "r" }){
+		const int argCount = calculators.compiled.functionArgumentCount(name);
+		for(size_t iid = 0; iid < inputs.size(); ++iid){
+			std::vector<Value> args;
+			for(int aid = 0; aid < argCount; ++aid){
+				args.emplace_back(inputs[(iid + 3 * aid) % inputs.size()]);
+			}
+			Value expected, result;
+			CHECK(calculators.interpreted.evaluateFunction(name, args, expected));
+			CHECK(calculators.compiled.evaluateFunction(name, args, result));
+			CHECK_MSG(result.type == Value::FLOAT && expected.type == Value::FLOAT && sameBits(result.f, expected.f),
+					  name << "(" << args[0].f << (argCount > 1 ? ", ..." : "") << ") = " << result.f << ", expected " << expected.f);
+		}
+	}
+}
+
+TEST_CASE(jitBatchMatchesInterpreter){
+	Calculators calculators;
+	// Counts around the vector width, and beyond the size of a block.
+	for(const size_t count : { 1, 3, 4, 5, 8, 300 }){
+		std::vector<double> xs(count), ys(count);
+		for(size_t sid = 0; sid < count; ++sid){
+			xs[sid] = inputs[sid % inputs.size()];
+			ys[sid] = inputs[(sid + 3) % inputs.size()] + double(sid / inputs.size());
+		}
+		for(const std::string name : { "f", "h", "t", "p", "c", "m", "n", "w", "z", "o", "r" }){
+			const int argCount = calculators.compiled.functionArgumentCount(name);
+			std::vector<Column> columns = { Column(xs.data()) };
+			if(argCount > 1){
+				columns.emplace_back(ys.data());
+			}
+			std::vector<double> expected(count), results(count);
+			CHECK(calculators.interpreted.evaluateFunctionBatch(name, columns, expected));
+			CHECK(calculators.compiled.evaluateFunctionBatch(name, columns, results));
+			// Samples are split in blocks differently, and approximated kernels are exact on the last samples of a call.
+			const bool approximated = name == "h" || name == "n" || name == "o" || name == "r";
+			for(size_t sid = 0; sid < count; ++sid){
+				const bool match = sameBits(results[sid], expected[sid])
+					|| (approximated && !std::isnan(expected[sid]) && ulpDistance(results[sid], expected[sid]) <= 4);
+				CHECK_MSG(match, name << "(" << xs[sid] << ") = " << results[sid] << ", expected " << expected[sid]);
+			}
+		}
+	}
+}
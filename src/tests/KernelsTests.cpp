@@ -0,0 +1,257 @@
+#include "Tests.hpp"
+#include "core/Kernels.hpp"
+
+#include <functional>
+#include <limits>
+#include <random>
+
+namespace {
+
+	const double inf = std::numeric_limits<double>::infinity();
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+
+	// Zeros, denormals, infinities, NaN, overflow thresholds, halfway rounding, zeros of sin and cos and range reduction limits.
+	const std::vector<double> edgeValues = {
+		0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 1.5, -2.5, 2.5, 3.0,
+		inf, -inf, nan, -nan,
+		4.9406564584124654e-324, -4.9406564584124654e-324, 1e-310, -1e-310,
+		2.2250738585072014e-308, -2.2250738585072014e-308, 1e-200,
+		1.7976931348623157e308, -1.7976931348623157e308, 1e300, -1e300,
+		708.0, 709.0, 709.78, 709.79, 710.0, -708.0, -708.5, -745.1, -746.0,
+		3.14159265358979, 1.5707963267948966, 4.71238898038469, -7.853981633974483, 314.1592653589793, 1e6, -1e6, 1000001.0, 1e7,
+		0.49999999999999994, 4503599627370497.0, -4503599627370497.0,
+	};
+
+	// Edge values followed by random values of all magnitudes. The count is not a multiple of the vector width.
+	std::vector<double> testValues(uint seed){
+		std::vector<double> values = edgeValues;
+		std::mt19937_64 rng(seed);
+		std::uniform_real_distribution<double> unit(-1.0, 1.0);
+		std::uniform_int_distribution<int> exponent(-40, 40);
+		std::uniform_real_distribution<double> range(-100.0, 100.0);
+		while(values.size() < 20003){
+			values.push_back(values.size() % 2 == 0 ? std::ldexp(unit(rng), exponent(rng)) : range(rng));
+		}
+		return values;
+	}
+
+	// Maximum error allowed for the vectorized versions, all other kernels are bit-identical to glm.
+	uint64_t maxUlps(const std::string& name){
+		if(name == "sin" || name == "cos" || name == "exp"){
+			return 2;
+		}
+		if(name == "log"){
+			return 1;
+		}
+		return 0;
+	}
+
+	const std::vector<Kernels::Target> targets = { Kernels::Target::BEST, Kernels::Target::SCALAR };
+
+	std::string targetName(Kernels::Target target){
+		return target == Kernels::Target::SCALAR ? "scalar" : Kernels::instructionSet();
+	}
+
+	using UnaryReference = std::function<double(double)>;
+	using BinaryReference = std::function<double(double, double)>;
+	using TernaryReference = std::function<double(double, double, double)>;
+
+	void checkUnary(Kernels::Unary kernel, const UnaryReference& reference, const std::string& name, Kernels::Target target){
+		CHECK_MSG(kernel != nullptr, "Missing " << targetName(target) << " kernel " << name);
+		if(!kernel){
+			return;
+		}
+		std::vector<double> values = testValues(1);
+		// Also check the positive half of the domain for log and sqrt.
+		const size_t count = values.size();
+		for(size_t i = 0; i < count; ++i){
+			values.push_back(std::abs(values[i]));
+		}
+		std::vector<double> results(values.size());
+		kernel(values.data(), results.data(), values.size());
+		const uint64_t bound = target == Kernels::Target::SCALAR ? 0u : maxUlps(name);
+		for(size_t i = 0; i < values.size(); ++i){
+			const double expected = reference(values[i]);
+			CHECK_MSG(ulpDistance(results[i], expected) <= bound, targetName(target) << " " << name << "(" << values[i] << ") = " << results[i] << ", expected " << expected);
+		}
+	}
+
+	void checkBinary(Kernels::Binary kernel, const BinaryReference& reference, const std::string& name, Kernels::Target target){
+		CHECK_MSG(kernel != nullptr, "Missing " << targetName(target) << " kernel " << name);
+		if(!kernel){
+			return;
+		}
+		// All pairs of edge values, then random pairs with some equal operands for comparisons.
+		std::vector<double> as, bs;
+		for(double a : edgeValues){
+			for(double b : edgeValues){
+				as.push_back(a);
+				bs.push_back(b);
+			}
+		}
+		const std::vector<double> randomAs = testValues(2);
+		const std::vector<double> randomBs = testValues(3);
+		for(size_t i = 0; i < randomAs.size(); ++i){
+			as.push_back(randomAs[i]);
+			bs.push_back(i % 5 == 0 ? randomAs[i] : randomBs[i]);
+		}
+		std::vector<double> results(as.size());
+		kernel(as.data(), bs.data(), results.data(), as.size());
+		for(size_t i = 0; i < as.size(); ++i){
+			const double expected = reference(as[i], bs[i]);
+			CHECK_MSG(ulpDistance(results[i], expected) == 0, targetName(target) << " " << name << "(" << as[i] << ", " << bs[i] << ") = " << results[i] << ", expected " << expected);
+		}
+	}
+
+	void checkTernary(Kernels::Ternary kernel, const TernaryReference& reference, const std::string& name, Kernels::Target target){
+		CHECK_MSG(kernel != nullptr, "Missing " << targetName(target) << " kernel " << name);
+		if(!kernel){
+			return;
+		}
+		std::vector<double> as, bs, cs;
+		for(double a : edgeValues){
+			for(double b : edgeValues){
+				for(double c : edgeValues){
+					as.push_back(a);
+					bs.push_back(b);
+					cs.push_back(c);
+				}
+			}
+		}
+		const std::vector<double> randomAs = testValues(4);
+		const std::vector<double> randomBs = testValues(5);
+		const std::vector<double> randomCs = testValues(6);
+		for(size_t i = 0; i < randomAs.size(); ++i){
+			as.push_back(randomAs[i]);
+			bs.push_back(randomBs[i]);
+			cs.push_back(randomCs[i]);
+		}
+		std::vector<double> results(as.size());
+		kernel(as.data(), bs.data(), cs.data(), results.data(), as.size());
+		for(size_t i = 0; i < as.size(); ++i){
+			const double expected = reference(as[i], bs[i], cs[i]);
+			CHECK_MSG(ulpDistance(results[i], expected) == 0, targetName(target) << " " << name << "(" << as[i] << ", " << bs[i] << ", " << cs[i] << ") = " << results[i] << ", expected " << expected);
+		}
+	}
+
+	double boolean(bool value){
+		return value ? 1.0 : 0.0;
+	}
+
+}
+
+TEST_CASE(kernelsUnaryOperators){
+	const std::vector<std::pair<Operator, UnaryReference>> references = {
+		{ Operator::Plus, [](double x){ return x; } },
+		{ Operator::Minus, [](double x){ return -x; } },
+		{ Operator::BoolNot, [](double x){ return boolean(x == 0.0); } },
+	};
+	for(Kernels::Target target : targets){
+		for(const auto& reference : references){
+			checkUnary(Kernels::unaryOperator(reference.first, target), reference.second, OperatorString(reference.first), target);
+		}
+	}
+}
+
+TEST_CASE(kernelsBinaryOperators){
+	const std::vector<std::pair<Operator, BinaryReference>> references = {
+		{ Operator::Plus, [](double a, double b){ return a + b; } },
+		{ Operator::Minus, [](double a, double b){ return a - b; } },
+		{ Operator::Product, [](double a, double b){ return a * b; } },
+		{ Operator::Divide, [](double a, double b){ return a / b; } },
+		{ Operator::Power, [](double a, double b){ return glm::pow(a, b); } },
+		{ Operator::Modulo, [](double a, double b){ return glm::mod(a, b); } },
+		{ Operator::LessThan, [](double a, double b){ return boolean(a < b); } },
+		{ Operator::GreaterThan, [](double a, double b){ return boolean(a > b); } },
+		{ Operator::LessThanEqual, [](double a, double b){ return boolean(a <= b); } },
+		{ Operator::GreaterThanEqual, [](double a, double b){ return boolean(a >= b); } },
+		{ Operator::Equal, [](double a, double b){ return boolean(a == b); } },
+		{ Operator::Different, [](double a, double b){ return boolean(a != b); } },
+		{ Operator::BoolOr, [](double a, double b){ return boolean(a != 0.0 || b != 0.0); } },
+		{ Operator::BoolAnd, [](double a, double b){ return boolean(a != 0.0 && b != 0.0); } },
+		{ Operator::BoolXor, [](double a, double b){ return boolean((a != 0.0) != (b != 0.0)); } },
+	};
+	for(Kernels::Target target : targets){
+		for(const auto& reference : references){
+			checkBinary(Kernels::binaryOperator(reference.first, target), reference.second, OperatorString(reference.first), target);
+		}
+	}
+}
+
+TEST_CASE(kernelsUnaryFunctions){
+	const std::vector<std::pair<std::string, UnaryReference>> references = {
+		{ "cos", [](double x){ return glm::cos(x); } },
+		{ "sin", [](double x){ return glm::sin(x); } },
+		{ "tan", [](double x){ return glm::tan(x); } },
+		{ "acos", [](double x){ return glm::acos(x); } },
+		{ "asin", [](double x){ return glm::asin(x); } },
+		{ "atan", [](double x){ return glm::atan(x); } },
+		{ "exp", [](double x){ return glm::exp(x); } },
+		{ "log", [](double x){ return glm::log(x); } },
+		{ "exp2", [](double x){ return glm::exp2(x); } },
+		{ "log2", [](double x){ return glm::log2(x); } },
+		{ "sqrt", [](double x){ return glm::sqrt(x); } },
+		{ "floor", [](double x){ return glm::floor(x); } },
+		{ "ceil", [](double x){ return glm::ceil(x); } },
+		{ "fract", [](double x){ return glm::fract(x); } },
+		{ "frac", [](double x){ return glm::fract(x); } },
+		{ "abs", [](double x){ return glm::abs(x); } },
+		{ "inversesqrt", [](double x){ return glm::inversesqrt(x); } },
+		{ "rcp", [](double x){ return 1.0 / x; } },
+		{ "sign", [](double x){ return glm::sign(x); } },
+		{ "saturate", [](double x){ return glm::clamp(x, 0.0, 1.0); } },
+		{ "radians", [](double x){ return glm::radians(x); } },
+		{ "degrees", [](double x){ return glm::degrees(x); } },
+		{ "sinh", [](double x){ return glm::sinh(x); } },
+		{ "cosh", [](double x){ return glm::cosh(x); } },
+		{ "tanh", [](double x){ return glm::tanh(x); } },
+		{ "asinh", [](double x){ return glm::asinh(x); } },
+		{ "acosh", [](double x){ return glm::acosh(x); } },
+		{ "atanh", [](double x){ return glm::atanh(x); } },
+		{ "round", [](double x){ return glm::round(x); } },
+		{ "trunc", [](double x){ return glm::trunc(x); } },
+	};
+	for(Kernels::Target target : targets){
+		for(const auto& reference : references){
+			checkUnary(Kernels::unaryFunction(reference.first, target), reference.second, reference.first, target);
+		}
+	}
+}
+
+TEST_CASE(kernelsBinaryFunctions){
+	const std::vector<std::pair<std::string, BinaryReference>> references = {
+		{ "pow", [](double a, double b){ return glm::pow(a, b); } },
+		{ "min", [](double a, double b){ return glm::min(a, b); } },
+		{ "max", [](double a, double b){ return glm::max(a, b); } },
+		{ "mod", [](double a, double b){ return glm::mod(a, b); } },
+		{ "step", [](double a, double b){ return glm::step(a, b); } },
+		{ "atan", [](double a, double b){ return glm::atan(a, b); } },
+		{ "atan2", [](double a, double b){ return glm::atan(a, b); } },
+	};
+	for(Kernels::Target target : targets){
+		for(const auto& reference : references){
+			checkBinary(Kernels::binaryFunction(reference.first, target), reference.second, reference.first, target);
+		}
+	}
+}
+
+TEST_CASE(kernelsTernaryFunctions){
+	const std::vector<std::pair<std::string, TernaryReference>> references = {
+		{ "clamp", [](double x, double a, double b){ return glm::clamp(x, a, b); } },
+		{ "mix", [](double x, double y, double t){ return glm::mix(x, y, t); } },
+		{ "lerp", [](double x, double y, double t){ return glm::mix(x, y, t); } },
+		{ "smoothstep", [](double e0, double e1, double x){ return glm::smoothstep(e0, e1, x); } },
+	};
+	for(Kernels::Target target : targets){
+		for(const auto& reference : references){
+			checkTernary(Kernels::ternaryFunction(reference.first, target), reference.second, reference.first, target);
+		}
+	}
+}
+
+TEST_CASE(kernelsUnsupported){
+	for(Kernels::Target target : targets){
+		CHECK(Kernels::binaryOperator(Operator::ShiftLeft, target) == nullptr);
+		CHECK(Kernels::unaryFunction("determinant", target) == nullptr);
+	}
+}
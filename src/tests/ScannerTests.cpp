@@ -0,0 +1,63 @@
+#include "Tests.hpp"
+#include "core/Scanner.hpp"
+
+#include <random>
+
+namespace {
+
+	bool sameToken(const Token& a, const Token& b){
+		const bool sameFloat = a.type != Token::Type::Float || a.fVal == b.fVal || (std::isnan(a.fVal) && std::isnan(b.fVal));
+		return a.type == b.type && a.location == b.location && a.size == b.size && sameFloat
+			&& a.iVal == b.iVal && a.sVal == b.sVal && a.opVal == b.opVal;
+	}
+
+	bool sameWord(const Word& a, const Word& b){
+		return a.type == b.type && a.location == b.location && a.size == b.size;
+	}
+
+}
+
+TEST_CASE(scannerIncrementalMatchesFull){
+	// Fragments that merge or split tokens when an edit lands next to them.
+	const std::vector<std::string> pieces = {
+		"a", "x1", "sin", "(", ")", ".", ".5", "0x1F", "0b1", "017", "1e", "1e+5", "2.5f", "e", "+", "-", "*", "/", "//",
+		"=", "==", "<", "<<", "<=", ">", "|", "||", "&", "&&", "#", "!", "!=", "?", ":", ",", " ", "$", "pi", "v.x", "9", "0", "1.", "@", "^", "%",
+	};
+	std::mt19937 rng(7);
+	auto randomText = [&](size_t count){
+		std::string text;
+		for(size_t i = 0; i < count; ++i){
+			text += pieces[rng() % pieces.size()];
+		}
+		return text;
+	};
+
+	for(int it = 0; it < 20000; ++it){
+		const std::string before = randomText(rng() % 12);
+		Scanner previous(before);
+		previous.scan();
+
+		std::string after = before;
+		const size_t position = after.empty() ? 0 : rng() % (after.size() + 1);
+		const size_t removed = after.empty() ? 0 : rng() % std::min<size_t>(4, after.size() - position + 1);
+		after.replace(position, removed, rng() % 4 == 0 ? std::string() : randomText(1));
+
+		Scanner full(after);
+		const Status fullStatus = full.scan();
+		Scanner incremental(after);
+		const Status incrementalStatus = incremental.scan(previous, Scanner::difference(before, after));
+
+		bool match = fullStatus.success == incrementalStatus.success && fullStatus.location == incrementalStatus.location
+			&& full.tokens().size() == incremental.tokens().size() && full.words().size() == incremental.words().size();
+		for(size_t i = 0; match && i < full.tokens().size(); ++i){
+			match = sameToken(full.tokens()[i], incremental.tokens()[i]);
+		}
+		for(size_t i = 0; match && i < full.words().size(); ++i){
+			match = sameWord(full.words()[i], incremental.words()[i]);
+		}
+		CHECK_MSG(match, "'" << before << "' -> '" << after << "'");
+		if(!match){
+			return;
+		}
+	}
+}
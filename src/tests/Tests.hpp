@@ -0,0 +1,40 @@
+#pragma once
+#include "core/Common.hpp"
+
+#include <sstream>
+
+/** Minimal test registry: test files declare cases with TEST_CASE, CalcoTests runs them all.
+ A failed check is reported with its location and the case continues. */
+class Tests {
+public:
+
+	using Function = void (*)();
+
+	struct Registration {
+		Registration(const char* name, Function function);
+	};
+
+	static void fail(const char* file, int line, const std::string& message);
+
+	// Run all cases whose name contains the filter, returns the number of failed cases.
+	static int run(const std::string& filter);
+
+};
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const Tests::Registration name##Registration(#name, &name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if(!(condition)){ Tests::fail(__FILE__, __LINE__, #condition); } } while(0)
+
+// The message is streamed, only when the check fails.
+#define CHECK_MSG(condition, message) \
+	do { if(!(condition)){ std::ostringstream str_; str_ << message; Tests::fail(__FILE__, __LINE__, str_.str()); } } while(0)
+
+// Distance in units in the last place, NaNs are equal to each other and zeros of different signs are 1 ulp apart.
+uint64_t ulpDistance(double a, double b);
+
+// Exact match, including the sign of zeros and NaNs.
+bool sameBits(double a, double b);
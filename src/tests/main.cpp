@@ -0,0 +1,72 @@
+#include "Tests.hpp"
+
+#include <iostream>
+#include <cstring>
+
+namespace {
+
+	struct Case {
+		const char* name;
+		Tests::Function function;
+	};
+
+	std::vector<Case>& cases(){
+		// Built on first use, registrations run during static initialization.
+		static std::vector<Case> list;
+		return list;
+	}
+
+	uint failureCount = 0;
+
+}
+
+Tests::Registration::Registration(const char* name, Function function){
+	cases().push_back({ name, function });
+}
+
+void Tests::fail(const char* file, int line, const std::string& message){
+	std::cerr << "\t" << file << ":" << line << ": " << message << std::endl;
+	++failureCount;
+}
+
+int Tests::run(const std::string& filter){
+	int failedCases = 0;
+	int runCases = 0;
+	for(const Case& test : cases()){
+		if(!filter.empty() && std::string(test.name).find(filter) == std::string::npos){
+			continue;
+		}
+		++runCases;
+		const uint previousFailures = failureCount;
+		test.function();
+		const bool success = failureCount == previousFailures;
+		std::cout << (success ? "[ OK ] " : "[FAIL] ") << test.name << std::endl;
+		failedCases += success ? 0 : 1;
+	}
+	std::cout << (runCases - failedCases) << "/" << runCases << " test cases passed." << std::endl;
+	return failedCases;
+}
+
+uint64_t ulpDistance(double a, double b){
+	if(std::isnan(a) || std::isnan(b)){
+		return std::isnan(a) && std::isnan(b) ? 0u : UINT64_MAX;
+	}
+	// Map the bit patterns to a monotonic integer scale, with -0.0 just below 0.0.
+	auto ordered = [](double x){
+		int64_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		return bits < 0 ? -(bits & INT64_MAX) - 1 : bits;
+	};
+	const int64_t ia = ordered(a);
+	const int64_t ib = ordered(b);
+	return ia > ib ? uint64_t(ia) - uint64_t(ib) : uint64_t(ib) - uint64_t(ia);
+}
+
+bool sameBits(double a, double b){
+	return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+int main(int argc, char** argv){
+	const std::string filter = argc > 1 ? argv[1] : "";
+	return Tests::run(filter) == 0 ? 0 : 1;
+}
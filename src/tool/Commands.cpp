@@ -0,0 +1,126 @@
+#include "Commands.hpp"
+#include "core/system/TextUtilities.hpp"
+
+#include <fstream>
+
+bool evaluateStatement(Calculator& calculator, const std::string& inputLine, bool temporary, std::ostream& out, std::ostream& err, const std::string& errorHeader){
+	Value result;
+	Format format = Format::INTERNAL;
+	std::vector<Calculator::Word> wordInfos;
+	const bool success = calculator.evaluate(inputLine, result, wordInfos, format, temporary);
+
+	// Input line, with syntax highlighted words.
+	if(!temporary){
+		std::string inputLineInterpreted;
+		bool first = true;
+		for(const Calculator::Word& word : wordInfos){
+			std::string wordString = inputLine.substr(word.location, word.size);
+			if(word.type == Calculator::Word::OPERATOR && !first){
+				wordString = " " + wordString + " ";
+			}
+			inputLineInterpreted.append(wordString);
+			first = false;
+		}
+
+		out << inputLineInterpreted << "\n";
+	}
+
+	// Output/error line
+	if(!success){
+		// Error line: passthrough the error message from the calculator.
+		// The message can be multi-lines, split it.
+		const std::vector<std::string> sublines = TextUtilities::split(result.str(), "\n", false);
+		err << errorHeader << "\n";
+		for (const std::string& subline : sublines) {
+			err << subline << "\n";
+		}
+		return false;
+	} else if(result.type == Value::Type::STRING){
+		// This is 'function definition' specific.
+		out << result.str() << " defined" << "\n";
+
+	} else {
+
+		// Build final display properly formatted.
+		const std::string externalStr = result.toString(format);
+		// The message can be multi-lines, split it.
+		const std::vector<std::string> sublines = TextUtilities::split(externalStr, "\n", false);
+		bool firstl = true;
+		for (const std::string& subline : sublines) {
+			out << (firstl ? "= " : "  ") << subline << "\n";
+			firstl = false;
+		}
+
+	}
+	return true;
+}
+
+void loadState(Calculator& calculator, const CalcoConfig& config){
+	std::ifstream file(config.historyPath);
+	if (file.is_open()) {
+		std::string elem;
+		file >> elem;
+		if (elem == "CALCSTATE") {
+			calculator.loadFromStream(file);
+			file >> elem;
+		}
+		file.close();
+	} else {
+		Log::Error() << "Unable to open state at \"" << config.historyPath << "\"" << std::endl;
+	}
+}
+
+void saveState(const Calculator& calculator, const CalcoConfig& config){
+	std::ofstream file(config.historyPath);
+	if(file.is_open()) {
+		calculator.saveToStream(file);
+		file.close();
+	} else {
+		Log::Error() << "Unable to save state to \"" << config.historyPath << "\"" << std::endl;
+	}
+}
+
+bool SampleGrid::setCount(size_t aid, double count){
+	if(!(count >= 1.0) || !(count <= double(MAX_COUNT)) || count != std::floor(count)){
+		return false;
+	}
+	counts[aid] = size_t(count);
+	return true;
+}
+
+std::string SampleGrid::countError(){
+	return "Between 1 and " + std::to_string(MAX_COUNT) + " samples are needed on each axis";
+}
+
+double SampleGrid::position(size_t aid, size_t sid) const {
+	if(counts[aid] == 1){
+		return froms[aid];
+	}
+	return froms[aid] + (tos[aid] - froms[aid]) * double(sid) / double(counts[aid] - 1);
+}
+
+bool SampleGrid::evaluate(Calculator& calculator, const std::string& name, ThreadPool& pool, size_t start, size_t count,
+	double* xs, double* ys, double* values, const std::function<void(size_t, size_t)>& onChunk) const {
+	for(size_t sid = 0; sid < count; ++sid){
+		xs[sid] = position(0, (start + sid) % counts[0]);
+		ys[sid] = position(1, (start + sid) / counts[0]);
+	}
+	std::atomic<bool> failed(false);
+	pool.parallelFor((count + CHUNK_SIZE - 1) / CHUNK_SIZE, [&](size_t cid){
+		const size_t begin = cid * CHUNK_SIZE;
+		const size_t end = std::min(begin + CHUNK_SIZE, count);
+		std::vector<Column> columns;
+		columns.emplace_back(xs + begin);
+		if(axisCount == 2){
+			columns.emplace_back(ys + begin);
+		}
+		if(!calculator.evaluateFunctionBatch(name, columns, values + begin, end - begin)){
+			failed = true;
+			return;
+		}
+		if(onChunk){
+			onChunk(begin, end);
+		}
+	});
+	return !failed;
+}
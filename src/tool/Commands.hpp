@@ -0,0 +1,45 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Settings.hpp"
+#include "core/Calculator.hpp"
+#include "core/ThreadPool.hpp"
+
+#include <functional>
+#include <ostream>
+
+// Evaluate a statement and print it with its result, errors are printed after the given header.
+// Temporary statements don't modify the calculator and are not printed back.
+bool evaluateStatement(Calculator& calculator, const std::string& inputLine, bool temporary, std::ostream& out, std::ostream& err, const std::string& errorHeader);
+
+void loadState(Calculator& calculator, const CalcoConfig& config);
+
+void saveState(const Calculator& calculator, const CalcoConfig& config);
+
+/** Regular grid over the arguments of a function of one or two arguments, bounds included.
+ Samples are ordered along the first axis, then along the second one. */
+struct SampleGrid {
+
+	// Samples evaluated by each task of the thread pool.
+	static constexpr size_t CHUNK_SIZE = 4096;
+	// Samples on each axis, and in a single server response.
+	static constexpr size_t MAX_COUNT = 1u << 22u;
+
+	double froms[2] = { 0.0, 0.0 };
+	double tos[2] = { 0.0, 0.0 };
+	size_t counts[2] = { 1, 1 };
+	size_t axisCount = 1;
+
+	size_t sampleCount() const { return counts[0] * counts[1]; }
+
+	// Set the number of samples on an axis, fails if it is not an integer between 1 and MAX_COUNT.
+	bool setCount(size_t aid, double count);
+
+	static std::string countError();
+
+	double position(size_t aid, size_t sid) const;
+
+	// Evaluate a function on count samples from start, split in chunks between threads. Positions are written in xs and ys,
+	// results in values. If provided, onChunk(begin, end) is called by the thread that evaluated each chunk.
+	bool evaluate(Calculator& calculator, const std::string& name, ThreadPool& pool, size_t start, size_t count,
+		double* xs, double* ys, double* values, const std::function<void(size_t, size_t)>& onChunk = nullptr) const;
+};
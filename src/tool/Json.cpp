@@ -0,0 +1,372 @@
+#include "Json.hpp"
+
+#include <cstring>
+
+namespace {
+
+	class JsonReader {
+	public:
+
+		explicit JsonReader(const std::string& text) : _text(text) {}
+
+		bool document(Json& output){
+			if(!value(output, 0)){
+				return false;
+			}
+			skipSpaces();
+			return _pos == _text.size();
+		}
+
+	private:
+
+		// Nested arrays and objects beyond this are rejected.
+		static constexpr uint MAX_DEPTH = 64;
+
+		void skipSpaces(){
+			while(_pos < _text.size() && (_text[_pos] == ' ' || _text[_pos] == '\t' || _text[_pos] == '\n' || _text[_pos] == '\r')){
+				++_pos;
+			}
+		}
+
+		bool consume(char c){
+			skipSpaces();
+			if(_pos < _text.size() && _text[_pos] == c){
+				++_pos;
+				return true;
+			}
+			return false;
+		}
+
+		bool keyword(const char* word){
+			const size_t size = strlen(word);
+			if(_text.compare(_pos, size, word) != 0){
+				return false;
+			}
+			_pos += size;
+			return true;
+		}
+
+		bool value(Json& output, uint depth){
+			if(depth > MAX_DEPTH){
+				return false;
+			}
+			skipSpaces();
+			if(_pos == _text.size()){
+				return false;
+			}
+			const char c = _text[_pos];
+			if(c == '{'){
+				++_pos;
+				output = Json::object();
+				if(consume('}')){
+					return true;
+				}
+				do {
+					std::string key;
+					skipSpaces();
+					if(!string(key) || !consume(':')){
+						return false;
+					}
+					Json member;
+					if(!value(member, depth + 1)){
+						return false;
+					}
+					output.set(key, member);
+				} while(consume(','));
+				return consume('}');
+			}
+			if(c == '['){
+				++_pos;
+				output = Json::array();
+				if(consume(']')){
+					return true;
+				}
+				do {
+					output.items.emplace_back();
+					if(!value(output.items.back(), depth + 1)){
+						return false;
+					}
+				} while(consume(','));
+				return consume(']');
+			}
+			if(c == '"'){
+				output = Json(std::string());
+				return string(output.str);
+			}
+			if(keyword("true")){
+				output = Json(true);
+				return true;
+			}
+			if(keyword("false")){
+				output = Json(false);
+				return true;
+			}
+			if(keyword("null")){
+				output = Json();
+				return true;
+			}
+			return number(output);
+		}
+
+		bool number(Json& output){
+			// Validate the grammar, strtod accepts more.
+			const size_t start = _pos;
+			if(_pos < _text.size() && _text[_pos] == '-'){
+				++_pos;
+			}
+			if(!digits()){
+				return false;
+			}
+			if(_pos < _text.size() && _text[_pos] == '.'){
+				++_pos;
+				if(!digits()){
+					return false;
+				}
+			}
+			if(_pos < _text.size() && (_text[_pos] == 'e' || _text[_pos] == 'E')){
+				++_pos;
+				if(_pos < _text.size() && (_text[_pos] == '+' || _text[_pos] == '-')){
+					++_pos;
+				}
+				if(!digits()){
+					return false;
+				}
+			}
+			output = Json(std::strtod(_text.c_str() + start, nullptr));
+			return true;
+		}
+
+		bool digits(){
+			const size_t start = _pos;
+			while(_pos < _text.size() && _text[_pos] >= '0' && _text[_pos] <= '9'){
+				++_pos;
+			}
+			return _pos != start;
+		}
+
+		bool hexCode(uint& code){
+			if(_pos + 4 > _text.size()){
+				return false;
+			}
+			code = 0;
+			for(size_t cid = 0; cid < 4; ++cid){
+				const char c = _text[_pos++];
+				code *= 16;
+				if(c >= '0' && c <= '9'){
+					code += uint(c - '0');
+				} else if(c >= 'a' && c <= 'f'){
+					code += uint(c - 'a' + 10);
+				} else if(c >= 'A' && c <= 'F'){
+					code += uint(c - 'A' + 10);
+				} else {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static void appendUtf8(std::string& output, uint code){
+			if(code < 0x80){
+				output.push_back(char(code));
+			} else if(code < 0x800){
+				output.push_back(char(0xC0 | (code >> 6)));
+				output.push_back(char(0x80 | (code & 0x3F)));
+			} else if(code < 0x10000){
+				output.push_back(char(0xE0 | (code >> 12)));
+				output.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+				output.push_back(char(0x80 | (code & 0x3F)));
+			} else {
+				output.push_back(char(0xF0 | (code >> 18)));
+				output.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+				output.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+				output.push_back(char(0x80 | (code & 0x3F)));
+			}
+		}
+
+		bool string(std::string& output){
+			if(_pos == _text.size() || _text[_pos] != '"'){
+				return false;
+			}
+			++_pos;
+			while(_pos < _text.size()){
+				const char c = _text[_pos++];
+				if(c == '"'){
+					return true;
+				}
+				if(uint8_t(c) < 0x20){
+					return false;
+				}
+				if(c != '\\'){
+					output.push_back(c);
+					continue;
+				}
+				if(_pos == _text.size()){
+					return false;
+				}
+				const char escaped = _text[_pos++];
+				switch(escaped){
+					case '"': output.push_back('"'); break;
+					case '\\': output.push_back('\\'); break;
+					case '/': output.push_back('/'); break;
+					case 'b': output.push_back('\b'); break;
+					case 'f': output.push_back('\f'); break;
+					case 'n': output.push_back('\n'); break;
+					case 'r': output.push_back('\r'); break;
+					case 't': output.push_back('\t'); break;
+					case 'u': {
+						uint code = 0;
+						if(!hexCode(code)){
+							return false;
+						}
+						// Characters outside of the basic plane are split in two surrogates.
+						if(code >= 0xD800 && code < 0xDC00){
+							uint low = 0;
+							if(!keyword("\\u") || !hexCode(low) || low < 0xDC00 || low >= 0xE000){
+								return false;
+							}
+							code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						} else if(code >= 0xDC00 && code < 0xE000){
+							return false;
+						}
+						appendUtf8(output, code);
+						break;
+					}
+					default:
+						return false;
+				}
+			}
+			return false;
+		}
+
+		const std::string& _text;
+		size_t _pos = 0;
+	};
+
+	void appendString(std::string& output, const std::string& str){
+		output.push_back('"');
+		for(const char c : str){
+			switch(c){
+				case '"': output.append("\\\""); break;
+				case '\\': output.append("\\\\"); break;
+				case '\n': output.append("\\n"); break;
+				case '\r': output.append("\\r"); break;
+				case '\t': output.append("\\t"); break;
+				default:
+					if(uint8_t(c) < 0x20){
+						char buffer[8];
+						snprintf(buffer, sizeof(buffer), "\\u%04x", uint(c));
+						output.append(buffer);
+					} else {
+						output.push_back(c);
+					}
+					break;
+			}
+		}
+		output.push_back('"');
+	}
+
+}
+
+Json Json::array(){
+	Json json;
+	json.type = Type::ARRAY;
+	return json;
+}
+
+Json Json::object(){
+	Json json;
+	json.type = Type::OBJECT;
+	return json;
+}
+
+bool Json::parse(const std::string& text, Json& output){
+	JsonReader reader(text);
+	return reader.document(output);
+}
+
+std::string Json::dump() const {
+	std::string output;
+	dump(output);
+	return output;
+}
+
+void Json::dump(std::string& output) const {
+	switch(type){
+		case Type::NUL:
+			output.append("null");
+			break;
+		case Type::BOOL:
+			output.append(boolean ? "true" : "false");
+			break;
+		case Type::NUMBER:
+			if(std::isfinite(number)){
+				appendNumber(output, number);
+			} else {
+				output.append("null");
+			}
+			break;
+		case Type::STRING:
+			appendString(output, str);
+			break;
+		case Type::ARRAY: {
+			output.push_back('[');
+			bool first = true;
+			for(const Json& item : items){
+				if(!first){
+					output.push_back(',');
+				}
+				item.dump(output);
+				first = false;
+			}
+			output.push_back(']');
+			break;
+		}
+		case Type::OBJECT: {
+			output.push_back('{');
+			bool first = true;
+			for(const auto& member : members){
+				if(!first){
+					output.push_back(',');
+				}
+				appendString(output, member.first);
+				output.push_back(':');
+				member.second.dump(output);
+				first = false;
+			}
+			output.push_back('}');
+			break;
+		}
+	}
+}
+
+const Json* Json::find(const std::string& key) const {
+	if(type != Type::OBJECT){
+		return nullptr;
+	}
+	for(const auto& member : members){
+		if(member.first == key){
+			return &member.second;
+		}
+	}
+	return nullptr;
+}
+
+Json& Json::set(const std::string& key, const Json& value){
+	for(auto& member : members){
+		if(member.first == key){
+			member.second = value;
+			return member.second;
+		}
+	}
+	members.emplace_back(key, value);
+	return members.back().second;
+}
+
+void Json::appendNumber(std::string& output, double value){
+	char buffer[32];
+	int size = snprintf(buffer, sizeof(buffer), "%.15g", value);
+	if(std::strtod(buffer, nullptr) != value){
+		size = snprintf(buffer, sizeof(buffer), "%.17g", value);
+	}
+	output.append(buffer, size_t(size));
+}
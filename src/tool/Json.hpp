@@ -0,0 +1,51 @@
+#pragma once
+#include "core/Common.hpp"
+
+/** Minimal JSON document, enough for the requests and responses exchanged with the server.
+ Object members keep their insertion order. */
+class Json {
+public:
+
+	enum class Type {
+		NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT
+	};
+
+	Json() = default;
+
+	Json(bool value) : type(Type::BOOL), boolean(value) {}
+
+	Json(double value) : type(Type::NUMBER), number(value) {}
+
+	Json(const std::string& value) : type(Type::STRING), str(value) {}
+
+	Json(const char* value) : type(Type::STRING), str(value) {}
+
+	static Json array();
+
+	static Json object();
+
+	// Parse a complete document, returns false if the text is not valid JSON.
+	static bool parse(const std::string& text, Json& output);
+
+	// Serialize on a single line. Non-finite numbers are written as null.
+	std::string dump() const;
+
+	void dump(std::string& output) const;
+
+	// Returns nullptr if this is not an object or if the member doesn't exist.
+	const Json* find(const std::string& key) const;
+
+	// Add a member to an object, or replace it if it exists.
+	Json& set(const std::string& key, const Json& value);
+
+	// Shortest representation of a number that reads back as the same value.
+	static void appendNumber(std::string& output, double value);
+
+	Type type = Type::NUL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string str;
+	std::vector<Json> items;
+	std::vector<std::pair<std::string, Json>> members;
+
+};
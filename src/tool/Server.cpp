@@ -0,0 +1,571 @@
+#include "Server.hpp"
+#include "Commands.hpp"
+#include "core/system/TextUtilities.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+namespace {
+
+	const std::string defaultSession = "default";
+	// Connections sending longer lines are closed.
+	constexpr size_t MAX_REQUEST_SIZE = 1u << 20u;
+	// Connections not reading their responses for this long are closed.
+	constexpr long SEND_TIMEOUT_SECONDS = 10;
+	// Named sessions in addition to the default one.
+	constexpr size_t MAX_SESSIONS = 64;
+
+	void setError(Json& response, const std::string& message){
+		response.set("ok", false);
+		response.set("error", message);
+	}
+
+	bool getString(const Json& request, const std::string& key, std::string& value){
+		const Json* member = request.find(key);
+		if(!member || member->type != Json::Type::STRING){
+			return false;
+		}
+		value = member->str;
+		return true;
+	}
+
+	// A number or an array of one or two numbers, values are kept if the member is missing.
+	bool getNumbers(const Json& request, const std::string& key, std::vector<double>& values){
+		const Json* member = request.find(key);
+		if(!member){
+			return true;
+		}
+		values.clear();
+		if(member->type == Json::Type::NUMBER){
+			values.push_back(member->number);
+			return true;
+		}
+		if(member->type != Json::Type::ARRAY || member->items.empty() || member->items.size() > 2){
+			return false;
+		}
+		for(const Json& item : member->items){
+			if(item.type != Json::Type::NUMBER){
+				return false;
+			}
+			values.push_back(item.number);
+		}
+		return true;
+	}
+
+#ifndef _WIN32
+
+	volatile sig_atomic_t interrupted = 0;
+
+	void onInterrupt(int){
+		interrupted = 1;
+	}
+
+	bool makeAddress(const std::string& path, sockaddr_un& address){
+		if(path.empty() || path.size() >= sizeof(address.sun_path)){
+			return false;
+		}
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		memcpy(address.sun_path, path.c_str(), path.size());
+		return true;
+	}
+
+	bool writeAll(int socket, const std::string& data){
+		size_t written = 0;
+		while(written < data.size()){
+			const ssize_t size = write(socket, data.data() + written, data.size() - written);
+			if(size < 0 && errno == EINTR){
+				continue;
+			}
+			if(size <= 0){
+				return false;
+			}
+			written += size_t(size);
+		}
+		return true;
+	}
+
+#endif
+
+}
+
+Server::Server(const CalcoConfig& config) : _config(config) {
+}
+
+Server::Connection::~Connection(){
+#ifndef _WIN32
+	if(socket >= 0){
+		close(socket);
+	}
+#endif
+}
+
+std::shared_ptr<Server::Session> Server::session(const std::string& name){
+	std::lock_guard<std::mutex> lock(_sessionsMutex);
+	auto session = _sessions.find(name);
+	if(session != _sessions.end()){
+		return session->second;
+	}
+	const size_t namedCount = _sessions.size() - _sessions.count(defaultSession);
+	if(name != defaultSession && namedCount >= MAX_SESSIONS){
+		return nullptr;
+	}
+	return _sessions.emplace(name, std::make_shared<Session>()).first->second;
+}
+
+std::shared_ptr<Server::Session> Server::session(const Json& request, Json& response){
+	const Json* name = request.find("session");
+	if(!name){
+		return session(defaultSession);
+	}
+	if(name->type != Json::Type::STRING || name->str.empty()){
+		setError(response, "Invalid session name");
+		return nullptr;
+	}
+	const std::shared_ptr<Session> target = session(name->str);
+	if(!target){
+		setError(response, "Too many sessions, at most " + std::to_string(MAX_SESSIONS) + " can be named");
+	}
+	return target;
+}
+
+std::shared_ptr<Calculator> Server::acquireReader(Session& session){
+	{
+		std::lock_guard<std::mutex> lock(session.readersMutex);
+		const uint64_t version = session.calculator.version();
+		if(version != session.readersVersion){
+			session.readers.clear();
+			session.readersVersion = version;
+		}
+		if(!session.readers.empty()){
+			const std::shared_ptr<Calculator> reader = session.readers.back();
+			session.readers.pop_back();
+			return reader;
+		}
+	}
+	return session.calculator.snapshot();
+}
+
+void Server::releaseReader(Session& session, const std::shared_ptr<Calculator>& reader){
+	std::lock_guard<std::mutex> lock(session.readersMutex);
+	if(session.calculator.version() == session.readersVersion){
+		session.readers.push_back(reader);
+	}
+}
+
+std::string Server::handle(const std::string& line){
+	Json response = Json::object();
+	Json request;
+	if(!Json::parse(line, request) || request.type != Json::Type::OBJECT){
+		setError(response, "Invalid request, expected a JSON object");
+		return response.dump();
+	}
+	if(const Json* id = request.find("id")){
+		response.set("id", *id);
+	}
+	std::string op;
+	if(!getString(request, "op", op)){
+		setError(response, "Missing operation");
+		return response.dump();
+	}
+	if(op == "shutdown"){
+		_stop = true;
+		response.set("ok", true);
+		return response.dump();
+	}
+
+	const std::shared_ptr<Session> target = session(request, response);
+	if(!target){
+		return response.dump();
+	}
+	if(op == "evaluate"){
+		evaluate(*target, request, response);
+	} else if(op == "define"){
+		define(*target, request, response);
+	} else if(op == "list"){
+		list(*target, response);
+	} else if(op == "sample"){
+		std::vector<double> values;
+		if(sample(*target, request, response, values)){
+			std::string output = response.dump();
+			output.pop_back();
+			output.append(",\"values\":[");
+			for(size_t vid = 0; vid < values.size(); ++vid){
+				if(vid != 0){
+					output.push_back(',');
+				}
+				if(std::isfinite(values[vid])){
+					Json::appendNumber(output, values[vid]);
+				} else {
+					output.append("null");
+				}
+			}
+			output.append("]}");
+			return output;
+		}
+	} else {
+		setError(response, "Unknown operation \"" + op + "\"");
+	}
+	return response.dump();
+}
+
+void Server::evaluate(Session& session, const Json& request, Json& response){
+	std::string input;
+	if(!getString(request, "input", input)){
+		setError(response, "Missing input");
+		return;
+	}
+	Value result;
+	Format format = Format::INTERNAL;
+	std::vector<Calculator::Word> wordInfos;
+	bool success = false;
+	{
+		std::shared_lock<std::shared_mutex> lock(session.mutex);
+		const std::shared_ptr<Calculator> reader = acquireReader(session);
+		success = reader->evaluate(input, result, wordInfos, format, true);
+		releaseReader(session, reader);
+	}
+	if(!success){
+		setError(response, result.str());
+		return;
+	}
+	response.set("ok", true);
+	response.set("result", result.type == Value::Type::STRING ? result.str() : result.toString(format));
+}
+
+void Server::define(Session& session, const Json& request, Json& response){
+	std::string input;
+	if(!getString(request, "input", input)){
+		setError(response, "Missing input");
+		return;
+	}
+	std::ostringstream out;
+	std::ostringstream err;
+	bool success = false;
+	{
+		std::unique_lock<std::shared_mutex> lock(session.mutex);
+		success = evaluateStatement(session.calculator, input, false, out, err, "Error:");
+	}
+	response.set("ok", success);
+	response.set("output", out.str());
+	if(!success){
+		response.set("error", err.str());
+	}
+}
+
+bool Server::sample(Session& session, const Json& request, Json& response, std::vector<double>& values){
+	std::string name;
+	if(!getString(request, "function", name)){
+		setError(response, "Missing function");
+		return false;
+	}
+	std::vector<double> froms = { -1.0 };
+	std::vector<double> tos = { 1.0 };
+	std::vector<double> counts = { 100.0 };
+	if(!getNumbers(request, "from", froms) || !getNumbers(request, "to", tos) || !getNumbers(request, "count", counts)){
+		setError(response, "Invalid sampling bounds, expected one or two numbers");
+		return false;
+	}
+
+	std::shared_lock<std::shared_mutex> lock(session.mutex);
+	const int argCount = session.calculator.functionArgumentCount(name);
+	if(argCount < 0){
+		setError(response, "Unknown function \"" + name + "\"");
+		return false;
+	}
+	if(argCount != 1 && argCount != 2){
+		setError(response, "Only functions of one or two arguments can be sampled");
+		return false;
+	}
+	// Parameters missing for the second axis are the same as for the first.
+	SampleGrid grid;
+	grid.axisCount = size_t(argCount);
+	for(size_t aid = 0; aid < grid.axisCount; ++aid){
+		grid.froms[aid] = froms[std::min(aid, froms.size() - 1)];
+		grid.tos[aid] = tos[std::min(aid, tos.size() - 1)];
+		const double count = counts[std::min(aid, counts.size() - 1)];
+		if(!grid.setCount(aid, count)){
+			setError(response, SampleGrid::countError());
+			return false;
+		}
+	}
+	const size_t sampleCount = grid.sampleCount();
+	if(sampleCount > SampleGrid::MAX_COUNT){
+		setError(response, "At most " + std::to_string(SampleGrid::MAX_COUNT) + " samples can be requested at once");
+		return false;
+	}
+
+	// Batches can be evaluated on the shared calculator.
+	std::vector<double> xs(sampleCount);
+	std::vector<double> ys(sampleCount);
+	values.resize(sampleCount);
+	if(!grid.evaluate(session.calculator, name, _pool, 0, sampleCount, xs.data(), ys.data(), values.data())){
+		setError(response, "Unable to evaluate \"" + name + "\" as a number");
+		return false;
+	}
+	response.set("ok", true);
+	return true;
+}
+
+void Server::list(Session& session, Json& response){
+	Json functions = Json::object();
+	Json variables = Json::object();
+	{
+		// Updating the documentation modifies the calculator.
+		std::unique_lock<std::shared_mutex> lock(session.mutex);
+		session.calculator.updateDocumentation(Format::INTERNAL);
+		for(const auto& func : session.calculator.functions()){
+			functions.set(func.second.name, func.second.expression);
+		}
+		for(const auto& var : session.calculator.variables()){
+			variables.set(var.first, var.second.value);
+		}
+	}
+	response.set("ok", true);
+	response.set("functions", functions);
+	response.set("variables", variables);
+}
+
+void Server::enqueue(const std::shared_ptr<Connection>& connection, const std::string& request){
+	{
+		std::lock_guard<std::mutex> lock(connection->mutex);
+		connection->requests.push_back(request);
+		if(connection->busy){
+			return;
+		}
+		connection->busy = true;
+		++_busyConnections;
+	}
+	_pool.submit([this, connection](){
+		process(connection);
+	});
+}
+
+void Server::process(const std::shared_ptr<Connection>& connection){
+	while(true){
+		std::string request;
+		{
+			std::lock_guard<std::mutex> lock(connection->mutex);
+			if(connection->requests.empty()){
+				connection->busy = false;
+				--_busyConnections;
+				return;
+			}
+			request = std::move(connection->requests.front());
+			connection->requests.pop_front();
+		}
+		const std::string response = handle(request) + "\n";
+#ifndef _WIN32
+		if(!writeAll(connection->socket, response)){
+			// The client is gone or doesn't read, don't answer its other requests and stop receiving them.
+			std::lock_guard<std::mutex> lock(connection->mutex);
+			connection->requests.clear();
+			shutdown(connection->socket, SHUT_RDWR);
+		}
+#endif
+	}
+}
+
+int Server::run(const std::string& socketPath){
+#ifdef _WIN32
+	(void)socketPath;
+	std::cerr << "Error:\nLocal sockets are not supported on this platform\n" << std::flush;
+	return 1;
+#else
+	auto fail = [&socketPath](const std::string& message){
+		std::cerr << "Error:\n" << message << " \"" << socketPath << "\"\n" << std::flush;
+		return 1;
+	};
+	sockaddr_un address;
+	if(!makeAddress(socketPath, address)){
+		return fail("Invalid socket path");
+	}
+	// Replace the socket of a previous server, only if it is not running anymore.
+	struct stat info;
+	if(stat(socketPath.c_str(), &info) == 0){
+		if(!S_ISSOCK(info.st_mode)){
+			return fail("A file that is not a socket already exists at");
+		}
+		const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		const bool running = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+		if(probe >= 0){
+			close(probe);
+		}
+		if(running){
+			return fail("A server is already running at");
+		}
+		unlink(socketPath.c_str());
+	}
+	const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listener < 0){
+		return fail("Unable to create socket");
+	}
+	if(bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0){
+		close(listener);
+		return fail("Unable to listen on");
+	}
+
+	loadState(session(defaultSession)->calculator, _config);
+
+	// Clients can disconnect before being answered.
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, onInterrupt);
+	signal(SIGTERM, onInterrupt);
+	Log::Info() << "Serving on \"" << socketPath << "\"" << std::endl;
+
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<pollfd> polls;
+	std::vector<char> buffer(1u << 16u);
+	while(!_stop && !interrupted){
+		polls.clear();
+		polls.push_back({ listener, POLLIN, 0 });
+		for(const auto& connection : connections){
+			polls.push_back({ connection->socket, POLLIN, 0 });
+		}
+		// Wake up regularly to check for shutdown requests.
+		if(poll(polls.data(), nfds_t(polls.size()), 250) <= 0){
+			continue;
+		}
+
+		const size_t connectionCount = connections.size();
+		for(size_t cid = 0; cid < connectionCount; ++cid){
+			if(polls[cid + 1].revents == 0){
+				continue;
+			}
+			Connection& connection = *connections[cid];
+			const ssize_t size = read(connection.socket, buffer.data(), buffer.size());
+			if(size < 0 && errno == EINTR){
+				continue;
+			}
+			// Pending requests are still answered once the client stopped sending.
+			if(size <= 0){
+				connection.open = false;
+				continue;
+			}
+			connection.input.append(buffer.data(), size_t(size));
+			size_t begin = 0;
+			size_t end = connection.input.find('\n');
+			while(end != std::string::npos){
+				std::string line = connection.input.substr(begin, end - begin);
+				if(!line.empty() && line.back() == '\r'){
+					line.pop_back();
+				}
+				if(!TextUtilities::trim(line, " \t").empty()){
+					enqueue(connections[cid], line);
+				}
+				begin = end + 1;
+				end = connection.input.find('\n', begin);
+			}
+			connection.input.erase(0, begin);
+			if(connection.input.size() > MAX_REQUEST_SIZE){
+				connection.open = false;
+			}
+		}
+		connections.erase(std::remove_if(connections.begin(), connections.end(), [](const std::shared_ptr<Connection>& connection){
+			return !connection->open;
+		}), connections.end());
+
+		if(polls[0].revents & POLLIN){
+			const int client = accept(listener, nullptr, nullptr);
+			if(client >= 0){
+				// Don't keep a worker blocked on a client that stopped reading.
+				timeval timeout = { SEND_TIMEOUT_SECONDS, 0 };
+				setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+				connections.push_back(std::make_shared<Connection>());
+				connections.back()->socket = client;
+			}
+		}
+	}
+
+	close(listener);
+	unlink(socketPath.c_str());
+	// Answer the requests already received before saving.
+	connections.clear();
+	while(_busyConnections != 0){
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	if(!_config.noSave){
+		const std::shared_ptr<Session> target = session(defaultSession);
+		std::unique_lock<std::shared_mutex> lock(target->mutex);
+		saveState(target->calculator, _config);
+	}
+	return 0;
+#endif
+}
+
+int runClient(const std::string& socketPath, const std::string& statement){
+#ifdef _WIN32
+	(void)socketPath;
+	(void)statement;
+	std::cerr << "Error:\nLocal sockets are not supported on this platform\n" << std::flush;
+	return 1;
+#else
+	auto fail = [](const std::string& message){
+		std::cerr << "Error:\n" << message << "\n" << std::flush;
+		return 1;
+	};
+	sockaddr_un address;
+	if(!makeAddress(socketPath, address)){
+		return fail("Invalid socket path \"" + socketPath + "\"");
+	}
+	const int client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(client < 0 || connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0){
+		if(client >= 0){
+			close(client);
+		}
+		return fail("Unable to connect to a server at \"" + socketPath + "\"");
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	Json request = Json::object();
+	request.set("op", "define");
+	request.set("input", statement);
+	std::string answer;
+	bool received = false;
+	if(writeAll(client, request.dump() + "\n")){
+		char buffer[4096];
+		while(!received){
+			const ssize_t size = read(client, buffer, sizeof(buffer));
+			if(size < 0 && errno == EINTR){
+				continue;
+			}
+			if(size <= 0){
+				break;
+			}
+			answer.append(buffer, size_t(size));
+			received = answer.find('\n') != std::string::npos;
+		}
+	}
+	close(client);
+
+	Json response;
+	if(!received || !Json::parse(answer.substr(0, answer.find('\n')), response)){
+		return fail("No answer from the server");
+	}
+	// Print the output as a local evaluation would.
+	const Json* output = response.find("output");
+	const Json* error = response.find("error");
+	const Json* ok = response.find("ok");
+	if(output && output->type == Json::Type::STRING){
+		std::cout << output->str << std::flush;
+	}
+	if(error && error->type == Json::Type::STRING){
+		std::cerr << error->str << std::flush;
+	}
+	return (ok && ok->type == Json::Type::BOOL && ok->boolean) ? 0 : 1;
+#endif
+}
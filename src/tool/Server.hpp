@@ -0,0 +1,103 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Settings.hpp"
+#include "core/Calculator.hpp"
+#include "core/ThreadPool.hpp"
+#include "Json.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+/** Keeps calculators in memory and answers requests of local clients, sent on a Unix domain socket as one JSON object
+ per line. Each request gets a response line, with the same "id" if any, and "ok" telling if it succeeded:
+ - {"op": "evaluate", "input": "..."}: evaluate without modifying the state, returns "result" or "error".
+ - {"op": "define", "input": "..."}: evaluate and keep definitions, returns the text printed by CalcoTool as "output" and "error".
+ - {"op": "sample", "function": "f", "from": [x, y], "to": [x, y], "count": [x, y]}: returns "values" on a regular grid.
+ - {"op": "list"}: returns "functions" and "variables" with their expressions.
+ - {"op": "shutdown"}: stop the server.
+ Requests apply to the calculator named by "session" if any, only the default one is loaded and saved. The number of
+ named sessions is bounded, and connections that stop reading their responses are closed.
+ Requests of a connection are answered in order, requests of different connections run concurrently on a thread pool:
+ evaluations and samples share their session, definitions and listings have exclusive access. */
+class Server {
+public:
+
+	explicit Server(const CalcoConfig& config);
+
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	// Serve until a shutdown request or an interruption, then save the default session. Returns the exit code.
+	int run(const std::string& socketPath);
+
+	// Answer a request line, without the line ending.
+	std::string handle(const std::string& request);
+
+private:
+
+	/** Calculator shared by the requests naming it. Evaluation caches its inputs, so read-only requests are evaluated
+	 on copies of the calculator, reused by later requests as long as the calculator is not modified. */
+	struct Session {
+		Calculator calculator;
+		std::shared_mutex mutex;
+		// Copies of the calculator at the given version, guarded by their own mutex.
+		std::mutex readersMutex;
+		std::vector<std::shared_ptr<Calculator>> readers;
+		uint64_t readersVersion = 0;
+	};
+
+	struct Connection {
+
+		~Connection();
+
+		int socket = -1;
+		// Received text not forming a complete line yet, only used by the listening thread.
+		std::string input;
+		bool open = true;
+		// Requests waiting for an answer, guarded by the mutex. Processed by one task at a time.
+		std::mutex mutex;
+		std::deque<std::string> requests;
+		bool busy = false;
+	};
+
+	// Returns nullptr and sets the error if the session name is invalid.
+	std::shared_ptr<Session> session(const Json& request, Json& response);
+
+	// Returns nullptr if the session doesn't exist and no more can be created.
+	std::shared_ptr<Session> session(const std::string& name);
+
+	// Both must be called with the session shared lock held.
+	std::shared_ptr<Calculator> acquireReader(Session& session);
+
+	void releaseReader(Session& session, const std::shared_ptr<Calculator>& reader);
+
+	void evaluate(Session& session, const Json& request, Json& response);
+
+	void define(Session& session, const Json& request, Json& response);
+
+	// Samples are returned separately, to avoid a JSON value per number.
+	bool sample(Session& session, const Json& request, Json& response, std::vector<double>& values);
+
+	void list(Session& session, Json& response);
+
+	void enqueue(const std::shared_ptr<Connection>& connection, const std::string& request);
+
+	// Answer the pending requests of a connection, in order.
+	void process(const std::shared_ptr<Connection>& connection);
+
+	const CalcoConfig& _config;
+	std::mutex _sessionsMutex;
+	std::unordered_map<std::string, std::shared_ptr<Session>> _sessions;
+	std::atomic<bool> _stop{false};
+	// Connections with a task processing their requests.
+	std::atomic<size_t> _busyConnections{0};
+	// Last member, so that pending tasks are completed before anything else is destroyed.
+	ThreadPool _pool;
+
+};
+
+// Send a statement to a server and print its answer as CalcoTool would, returns the exit code.
+int runClient(const std::string& socketPath, const std::string& statement);
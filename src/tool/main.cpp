@@ -2,10 +2,20 @@
 #include "core/Strings.hpp"
 #include "core/Settings.hpp"
 #include "core/Calculator.hpp"
+#include "core/ThreadPool.hpp"
 #include "core/system/TextUtilities.hpp"
+#include "Commands.hpp"
+#include "Json.hpp"
+#include "Server.hpp"
 
 #include <iostream>
 #include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 
 bool queryLineFromCIN(char* buffer, int size) {
@@ -31,6 +41,160 @@ bool queryLineFromCIN(char* buffer, int size) {
 	return lenRead;
 }
 
+// Evaluate statements line by line with the same state, and save it once at the end.
+int runScript(Calculator& calculator, const CalcoConfig& config){
+	std::ifstream file;
+	std::istream* input = &std::cin;
+	if(config.scriptPath != "-"){
+		file.open(config.scriptPath);
+		if(!file.is_open()){
+			std::cerr << "Error:\nUnable to open script at \"" << config.scriptPath << "\"\n" << std::flush;
+			return 1;
+		}
+		input = &file;
+	}
+
+	// Results are accumulated and written in large blocks.
+	const std::streamoff bufferSize = 1 << 16;
+	std::ostringstream out;
+	auto flushResults = [&out](){
+		std::cout << out.str();
+		out.str(std::string());
+	};
+
+	bool success = true;
+	size_t lineId = 0;
+	std::string line;
+	while(std::getline(*input, line)){
+		++lineId;
+		if(!line.empty() && line.back() == '\r'){
+			line.pop_back();
+		}
+		if(TextUtilities::trim(line, " \t").empty()){
+			continue;
+		}
+		std::ostringstream err;
+		if(!evaluateStatement(calculator, line, false, out, err, "Error (line " + std::to_string(lineId) + "):")){
+			// Keep errors in order with the results.
+			flushResults();
+			std::cout << std::flush;
+			std::cerr << err.str() << std::flush;
+			success = false;
+		}
+		if(out.tellp() >= bufferSize){
+			flushResults();
+		}
+	}
+	flushResults();
+	std::cout << std::flush;
+
+	// Statements that succeeded are kept even if others failed.
+	if(!config.noSave){
+		saveState(calculator, config);
+	}
+	return success ? 0 : 1;
+}
+
+// Evaluate a temporary expression to a number.
+bool evaluateNumber(Calculator& calculator, const std::string& input, double& output){
+	Value result, resultFloat;
+	Format format = Format::INTERNAL;
+	std::vector<Calculator::Word> wordInfos;
+	if(!calculator.evaluate(input, result, wordInfos, format, true) || !result.convert(Value::Type::FLOAT, resultFloat)){
+		return false;
+	}
+	output = resultFloat.f;
+	return true;
+}
+
+// Evaluate a function on a regular grid and stream the results to stdout, block by block.
+int sampleFunction(Calculator& calculator, const CalcoConfig& config){
+	auto fail = [](const std::string& message){
+		std::cerr << "Error:\n" << message << "\n" << std::flush;
+		return 1;
+	};
+
+	const int argCount = calculator.functionArgumentCount(config.sampleFunction);
+	if(argCount < 0){
+		return fail("Unknown function \"" + config.sampleFunction + "\"");
+	}
+	if(argCount != 1 && argCount != 2){
+		return fail("Only functions of one or two arguments can be sampled");
+	}
+	SampleGrid grid;
+	grid.axisCount = size_t(argCount);
+	const bool binary = config.sampleFormat == "bin";
+	if(!binary && config.sampleFormat != "csv"){
+		return fail("Unknown format \"" + config.sampleFormat + "\", expected csv or bin");
+	}
+
+	// Parameters missing for the second axis are the same as for the first.
+	for(size_t aid = 0; aid < grid.axisCount; ++aid){
+		double count = 0.0;
+		if(!evaluateNumber(calculator, config.sampleFrom[std::min(aid, config.sampleFrom.size() - 1)], grid.froms[aid]) ||
+		   !evaluateNumber(calculator, config.sampleTo[std::min(aid, config.sampleTo.size() - 1)], grid.tos[aid]) ||
+		   !evaluateNumber(calculator, config.sampleCount[std::min(aid, config.sampleCount.size() - 1)], count)){
+			return fail("Unable to evaluate the sampling bounds");
+		}
+		if(!grid.setCount(aid, count)){
+			return fail(SampleGrid::countError());
+		}
+	}
+
+#ifdef _WIN32
+	if(binary){
+		_setmode(_fileno(stdout), _O_BINARY);
+	}
+#endif
+
+	// Samples are evaluated and formatted in parallel chunks, and written once per block.
+	const size_t blockSize = 1u << 16u;
+	const size_t totalCount = grid.sampleCount();
+	std::vector<double> xs(blockSize);
+	std::vector<double> ys(blockSize);
+	std::vector<double> values(blockSize);
+	std::vector<std::string> texts(blockSize / SampleGrid::CHUNK_SIZE);
+	ThreadPool pool;
+
+	// Text is formatted by the threads evaluating each chunk.
+	std::function<void(size_t, size_t)> format;
+	if(!binary){
+		format = [&](size_t begin, size_t end){
+			std::string& text = texts[begin / SampleGrid::CHUNK_SIZE];
+			text.clear();
+			for(size_t sid = begin; sid < end; ++sid){
+				Json::appendNumber(text, xs[sid]);
+				text.append(", ");
+				if(grid.axisCount == 2){
+					Json::appendNumber(text, ys[sid]);
+					text.append(", ");
+				}
+				Json::appendNumber(text, values[sid]);
+				text.push_back('\n');
+			}
+		};
+	}
+
+	for(size_t start = 0; start < totalCount; start += blockSize){
+		const size_t count = std::min(blockSize, totalCount - start);
+		if(!grid.evaluate(calculator, config.sampleFunction, pool, start, count, xs.data(), ys.data(), values.data(), format)){
+			std::cout << std::flush;
+			return fail("Unable to evaluate \"" + config.sampleFunction + "\" as a number");
+		}
+
+		if(binary){
+			std::cout.write(reinterpret_cast<const char*>(values.data()), std::streamsize(count * sizeof(double)));
+			continue;
+		}
+		const size_t chunkCount = (count + SampleGrid::CHUNK_SIZE - 1) / SampleGrid::CHUNK_SIZE;
+		for(size_t cid = 0; cid < chunkCount; ++cid){
+			std::cout.write(texts[cid].data(), std::streamsize(texts[cid].size()));
+		}
+	}
+	std::cout << std::flush;
+	return 0;
+}
+
 int main(int argc, char** argv) {
 
 	CalcoConfig config(std::vector<std::string>(argv, argv+argc));
@@ -47,28 +211,43 @@ int main(int argc, char** argv) {
 		return 0;
 	}
 
-	Calculator calculator;
-
-	// Save/restore calculator state
-	{
-		std::ifstream file(config.historyPath);
-		if (file.is_open()) {
-			std::string elem;
-			file >> elem;
-			if (elem == "CALCSTATE") {
-				calculator.loadFromStream(file);
-				file >> elem;
-			}
-			file.close();
-		} else {
-			Log::Error() << "Unable to open state at \"" << config.historyPath << "\"" << std::endl;
-		}
+	if(!config.servePath.empty()){
+		// The server loads and saves the state itself.
+		Server server(config);
+		return server.run(config.servePath);
 	}
 
 	// TODO: support specifying history at the same time.
 	std::string inputLine;
 	for(int i = 1; i < argc; ++i){
-		inputLine += std::string(argv[i]) + (i != (argc - 1 )? " " : "");
+		const std::string arg(argv[i]);
+		if(arg == "--no-save"){
+			continue;
+		}
+		if(arg == "--connect"){
+			// Skip the socket path.
+			++i;
+			continue;
+		}
+		inputLine += (inputLine.empty() ? "" : " ") + arg;
+	}
+
+	if(!config.connectPath.empty()){
+		// The state is kept by the server.
+		return runClient(config.connectPath, inputLine);
+	}
+
+	Calculator calculator;
+
+	// Save/restore calculator state
+	loadState(calculator, config);
+
+	if(!config.sampleFunction.empty()){
+		// No need to save the state.
+		return sampleFunction(calculator, config);
+	}
+	if(!config.scriptPath.empty()){
+		return runScript(calculator, config);
 	}
 
 	if(inputLine == "functions"){
@@ -118,65 +297,15 @@ int main(int argc, char** argv) {
 	}
 
 	// Else, real expression.
-
-	Value result;
-	Format format = Format::INTERNAL;
-	std::vector<Calculator::Word> wordInfos;
-	const bool success = calculator.evaluate(inputLine, result, wordInfos, format, false);
-
-	// Input line, with syntax highlighted words.
-	std::string inputLineInterpreted;
-	bool first = true;
-	for(const Calculator::Word& word : wordInfos){
-		std::string wordString = inputLine.substr(word.location, word.size);
-		if(word.type == Calculator::Word::OPERATOR && !first){
-			wordString = " " + wordString + " ";
-		}
-		inputLineInterpreted.append(wordString);
-		first = false;
-	}
-
-	std::cout << inputLineInterpreted << "\n" << std::flush;
-
-	// Output/error line
+	const bool success = evaluateStatement(calculator, inputLine, false, std::cout, std::cerr, "Error:");
+	std::cout << std::flush;
+	std::cerr << std::flush;
 	if(!success){
-		// Error line: passthrough the error message from the calculator.
-		// The message can be multi-lines, split it.
-		const std::vector<std::string> sublines = TextUtilities::split(result.str, "\n", false);
-		std::cerr << "Error:\n";
-		for (const std::string& subline : sublines) {
-			std::cerr << subline << "\n";
-		}
-		std::cerr << std::flush;
 		return 1;
-	} else if(result.type == Value::Type::STRING){
-		// This is 'function definition' specific.
-		std::cout << result.str << " defined" << "\n";
-
-	} else {
-
-		// Build final display properly formatted.
-		const std::string externalStr = result.toString(format);
-		// The message can be multi-lines, split it.
-		const std::vector<std::string> sublines = TextUtilities::split(externalStr, "\n", false);
-		bool firstl = true;
-		for (const std::string& subline : sublines) {
-			std::cout << (firstl ? "= " : "  ") << subline << "\n";
-			firstl = false;
-		}
-
 	}
-	std::cout << std::flush;
-
-	{
-		std::ofstream file(config.historyPath);
-		if(file.is_open()) {
-			calculator.saveToStream(file);
-			file.close();
-		} else {
-			Log::Error() << "Unable to save state to \"" << config.historyPath << "\"" << std::endl;
-		}
 
+	if(!config.noSave){
+		saveState(calculator, config);
 	}
 
 	return 0;